@@ -0,0 +1,643 @@
+//
+// Microbenchmarks for Timer, the physics integrator and the GL calls of the render loop
+//
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+#include <Timer.h>
+#include <Physics.h>
+
+using namespace std;
+
+// the GL benchmarks draw into a framebuffer object, the window is never shown
+const int TARGET_SIZE = 256;
+
+// Runs the benchmarked code iterations times
+typedef function<void(long iterations)> BenchmarkBody;
+
+struct Benchmark {
+    string name;
+    BenchmarkBody body;
+    // operations in one iteration, results are per operation
+    long opsPerIteration;
+    // bytes moved by one operation, 0 when it doesn't apply
+    double bytesPerOp;
+};
+
+struct BenchmarkResult {
+    string name;
+    long iterations;
+    int samples;
+    // ns per operation, over the samples
+    double median;
+    double mad;
+    double min;
+    double mean;
+    double stddev;
+    // samples further than 3 sigma (from the MAD) from the median
+    int outliers;
+    double bytesPerOp;
+};
+
+struct Options {
+    int samples;
+    double sampleMs;
+    string filter;
+    bool gl;
+    bool json;
+    string outPath;
+    string baselinePath;
+    // slower than the baseline by more than this fraction is a regression
+    double threshold;
+};
+
+// Keeps the compiler from removing a result nobody reads
+template<typename T>
+inline void doNotOptimize(const T &value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile char sink;
+    sink = *reinterpret_cast<const volatile char *>(&value);
+#endif
+}
+
+double elapsedNs(chrono::steady_clock::time_point start) {
+    return chrono::duration<double, nano>(chrono::steady_clock::now() - start).count();
+}
+
+double timeIterations(const Benchmark &benchmark, long iterations) {
+    auto start = chrono::steady_clock::now();
+    benchmark.body(iterations);
+    return elapsedNs(start);
+}
+
+double medianOf(vector<double> values) {
+    const size_t middle = values.size() / 2;
+    nth_element(values.begin(), values.begin() + middle, values.end());
+    double median = values[middle];
+    if (values.size() % 2 == 0) {
+        median = (median + *max_element(values.begin(), values.begin() + middle)) / 2.0;
+    }
+    return median;
+}
+
+BenchmarkResult run(const Benchmark &benchmark, const Options &options) {
+    // the first call pays for lazy setup (shader variants, buffer storage) and is thrown away
+    timeIterations(benchmark, 1);
+
+    // doubles the iterations until a sample is long enough for the clock, which also warms up caches,
+    // branch predictors and the driver
+    long iterations = 1;
+    const double sampleNs = options.sampleMs * 1e6;
+    double ns = timeIterations(benchmark, iterations);
+    while (ns < sampleNs && iterations < (1L << 40)) {
+        iterations = ns < sampleNs / 16 ? iterations * 8 : iterations * 2;
+        ns = timeIterations(benchmark, iterations);
+    }
+
+    vector<double> perOp(options.samples);
+    const double ops = (double) iterations * benchmark.opsPerIteration;
+    for (int i = 0; i < options.samples; i++) {
+        perOp[i] = timeIterations(benchmark, iterations) / ops;
+    }
+
+    BenchmarkResult result;
+    result.name = benchmark.name;
+    result.iterations = iterations;
+    result.samples = options.samples;
+    result.bytesPerOp = benchmark.bytesPerOp;
+    // median and median absolute deviation, a preempted sample doesn't move them
+    result.median = medianOf(perOp);
+    vector<double> deviations(perOp.size());
+    for (size_t i = 0; i < perOp.size(); i++) {
+        deviations[i] = fabs(perOp[i] - result.median);
+    }
+    result.mad = medianOf(deviations);
+    result.min = *min_element(perOp.begin(), perOp.end());
+    double sum = 0.0;
+    for (size_t i = 0; i < perOp.size(); i++) {
+        sum += perOp[i];
+    }
+    result.mean = sum / perOp.size();
+    double squares = 0.0;
+    for (size_t i = 0; i < perOp.size(); i++) {
+        squares += (perOp[i] - result.mean) * (perOp[i] - result.mean);
+    }
+    result.stddev = perOp.size() > 1 ? sqrt(squares / (perOp.size() - 1)) : 0.0;
+    result.outliers = 0;
+    for (size_t i = 0; i < perOp.size(); i++) {
+        if (deviations[i] > 3.0 * 1.4826 * result.mad) {
+            result.outliers++;
+        }
+    }
+    return result;
+}
+
+// Timer and physics, no GL needed
+void addCpuBenchmarks(vector<Benchmark> &benchmarks) {
+    static Timer timer;
+    timer.start();
+    benchmarks.push_back({"timer.getTicks", [](long iterations) {
+        for (long i = 0; i < iterations; i++) {
+            int ticks = timer.getTicks();
+            doNotOptimize(ticks);
+        }
+    }, 1, 0.0});
+
+    // one spring stepped over and over, each step waits for the previous one like in Lesson3
+    benchmarks.push_back({"physics.integrate", [](long iterations) {
+        State state = {100.f, 0.f};
+        float t = 0.f;
+        for (long i = 0; i < iterations; i++) {
+            integrate(state, t, 0.1f);
+            t += 0.1f;
+            // keeps the spring moving, a resting one hits denormals
+            if (fabs(state.x) < 1e-3f) {
+                state.x = 100.f;
+            }
+        }
+        doNotOptimize(state);
+    }, 1, 0.0});
+
+    static vector<State> states(1024);
+    for (size_t i = 0; i < states.size(); i++) {
+        states[i].x = 100.f - (float) (i % 200);
+        states[i].v = 0.f;
+    }
+    benchmarks.push_back({"physics.integrateStates/1024", [](long iterations) {
+        for (long i = 0; i < iterations; i++) {
+            integrateStates(states.data(), states.size(), 0.f, 0.1f);
+            // sends every state back before it settles, the same work each time
+            if (fabs(states[0].x) < 1e-3f) {
+                for (size_t s = 0; s < states.size(); s++) {
+                    states[s].x = 100.f - (float) (s % 200);
+                    states[s].v = 0.f;
+                }
+            }
+        }
+        doNotOptimize(states[0]);
+    }, (long) states.size(), 0.0});
+
+    benchmarks.push_back({"physics.evaluate", [](long iterations) {
+        State state = {100.f, 10.f};
+        Derivative derivative = {0.f, 0.f};
+        for (long i = 0; i < iterations; i++) {
+            derivative = evaluate(state, 0.f, 0.05f, derivative);
+            doNotOptimize(derivative);
+        }
+    }, 1, 0.0});
+
+    benchmarks.push_back({"physics.interpolate", [](long iterations) {
+        State previous = {100.f, 10.f};
+        State current = {90.f, 9.f};
+        float alpha = 0.f;
+        for (long i = 0; i < iterations; i++) {
+            State state = interpolate(previous, current, alpha);
+            doNotOptimize(state);
+            alpha = alpha < 1.f ? alpha + 0.125f : 0.f;
+        }
+    }, 1, 0.0});
+}
+
+// GL objects the GL benchmarks share
+struct GLFixture {
+    GLuint framebuffer;
+    GLuint colorBuffer;
+    GLuint program;
+    GLint colorLocation;
+    GLuint vao;
+    GLuint vbo;
+    GLuint uploadVao;
+    GLuint uploadBuffer;
+    vector<char> uploadData;
+};
+GLFixture gFixture;
+
+const GLchar *VERTEX_SHADER =
+        "#version 330 core\n"
+        "layout(location = 0) in vec2 position;\n"
+        "void main() { gl_Position = vec4(position, 0.0, 1.0); }";
+
+const GLchar *FRAGMENT_SHADER =
+        "#version 330 core\n"
+        "uniform vec4 color;\n"
+        "out vec4 fragColor;\n"
+        "void main() { fragColor = color; }";
+
+GLuint compileShader(ostream &log, GLenum type, const GLchar *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        log << "Unable to compile benchmark shader" << endl;
+    }
+    return shader;
+}
+
+bool initGLFixture(ostream &log) {
+    glGenRenderbuffers(1, &gFixture.colorBuffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, gFixture.colorBuffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, TARGET_SIZE, TARGET_SIZE);
+    glGenFramebuffers(1, &gFixture.framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, gFixture.framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, gFixture.colorBuffer);
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+        log << "Benchmark framebuffer incomplete" << endl;
+        return false;
+    }
+    glViewport(0, 0, TARGET_SIZE, TARGET_SIZE);
+
+    GLuint vertexShader = compileShader(log, GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragmentShader = compileShader(log, GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    gFixture.program = glCreateProgram();
+    glAttachShader(gFixture.program, vertexShader);
+    glAttachShader(gFixture.program, fragmentShader);
+    glLinkProgram(gFixture.program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+    GLint linked = GL_FALSE;
+    glGetProgramiv(gFixture.program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        log << "Unable to link benchmark program" << endl;
+        return false;
+    }
+    gFixture.colorLocation = glGetUniformLocation(gFixture.program, "color");
+
+    // a small triangle, draws cost submission rather than fill
+    const GLfloat triangle[] = {-0.05f, -0.05f, 0.05f, -0.05f, 0.f, 0.05f};
+    glGenVertexArrays(1, &gFixture.vao);
+    glBindVertexArray(gFixture.vao);
+    glGenBuffers(1, &gFixture.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, gFixture.vbo);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(triangle), triangle, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glBindVertexArray(0);
+
+    // the uploads are read as vertices, so every one is consumed by a draw
+    glGenVertexArrays(1, &gFixture.uploadVao);
+    glBindVertexArray(gFixture.uploadVao);
+    glGenBuffers(1, &gFixture.uploadBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gFixture.uploadBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glBindVertexArray(0);
+    gFixture.uploadData.assign(1 << 20, 0);
+    return glGetError() == GL_NO_ERROR;
+}
+
+void destroyGLFixture() {
+    glDeleteBuffers(1, &gFixture.uploadBuffer);
+    glDeleteVertexArrays(1, &gFixture.uploadVao);
+    glDeleteBuffers(1, &gFixture.vbo);
+    glDeleteVertexArrays(1, &gFixture.vao);
+    glDeleteProgram(gFixture.program);
+    glDeleteFramebuffers(1, &gFixture.framebuffer);
+    glDeleteRenderbuffers(1, &gFixture.colorBuffer);
+}
+
+// Uploads of bytes per call into one buffer. The sample ends with glFinish(), so the time includes the
+// driver's copies and any stall on a buffer still in use.
+BenchmarkBody uploadBody(GLsizeiptr bytes, bool orphan) {
+    return [bytes, orphan](long iterations) {
+        glUseProgram(gFixture.program);
+        glBindVertexArray(gFixture.uploadVao);
+        glBindBuffer(GL_ARRAY_BUFFER, gFixture.uploadBuffer);
+        glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+        for (long i = 0; i < iterations; i++) {
+            if (orphan) {
+                // new storage, the driver doesn't wait for the previous contents to be consumed
+                glBufferData(GL_ARRAY_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+            }
+            glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, gFixture.uploadData.data());
+            // each upload is consumed by a draw, like a frame's streamed vertices
+            glDrawArrays(GL_POINTS, 0, 1);
+        }
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glFinish();
+    };
+}
+
+// Draw calls as the render loop submits them, the sample ends with glFinish()
+BenchmarkBody drawBody(bool rebind) {
+    return [rebind](long iterations) {
+        glUseProgram(gFixture.program);
+        glBindVertexArray(gFixture.vao);
+        for (long i = 0; i < iterations; i++) {
+            if (rebind) {
+                // Lesson4 binds a program and a VAO and sets uniforms for every draw
+                glUseProgram(gFixture.program);
+                glBindVertexArray(gFixture.vao);
+                glUniform4f(gFixture.colorLocation, (i & 255) / 255.f, 0.5f, 0.f, 1.f);
+            }
+            glDrawArrays(GL_TRIANGLES, 0, 3);
+        }
+        glBindVertexArray(0);
+        glUseProgram(0);
+        glFinish();
+    };
+}
+
+void addGLBenchmarks(vector<Benchmark> &benchmarks) {
+    const GLsizeiptr sizes[] = {4 << 10, 256 << 10, 1 << 20};
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        const string size = sizes[i] < (1 << 20) ? to_string(sizes[i] >> 10) + "KB" : to_string(sizes[i] >> 20) + "MB";
+        benchmarks.push_back({"gl.bufferSubData/" + size, uploadBody(sizes[i], false), 1, (double) sizes[i]});
+        benchmarks.push_back({"gl.bufferSubData.orphan/" + size, uploadBody(sizes[i], true), 1,
+                              (double) sizes[i]});
+    }
+    glUseProgram(gFixture.program);
+    glUniform4f(gFixture.colorLocation, 1.f, 1.f, 1.f, 1.f);
+    glUseProgram(0);
+    benchmarks.push_back({"gl.drawArrays", drawBody(false), 1, 0.0});
+    benchmarks.push_back({"gl.drawArrays.rebind", drawBody(true), 1, 0.0});
+}
+
+void printText(const BenchmarkResult &result) {
+    char line[256];
+    snprintf(line, sizeof(line), "%-34s %12.2f ns  +-%9.2f  min %12.2f  %3d samples x %ld  %d outliers",
+             result.name.c_str(), result.median, result.mad, result.min, result.samples, result.iterations,
+             result.outliers);
+    cout << line;
+    if (result.bytesPerOp > 0.0) {
+        cout << "  " << result.bytesPerOp / result.median << " GB/s";
+    }
+    cout << endl;
+}
+
+string jsonString(const string &value) {
+    string quoted = "\"";
+    for (size_t i = 0; i < value.size(); i++) {
+        if (value[i] == '"' || value[i] == '\\') {
+            quoted += '\\';
+        }
+        quoted += value[i];
+    }
+    return quoted + "\"";
+}
+
+void writeJson(ostream &out, const vector<BenchmarkResult> &results, const string &renderer) {
+    out << "{" << endl;
+    out << "  \"simd\": " << jsonString(physicsSimdName()) << "," << endl;
+    out << "  \"gl_renderer\": " << jsonString(renderer) << "," << endl;
+    out << "  \"unit\": \"ns\"," << endl;
+    out << "  \"benchmarks\": [" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        out << "    {\"name\": " << jsonString(result.name) << ", \"median\": " << result.median << ", \"mad\": "
+            << result.mad << ", \"min\": " << result.min << ", \"mean\": " << result.mean << ", \"stddev\": "
+            << result.stddev << ", \"samples\": " << result.samples << ", \"iterations\": " << result.iterations
+            << ", \"outliers\": " << result.outliers;
+        if (result.bytesPerOp > 0.0) {
+            out << ", \"bytes_per_second\": " << result.bytesPerOp / result.median * 1e9;
+        }
+        out << "}" << (i + 1 < results.size() ? "," : "") << endl;
+    }
+    out << "  ]" << endl;
+    out << "}" << endl;
+}
+
+// the number after "key": in text, NAN when missing
+double jsonNumber(const string &text, const string &key) {
+    size_t at = text.find("\"" + key + "\"");
+    if (at == string::npos) {
+        return NAN;
+    }
+    at = text.find(':', at);
+    return at == string::npos ? NAN : strtod(text.c_str() + at + 1, nullptr);
+}
+
+// Reads the benchmarks back from a file written with --json or --out
+bool loadBaseline(ostream &log, const string &path, map<string, BenchmarkResult> &baseline) {
+    ifstream file(path);
+    if (!file) {
+        log << "Unable to open baseline " << path << endl;
+        return false;
+    }
+    stringstream contents;
+    contents << file.rdbuf();
+    const string text = contents.str();
+
+    size_t at = text.find("\"benchmarks\"");
+    while (at != string::npos && (at = text.find('{', at)) != string::npos) {
+        size_t end = text.find('}', at);
+        if (end == string::npos) {
+            break;
+        }
+        const string object = text.substr(at, end - at);
+        size_t name = object.find("\"name\"");
+        size_t open = name == string::npos ? string::npos : object.find('"', object.find(':', name));
+        size_t close = open == string::npos ? string::npos : object.find('"', open + 1);
+        if (close != string::npos) {
+            BenchmarkResult result;
+            result.name = object.substr(open + 1, close - open - 1);
+            result.median = jsonNumber(object, "median");
+            result.mad = jsonNumber(object, "mad");
+            result.samples = (int) jsonNumber(object, "samples");
+            if (!std::isnan(result.median) && !std::isnan(result.mad) && result.samples > 0) {
+                baseline[result.name] = result;
+            }
+        }
+        at = end;
+    }
+    if (baseline.empty()) {
+        log << "No benchmarks in baseline " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+// Prints the change of every benchmark against the baseline, returns the number of regressions.
+// A change counts when it is larger than the threshold and than the noise of both runs: three
+// standard errors of the difference of the medians, estimated from the MADs.
+int compare(ostream &out, const vector<BenchmarkResult> &results, const map<string, BenchmarkResult> &baseline,
+            double threshold) {
+    int regressions = 0;
+    out << endl << "Against the baseline (threshold " << threshold * 100.0 << "%):" << endl;
+    for (size_t i = 0; i < results.size(); i++) {
+        const BenchmarkResult &result = results[i];
+        map<string, BenchmarkResult>::const_iterator found = baseline.find(result.name);
+        if (found == baseline.end()) {
+            out << "  " << result.name << ": not in the baseline" << endl;
+            continue;
+        }
+        const BenchmarkResult &base = found->second;
+        // sigma ~ 1.4826 MAD, standard error of a median ~ 1.2533 sigma / sqrt(n)
+        const double errorNew = 1.2533 * 1.4826 * result.mad / sqrt((double) result.samples);
+        const double errorBase = 1.2533 * 1.4826 * base.mad / sqrt((double) base.samples);
+        const double noise = 3.0 * sqrt(errorNew * errorNew + errorBase * errorBase);
+        const double difference = result.median - base.median;
+        const double change = base.median > 0.0 ? difference / base.median : 0.0;
+
+        const char *verdict = "same";
+        if (fabs(difference) > noise && fabs(change) > threshold) {
+            verdict = difference > 0.0 ? "SLOWER" : "faster";
+            if (difference > 0.0) {
+                regressions++;
+            }
+        }
+        char line[256];
+        snprintf(line, sizeof(line), "  %-34s %12.2f -> %12.2f ns  %+7.1f%%  %s", result.name.c_str(),
+                 base.median, result.median, change * 100.0, verdict);
+        out << line << endl;
+    }
+    return regressions;
+}
+
+SDL_Window *gWindow = nullptr;
+SDL_GLContext gGLContext = nullptr;
+
+// A hidden window's context. SDL has no surfaceless contexts; with SDL_VIDEODRIVER=offscreen no display
+// is needed at all.
+bool initHeadlessGL(ostream &log) {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    gWindow = SDL_CreateWindow("Benchmarks", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, TARGET_SIZE,
+                               TARGET_SIZE, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+    if (gWindow == nullptr) {
+        log << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        return false;
+    }
+    gGLContext = SDL_GL_CreateContext(gWindow);
+    if (gGLContext == nullptr) {
+        log << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        return false;
+    }
+    glewExperimental = GL_TRUE;
+    GLenum error = glewInit();
+    if (error != GLEW_OK) {
+        log << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        return false;
+    }
+    // glewInit() can leave GL_INVALID_ENUM behind on core profiles
+    glGetError();
+    return initGLFixture(log);
+}
+
+int main(int argc, char *argv[]) {
+    Options options;
+    options.samples = 25;
+    options.sampleMs = 5.0;
+    options.gl = true;
+    options.json = false;
+    options.threshold = 0.05;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--samples") == 0 && i + 1 < argc) {
+            options.samples = atoi(argv[++i]);
+            valid = options.samples >= 3;
+        } else if (strcmp(argv[i], "--sample-ms") == 0 && i + 1 < argc) {
+            options.sampleMs = atof(argv[++i]);
+            valid = options.sampleMs > 0.0;
+        } else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc) {
+            options.filter = argv[++i];
+        } else if (strcmp(argv[i], "--no-gl") == 0) {
+            options.gl = false;
+        } else if (strcmp(argv[i], "--json") == 0) {
+            options.json = true;
+        } else if (strcmp(argv[i], "--out") == 0 && i + 1 < argc) {
+            options.outPath = argv[++i];
+        } else if (strcmp(argv[i], "--baseline") == 0 && i + 1 < argc) {
+            options.baselinePath = argv[++i];
+        } else if (strcmp(argv[i], "--threshold") == 0 && i + 1 < argc) {
+            options.threshold = atof(argv[++i]) / 100.0;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid) {
+        cout << "usage: " << argv[0] << endl
+             << "    [--samples n] [--sample-ms ms] [--filter name] [--no-gl]" << endl
+             << "    [--json] [--out results.json] [--baseline results.json [--threshold percent]]" << endl;
+        return 1;
+    }
+
+    // with --json stdout is the results only
+    ostream &log = options.json ? cerr : cout;
+    map<string, BenchmarkResult> baseline;
+    if (!options.baselinePath.empty() && !loadBaseline(log, options.baselinePath, baseline)) {
+        return 1;
+    }
+
+    // Timer reads SDL's clock
+    if (SDL_Init(options.gl ? SDL_INIT_VIDEO : SDL_INIT_TIMER) != 0) {
+        log << "SDL_Init error " << SDL_GetError() << endl;
+        return 1;
+    }
+
+    vector<Benchmark> benchmarks;
+    addCpuBenchmarks(benchmarks);
+    string renderer = "none";
+    if (options.gl) {
+        if (!initHeadlessGL(log)) {
+            cleanup(&gGLContext, gWindow);
+            SDL_Quit();
+            return 1;
+        }
+        renderer = (const char *) glGetString(GL_RENDERER);
+        addGLBenchmarks(benchmarks);
+    }
+
+    log << "Physics " << physicsSimdName() << ", GL " << renderer << ", " << options.samples << " samples of "
+        << options.sampleMs << " ms, median ns per operation +- MAD" << endl;
+
+    vector<BenchmarkResult> results;
+    for (size_t i = 0; i < benchmarks.size(); i++) {
+        if (benchmarks[i].name.find(options.filter) == string::npos) {
+            continue;
+        }
+        results.push_back(run(benchmarks[i], options));
+        if (!options.json) {
+            printText(results.back());
+        }
+        if (options.gl && glGetError() != GL_NO_ERROR) {
+            log << "Warning: GL error in " << benchmarks[i].name << ", its results are not valid" << endl;
+        }
+    }
+
+    if (options.gl) {
+        destroyGLFixture();
+        cleanup(&gGLContext, gWindow);
+    }
+    SDL_Quit();
+
+    if (options.json) {
+        writeJson(cout, results, renderer);
+    }
+    if (!options.outPath.empty()) {
+        ofstream out(options.outPath);
+        writeJson(out, results, renderer);
+        if (!out) {
+            log << "Unable to write " << options.outPath << endl;
+            return 1;
+        }
+        log << "Results written to " << options.outPath << endl;
+    }
+
+    if (!baseline.empty()) {
+        int regressions = compare(log, results, baseline, options.threshold);
+        if (regressions > 0) {
+            log << regressions << " regression(s)" << endl;
+            return 2;
+        }
+    }
+    return 0;
+}
@@ -1,11 +1,26 @@
 #include <iostream>
+#include <cstring>
 #include <SDL.h>
 #include "Cleanup.h"
 #include "Timer.h"
+#include "Metrics.h"
 
 using namespace std;
 
-int main() {
+int main(int argc, char *argv[]) {
+    // --metrics /name publishes the frame metrics for MetricsReader
+    MetricsPublisher metrics;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            if (!metrics.open(argv[++i])) {
+                return 1;
+            }
+        } else {
+            cout << "usage: " << argv[0] << " [--metrics /name]" << endl;
+            return 1;
+        }
+    }
+
     // init SDL sistem
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         cout << "SDL_Init error" << SDL_GetError() << endl;
@@ -45,6 +60,7 @@ int main() {
         SDL_Quit();
         return 1;
     }
+    metrics.setMemoryBytes((uint64_t) surface->pitch * surface->h);
 
     // creating texture from surface
     SDL_Texture *texture = SDL_CreateTextureFromSurface(renderer, surface);
@@ -68,9 +84,12 @@ int main() {
     //The frames per second cap timer
     Timer capTimer;
 
+    metrics.setTargetFrameMs(1000.0 / FRAMES_PER_SECOND);
+
     fpsTimer.start();
     bool quit = false;
     SDL_Event event;
+    Uint64 frameStart = SDL_GetPerformanceCounter();
     while (!quit) {
         //Start cap timer
         capTimer.start();
@@ -118,6 +137,11 @@ int main() {
             //Sleep the remaining countedFrames time
             SDL_Delay(SCREEN_TICKS_PER_FRAME - frameTicks);
         }
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        metrics.addDrawCalls(1);
+        metrics.endFrame((now - frameStart) * 1000.0 / SDL_GetPerformanceFrequency());
+        frameStart = now;
     }
 
     // Clean up everything
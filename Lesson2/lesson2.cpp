@@ -1,22 +1,68 @@
 //
 // Created by Silvio Fragnani da Silva on 20/03/16.
 //
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
 #include <GL/glew.h>
 #include <SDL.h>
 #include "Cleanup.h"
+// the glBegin/glEnd calls below go through the emulation layer
+#define IMMEDIATE_MODE_REDIRECT
+#include "ImmediateMode.h"
 
 using namespace std;
 
-int main() {
+const int BENCH_FRAMES = 200;
+
+// quadCount small quads on a grid, one glBegin/glEnd each
+void drawQuadGrid(int quadCount) {
+    int side = 1;
+    while (side * side < quadCount) {
+        side++;
+    }
+    const float size = 2.f / side;
+    for (int i = 0; i < quadCount; i++) {
+        const float x = -1.f + (i % side) * size;
+        const float y = -1.f + (i / side) * size;
+        glBegin(GL_QUADS);
+        glColor3f((float) (i % side) / side, (float) (i / side) / side, 0.5f);
+        glVertex2f(x, y);
+        glVertex2f(x + size * 0.8f, y);
+        glVertex2f(x + size * 0.8f, y + size * 0.8f);
+        glVertex2f(x, y + size * 0.8f);
+        glEnd();
+    }
+}
+
+int main(int argc, char *argv[]) {
+    bool core = false;
+    int benchQuads = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--core") == 0) {
+            core = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchQuads = atoi(argv[++i]);
+        } else {
+            cout << "usage: " << argv[0] << " [--core] [--bench quads]" << endl;
+            return 1;
+        }
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         cout << "SDL_Init error " << SDL_GetError() << endl;
         return 1;
     }
 
-    // set GL version
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    // set GL version, glBegin/glEnd are emulated on the core profile
+    if (core) {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    } else {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    }
 
     // create window
     SDL_Window *window = SDL_CreateWindow("SDL with OpenGL",
@@ -40,7 +86,10 @@ int main() {
         return 1;
     }
 
-    if (SDL_GL_SetSwapInterval(1) != 0) {
+    // the benchmark runs unthrottled
+    if (benchQuads > 0) {
+        SDL_GL_SetSwapInterval(0);
+    } else if (SDL_GL_SetSwapInterval(1) != 0) {
         cout << "Warning: unable to set VSync. Error " << SDL_GetError() << endl;
     }
 
@@ -49,39 +98,52 @@ int main() {
     // initialize GLEW
     //////////////////////////////////
     GLenum error = GL_NO_ERROR;
+    glewExperimental = GL_TRUE;
     error = glewInit();
     if (GLEW_OK != error) {
         cleanup(window);
         cout << "glewInit error: " << glewGetErrorString(error) << endl;
         return 1;
     }
+    // glewInit may leave GL_INVALID_ENUM behind on core profiles
+    glGetError();
 
     //////////////////////////////////
     // initialize OpenGL
     //////////////////////////////////
-    // initialize projection matrix
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
-
-    // check for errors
-    error = glGetError();
-    if (error != GL_NO_ERROR) {
-        cout << "Error initializing OpenGL! " << glewGetErrorString(error) << endl;
-        cleanup(&glContext, window);
-        return 1;
+    if (!core) {
+        // initialize projection matrix
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
+
+        // check for errors
+        error = glGetError();
+        if (error != GL_NO_ERROR) {
+            cout << "Error initializing OpenGL! " << glewGetErrorString(error) << endl;
+            cleanup(&glContext, window);
+            return 1;
+        }
+
+        // initialize Modelview Matrix
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
+        // check for errors
+        error = glGetError();
+        if (error != GL_NO_ERROR) {
+            cout << "Error initializing OpenGL! " << glewGetErrorString(error) << endl;
+            cleanup(&glContext, window);
+            return 1;
+        }
     }
 
-    // initialize Modelview Matrix
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
-    // check for errors
-    error = glGetError();
-    if (error != GL_NO_ERROR) {
-        cout << "Error initializing OpenGL! " << glewGetErrorString(error) << endl;
+    if (!imInit(core ? IM_BACKEND_BATCHED : IM_BACKEND_NATIVE)) {
         cleanup(&glContext, window);
         return 1;
     }
 
+    int frames = 0;
+    Uint64 benchStart = SDL_GetPerformanceCounter();
+
     SDL_Event event;
     bool quit = false;
     while (!quit) {
@@ -95,16 +157,42 @@ int main() {
         glClearColor(0.f, 0.f, 0.f, 1.f);
         glClear(GL_COLOR_BUFFER_BIT);
 
-        // drawing a square
-        glBegin(GL_QUADS);
-        glVertex2f(-0.5f, -0.5f);
-        glVertex2f(0.5f, -0.5f);
-        glVertex2f(0.5f, 0.5f);
-        glVertex2f(-0.5f, 0.5f);
-        glEnd();
+        if (benchQuads > 0) {
+            drawQuadGrid(benchQuads);
+        } else {
+            // drawing a square
+            glBegin(GL_QUADS);
+            glVertex2f(-0.5f, -0.5f);
+            glVertex2f(0.5f, -0.5f);
+            glVertex2f(0.5f, 0.5f);
+            glVertex2f(-0.5f, 0.5f);
+            glEnd();
+        }
 
+        imFlush();
         SDL_GL_SwapWindow(window);
+
+        if (benchQuads > 0 && ++frames == BENCH_FRAMES) {
+            quit = true;
+        }
+    }
+
+    if (benchQuads > 0) {
+        glFinish();
+        double ms = (double) (SDL_GetPerformanceCounter() - benchStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        ImStats stats = imGetStats();
+        cout << (core ? "Batched" : "Native") << " immediate mode, " << benchQuads << " quads: "
+             << ms / frames << " ms/frame";
+        if (core) {
+            cout << ", " << (double) stats.drawCalls / frames << " draw calls/frame, "
+                 << stats.vertices / frames << " vertices/frame";
+        }
+        cout << endl;
     }
 
+    imShutdown();
+    cleanup(&glContext, window);
+    SDL_Quit();
+
     return 0;
 }
@@ -2,76 +2,193 @@
 // Created by Silvio Fragnani da Silva on 20/03/16.
 //
 #include <iostream>
+#include <cstring>
+#include <string>
+#include <vector>
 #include <GL/glew.h>
 #include <SDL.h>
 #include <Cleanup.h>
 #include <Timer.h>
+#include <InputRecorder.h>
+#include <Physics.h>
+#include <Metrics.h>
+// the glBegin/glEnd calls below go through the emulation layer
+#define IMMEDIATE_MODE_REDIRECT
+#include <ImmediateMode.h>
 
 using namespace std;
 
-// http://gafferongames.com/game-physics/fix-your-timestep/
-struct State {
-    float x;
-    float v;
-};
-
-struct Derivative {
-    float dx;
-    float dv;
-};
-
-State interpolate(const State &previous, const State &current, float alpha) {
-    State state;
-    state.x = current.x * alpha + previous.x * (1 - alpha);
-    state.v = current.v * alpha + previous.v * (1 - alpha);
-    return state;
-}
+// simulation vars
+State current;
+State previous;
+
+float t = 0.0f;
+const float dt = 0.1f;
+
+float currentTime = 0.0f;
+float accumulator = 0.0f;
 
-float acceleration(const State &state, float t) {
-    const float k = 10;
-    const float b = 1;
-    return -k * state.x - b * state.v;
+// game loop vars
+bool quit = false;
+int countedFrames = 1;
+Timer fpsTimer;
+
+// --metrics /name, frame metrics for MetricsReader
+MetricsPublisher metrics;
+
+// input recording / replay
+InputRecorder recorder;
+unsigned long long stateChecksum = fnv1a(nullptr, 0);
+
+void resetSimulation() {
+    current.x = 1;
+    current.v = 0;
+    previous = current;
+    t = 0.0f;
+    accumulator = 0.0f;
 }
 
-Derivative evaluate(const State &initial, float t) {
-    Derivative output;
-    output.dx = initial.v;
-    output.dv = acceleration(initial, t);
-    return output;
+void eventHandler(const SDL_Event &event) {
+    recorder.recordEvent(event);
+
+    if (event.type == SDL_QUIT) {
+        quit = true;
+    }
+    if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_r) {
+        accumulator = 0.0f;
+        current.x = 100;
+        current.v = 0;
+        previous = current;
+    }
+
+    if (event.type == SDL_WINDOWEVENT) {
+        switch (event.window.event) {
+            case SDL_WINDOWEVENT_SHOWN:
+                SDL_Log("Window %d shown", event.window.windowID);
+                break;
+            case SDL_WINDOWEVENT_HIDDEN:
+                SDL_Log("Window %d hidden", event.window.windowID);
+                break;
+            case SDL_WINDOWEVENT_RESTORED:
+                SDL_Log("Window %d restored", event.window.windowID);
+                break;
+
+            case SDL_WINDOWEVENT_FOCUS_GAINED:
+                countedFrames = 1;
+                fpsTimer.start();
+
+                break;
+            case SDL_WINDOWEVENT_FOCUS_LOST:
+                fpsTimer.stop();
+                break;
+        }
+    }
 }
 
-Derivative evaluate(const State &initial, float t, float dt, const Derivative &d) {
-    State state;
-    state.x = initial.x + d.dx * dt;
-    state.v = initial.v + d.dv * dt;
-    Derivative output;
-    output.dx = state.v;
-    output.dv = acceleration(state, t + dt);
-    return output;
+// fixed step loop, returns the state to draw
+State simulate(float deltaTime) {
+    recorder.endFrame(deltaTime);
+
+    if (deltaTime > 0.25f)
+        deltaTime = 0.25f;
+
+    accumulator += deltaTime / 2;
+
+    while (accumulator >= dt) {
+        accumulator -= dt;
+        previous = current;
+        integrate(current, t, dt);
+        t += dt;
+        metrics.addSimulationSteps(1);
+    }
+
+    State state = interpolate(previous, current, accumulator / dt);
+
+    // every bit of the simulation goes in the checksum
+    stateChecksum = fnv1a(&current, sizeof(current), stateChecksum);
+    stateChecksum = fnv1a(&previous, sizeof(previous), stateChecksum);
+    stateChecksum = fnv1a(&state, sizeof(state), stateChecksum);
+    stateChecksum = fnv1a(&t, sizeof(t), stateChecksum);
+    stateChecksum = fnv1a(&accumulator, sizeof(accumulator), stateChecksum);
+    return state;
 }
 
-void integrate(State &state, float t, float dt) {
-    Derivative a = evaluate(state, t);
-    Derivative b = evaluate(state, t, dt * 0.5f, a);
-    Derivative c = evaluate(state, t, dt * 0.5f, b);
-    Derivative d = evaluate(state, t, dt, c);
+// feeds a recording through eventHandler() and simulate() as fast as possible
+int replay(const string &path) {
+    InputPlayer player;
+    if (!player.open(path)) {
+        return 1;
+    }
+
+    float deltaTime;
+    vector<SDL_Event> events;
+    int frames = 0;
 
-    const float dxdt = 1.0f / 6.0f * (a.dx + 2.0f * (b.dx + c.dx) + d.dx);
-    const float dvdt = 1.0f / 6.0f * (a.dv + 2.0f * (b.dv + c.dv) + d.dv);
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (!quit && player.nextFrame(deltaTime, events)) {
+        for (size_t i = 0; i < events.size(); i++) {
+            eventHandler(events[i]);
+        }
+        simulate(deltaTime);
+        frames++;
+    }
+    double seconds = (double) (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
 
-    state.x = state.x + dxdt * dt;
-    state.v = state.v + dvdt * dt;
+    cout << "Replayed " << frames << " frames in " << seconds * 1000.0 << " ms ("
+         << frames / seconds << " frames/sec)" << endl;
+    cout << "State checksum " << hex << stateChecksum << dec << endl;
+    return 0;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
+    string recordPath;
+    string replayPath;
+    bool core = false;
+    string metricsName;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            recordPath = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replayPath = argv[++i];
+        } else if (strcmp(argv[i], "--core") == 0) {
+            core = true;
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsName = argv[++i];
+        } else {
+            cout << "usage: " << argv[0] << " [--core] [--metrics /name] [--record file | --replay file]" << endl;
+            return 1;
+        }
+    }
+
+    resetSimulation();
+
+    // headless, no window or GL needed
+    if (!replayPath.empty()) {
+        return replay(replayPath);
+    }
+
+    if (!recordPath.empty() && !recorder.open(recordPath)) {
+        return 1;
+    }
+
+    if (!metricsName.empty() && !metrics.open(metricsName)) {
+        return 1;
+    }
+
     if (SDL_Init(SDL_INIT_VIDEO) != 0) {
         cout << "SDL_Init error " << SDL_GetError() << endl;
         return 1;
     }
 
-    // set GL version
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
-    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    // set GL version, glBegin/glEnd are emulated on the core profile
+    if (core) {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+    } else {
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 2);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    }
 
     // create window
     SDL_Window *window = SDL_CreateWindow("SDL with OpenGL",
@@ -106,77 +223,44 @@ int main() {
     // initialize GLEW
     //////////////////////////////////
     GLenum error = GL_NO_ERROR;
+    glewExperimental = GL_TRUE;
     error = glewInit();
     if (GLEW_OK != error) {
         cleanup(window);
         cout << "glewInit error: " << glewGetErrorString(error) << endl;
         return 1;
     }
+    // glewInit may leave GL_INVALID_ENUM behind on core profiles
+    glGetError();
 
-    glMatrixMode(GL_PROJECTION);
-    glLoadIdentity();
+    if (!core) {
+        glMatrixMode(GL_PROJECTION);
+        glLoadIdentity();
 
-    glMatrixMode(GL_MODELVIEW);
-    glLoadIdentity();
+        glMatrixMode(GL_MODELVIEW);
+        glLoadIdentity();
 
-    glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
-    glEnable(GL_POINT_SMOOTH);
+        // core profiles only have square points
+        glHint(GL_POINT_SMOOTH_HINT, GL_NICEST);
+        glEnable(GL_POINT_SMOOTH);
+    }
+
+    if (!imInit(core ? IM_BACKEND_BATCHED : IM_BACKEND_NATIVE)) {
+        cleanup(&glContext, window);
+        SDL_Quit();
+        return 1;
+    }
     glPointSize(4);
 
     glClearColor(0.3f, 0.3f, 0.3f, 1);
 
-    int countedFrames = 1;
-    Timer fpsTimer;
     fpsTimer.start();
 
-    State current;
-    current.x = 1;
-    current.v = 0;
-
-    State previous = current;
-
-    float t = 0.0f;
-    float dt = 0.1f;
-
-    float currentTime = 0.0f;
-    float accumulator = 0.0f;
-
     SDL_Event event;
-    bool quit = false;
+    Uint64 frameStart = SDL_GetPerformanceCounter();
     while (!quit) {
         while (SDL_PollEvent(&event)) {
-            if (event.type == SDL_QUIT) {
-                quit = true;
-            }
-            if (event.key.keysym.sym == SDLK_r) {
-                accumulator = 0.0f;
-                current.x = 100;
-                current.v = 0;
-                previous = current;
-            }
-
-            if (event.type == SDL_WINDOWEVENT) {
-                switch (event.window.event) {
-                    case SDL_WINDOWEVENT_SHOWN:
-                        SDL_Log("Window %d shown", event.window.windowID);
-                        break;
-                    case SDL_WINDOWEVENT_HIDDEN:
-                        SDL_Log("Window %d hidden", event.window.windowID);
-                        break;
-                    case SDL_WINDOWEVENT_RESTORED:
-                        SDL_Log("Window %d restored", event.window.windowID);
-                        break;
-
-                    case SDL_WINDOWEVENT_FOCUS_GAINED:
-                        countedFrames = 1;
-                        fpsTimer.start();
-
-                        break;
-                    case SDL_WINDOWEVENT_FOCUS_LOST:
-                        fpsTimer.stop();
-                        break;
-                }
-            }
+            eventHandler(event);
         }
 
         if (countedFrames != 0 && fpsTimer.getTicks() != 0) {
@@ -192,29 +276,32 @@ int main() {
         float deltaTime = newTime - currentTime;
         currentTime = newTime;
 
-        if (deltaTime > 0.25f)
-            deltaTime = 0.25f;
-
-        accumulator += deltaTime / 2;
-
-        while (accumulator >= dt) {
-            accumulator -= dt;
-            previous = current;
-            integrate(current, t, dt);
-            t += dt;
-        }
-
-        State state = interpolate(previous, current, accumulator / dt);
+        State state = simulate(deltaTime);
 
         glBegin(GL_POINTS);
         glColor3f(1, 1, 1);
         glVertex3f(state.x, 0, 0);
         glEnd();
 
+        imFlush();
         SDL_GL_SwapWindow(window);
+
+        // deltaTime only has millisecond resolution
+        Uint64 now = SDL_GetPerformanceCounter();
+        metrics.addDrawCalls((uint32_t) imGetStats().drawCalls);
+        imResetStats();
+        metrics.endFrame((now - frameStart) * 1000.0 / SDL_GetPerformanceFrequency());
+        frameStart = now;
+    }
+
+    if (!recordPath.empty()) {
+        recorder.close();
+        cout << "Recorded " << recorder.getFrames() << " frames to " << recordPath << endl;
+        cout << "State checksum " << hex << stateChecksum << dec << endl;
     }
 
     // Clean up everything
+    imShutdown();
     cleanup(&glContext, window);
     SDL_Quit();
 
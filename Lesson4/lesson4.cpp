@@ -1,19 +1,163 @@
 //
 // Created by Silvio Fragnani da Silva on 20/03/16.
 //
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
 #include <GL/glew.h>
 #include <SDL.h>
 #include <Cleanup.h>
 #include <Timer.h>
+#include <SoftRasterizer.h>
+#include <FrameCapture.h>
+#include <MeshFile.h>
+#include <ShaderReloader.h>
+#include <FramePipeline.h>
+#include <Metrics.h>
+#include <TextOverlay.h>
 
 using namespace std;
 
+const int SCREEN_WIDTH = 600;
+const int SCREEN_HEIGHT = 600;
+
+// Vertex Buffer Object (VBO) Data
+const GLfloat gVertexData1[] = {
+        0.0f, 0.5f, 0.0f,
+        0.5f, -0.5f, 0.0f,
+        -0.5f, -0.5f, 0.0f
+};
+
+const GLfloat gVertexData2[] = {
+        0.7f, 0.7f, 0.0f,
+        0.9f, 0.5f, 0.0f,
+        0.5f, 0.5f, 0.0f
+};
+
+#ifndef LESSON4_SHADER_DIR
+#define LESSON4_SHADER_DIR "shaders"
+#endif
+
 // GL vars
-GLuint gProgramId = 0;
 GLuint gVAO1 = 0;
 GLuint gVAO2 = 0;
 
+// shader programs, rebuilt when the files change
+ShaderReloader *gShaderReloader = nullptr;
+int gTriangleShader = -1;
+int gMeshShader = -1;
+
+// frames rendered while a shader rebuild was in flight, and how slow they were
+int gReloadFrames = 0;
+int gReloadHitches = 0;
+double gReloadMaxFrameMs = 0.0;
+// for comparison, the slowest frame without a rebuild going on
+double gOtherMaxFrameMs = 0.0;
+double gHitchThresholdMs = 33.3;
+
+// binary mesh (--mesh), drawn instead of the triangles when loaded
+GLuint gMeshVAO = 0;
+GLfloat gMeshCenter[3] = {0.f, 0.f, 0.f};
+GLfloat gMeshScale = 1.f;
+GLfloat gMeshDecodeScale[3] = {1.f, 1.f, 1.f};
+GLfloat gMeshDecodeOffset[3] = {0.f, 0.f, 0.f};
+GLenum gMeshIndexType = GL_UNSIGNED_INT;
+GLsizei gMeshIndexSize = 4;
+vector<MeshSubmesh> gMeshSubmeshes;
+// uniform locations of the mesh program, looked up again when a reload swaps it
+struct MeshUniforms {
+    GLuint program;
+    GLint center;
+    GLint scale;
+    GLint decodeScale;
+    GLint decodeOffset;
+};
+MeshUniforms gMeshUniforms = {0, -1, -1, -1, -1};
+
+// software rendering, used instead of GL when set
+SoftRasterizer *gSoftRasterizer = nullptr;
+
+// frame capture, toggled with 'c'
+FrameCapture *gFrameCapture = nullptr;
+bool gCaptureEnabled = false;
+bool gVsync = true;
+
+// frame time totals with capture off [0] and on [1]
+double gFrameTimeMs[2] = {0.0, 0.0};
+int gFrameTimeCount[2] = {0, 0};
+
+// one draw recorded by the main thread, replayed on the render thread
+struct DrawCommand {
+    int shader;
+    // 0 draws from the frame's streamed vertices
+    GLuint vao;
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+    // glDrawElements when not 0
+    GLenum indexType;
+    size_t indexOffset;
+};
+
+// everything the render thread needs to draw one frame
+struct FramePacket {
+    vector<GLfloat> vertices;
+    vector<DrawCommand> commands;
+    bool capture;
+    vector<TextVertex> overlay;
+};
+
+// pipelined frames (--frames-in-flight), one packet and vertex buffer per slot
+FramePacket gPackets[FramePipeline::MAX_FRAMES_IN_FLIGHT];
+GLuint gFrameVAO[FramePipeline::MAX_FRAMES_IN_FLIGHT];
+GLuint gFrameVBO[FramePipeline::MAX_FRAMES_IN_FLIGHT];
+// busy work standing in for game logic, per frame
+double gSimulationMs = 0.0;
+// pipelined frames: the small triangle follows the mouse, so input shows up on screen
+bool gPointerSeen = false;
+GLfloat gPointer[2] = {0.f, 0.f};
+// capture state on the rendering side, to flush when it gets turned off
+bool gCaptureActive = false;
+
+// --metrics /name, frame metrics for MetricsReader
+MetricsPublisher gMetrics;
+// GPU time of a frame, read a few frames later so nothing waits on the GPU
+const int GPU_TIMER_QUERIES = 4;
+GLuint gGpuTimerQueries[GPU_TIMER_QUERIES];
+int gGpuTimerFrames = 0;
+// written on the rendering thread, published by the main thread
+std::atomic<GLuint64> gGpuTimeNs(0);
+// bytes of the GL buffers created
+uint64_t gBufferBytes = 0;
+// draws of the frame being made, and of the last finished one
+uint32_t gFrameDrawCalls = 0;
+uint32_t gLastDrawCalls = 0;
+
+// on-screen stats (--overlay), toggled with 'o'
+TextOverlay *gOverlay = nullptr;
+bool gOverlayEnabled = false;
+// frame times for the graph, a ring starting at gFrameHistoryNext
+const int FRAME_HISTORY = 120;
+float gFrameHistory[FRAME_HISTORY] = {0.f};
+int gFrameHistoryNext = 0;
+// the stats are rebuilt 4 times a second, faster than that nobody can read them
+const double OVERLAY_REFRESH_MS = 250.0;
+Uint64 gOverlayBuiltAt = 0;
+// overlay CPU time: building on the main thread, drawing on the rendering one
+double gOverlayBuildMs = 0.0;
+std::atomic<double> gOverlayDrawMs(0.0);
+// copied on the rendering thread, which owns the reloader and the overlay's GL state
+std::atomic<int> gShaderReloads(0);
+std::atomic<double> gOverlayGpuMs(0.0);
+double gOverlayTotalMs = 0.0;
+int gOverlayFrames = 0;
+
 // game loop vars
 bool quit = false;
 SDL_Event event;
@@ -40,7 +184,7 @@ void setOpenGLVersion() {
 SDL_Window *createSDLWindow() {
     SDL_Window *window = SDL_CreateWindow("SDL / OpenGL",
                                           SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-                                          600, 600,
+                                          SCREEN_WIDTH, SCREEN_HEIGHT,
                                           SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
 
     if (window == nullptr) {
@@ -62,7 +206,9 @@ SDL_GLContext initSDLGLContext(SDL_Window *window) {
     }
 
     // SDL_GL_SetSwapInterval(0) set immediate swap (high FPS)
-    if (SDL_GL_SetSwapInterval(1) != 0) {
+    if (!gVsync) {
+        SDL_GL_SetSwapInterval(0);
+    } else if (SDL_GL_SetSwapInterval(1) != 0) {
         cout << "Warning: unable to set VSync. Error " << SDL_GetError() << endl;
     }
 
@@ -82,156 +228,17 @@ bool initGLEW(SDL_Window *window) {
     return true;
 }
 
-void printShaderLog(GLuint shader) {
-    // make sure name is shader
-    if (glIsShader(shader)) {
-        // shader log length
-        int infoLogLength = 0;
-        int maxLength = infoLogLength;
-
-        // get info string length
-        glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &maxLength);
-
-        // allocate string
-        char *infoLog = new char[maxLength];
-
-        // get info log
-        glGetShaderInfoLog(shader, maxLength, &infoLogLength, infoLog);
-        if (infoLogLength > 0) {
-            cout << infoLog << endl;
-        }
-
-        // deallocate string
-        delete[] infoLog;
-
-    } else {
-        cout << "Name " << shader << " is not a shader" << endl;
-    }
-}
-
-void printProgramLog(GLuint program) {
-    // make sure name is shader
-    if (glIsProgram(program)) {
-        // program log length
-        int infoLogLength = 0;
-        int maxLength = infoLogLength;
-
-        // get info string length
-        glGetProgramiv(program, GL_INFO_LOG_LENGTH, &maxLength);
-
-        // allocate string
-        char *infoLog = new char[maxLength];
-
-        // get info log
-        glGetProgramInfoLog(program, maxLength, &infoLogLength, infoLog);
-        if (infoLogLength > 0) {
-            // print Log
-            cout << infoLog << endl;
-        }
-
-        // deallocate string
-        delete[] infoLog;
-    } else {
-        cout << "Name " << program << " is not a program" << endl;
-    }
-}
-
 bool initGLStructure() {
-    // create program id
-    gProgramId = glCreateProgram();
-
-    //////////////////
-    // VERTEX SHADER
-    //////////////////
-    // create vertex shader
-    GLuint vertexShaderId = glCreateShader(GL_VERTEX_SHADER);
-
-    // vertex shader source
-    const GLchar *vertexShaderSource[] = {
-            "#version 400\nin vec3 vp; void main() { gl_Position = vec4(vp, 1.0); }"
-    };
-
-    // set vertex shader source
-    glShaderSource(vertexShaderId, 1, vertexShaderSource, NULL);
-
-    // compile vertex shader
-    glCompileShader(vertexShaderId);
-
-    // check vertex shader error
-    GLint shaderCompiled = GL_FALSE;
-    glGetShaderiv(vertexShaderId, GL_COMPILE_STATUS, &shaderCompiled);
-    if (shaderCompiled != GL_TRUE) {
-        cout << "Unable to compile vertex shader\n" << vertexShaderId << endl;
-        printShaderLog(vertexShaderId);
-        return false;
-    }
-
-    // attach vertex shader to program
-    glAttachShader(gProgramId, vertexShaderId);
-
-    ////////////////////
-    // FRAGMENT SHADER
-    ////////////////////
-    // create fragment shader id
-    GLuint fragmentShaderId = glCreateShader(GL_FRAGMENT_SHADER);
-
-    // get fragment shader source
-    const GLchar *fragmentShaderSource[]{
-            "#version 400\nout vec4 frag_colour; void main() { frag_colour = vec4(0.0, 1.0, 0.0, 1.0); }"
-    };
-
-    // set fragment shader source
-    glShaderSource(fragmentShaderId, 1, fragmentShaderSource, NULL);
-
-    // compile fragment shader
-    glCompileShader(fragmentShaderId);
-
-    // check fragment shader errors
-    shaderCompiled = GL_FALSE;
-    glGetShaderiv(fragmentShaderId, GL_COMPILE_STATUS, &shaderCompiled);
-    if (shaderCompiled != GL_TRUE) {
-        cout << "Unable to compile fragment shader" << vertexShaderId << endl;
-        printShaderLog(fragmentShaderId);
-        return false;
-    }
-
-    // attach fragment shader
-    glAttachShader(gProgramId, fragmentShaderId);
-
-    // link program
-    glLinkProgram(gProgramId);
-
-    // check program errors
-    GLint programSuccess = GL_TRUE;
-    glGetProgramiv(gProgramId, GL_LINK_STATUS, &programSuccess);
-    if (programSuccess != GL_TRUE) {
-        cout << "Error linking program " << gProgramId << endl;
-        printProgramLog(gProgramId);
-        return false;
-    }
-
-    return true;
+    gTriangleShader = gShaderReloader->load("triangle.vert", "triangle.frag");
+    return gTriangleShader >= 0;
 }
 
 void loadGlData() {
-    // Vertex Buffer Object (VBO) Data
-    GLfloat vertexData1[] = {
-            0.0f, 0.5f, 0.0f,
-            0.5f, -0.5f, 0.0f,
-            -0.5f, -0.5f, 0.0f
-    };
-
-    GLfloat vertexData2[] = {
-            0.7f, 0.7f, 0.0f,
-            0.9f, 0.5f, 0.0f,
-            0.5f, 0.5f, 0.0f
-    };
-
     GLuint gVBO1, gVBO2;
     // create VBO1
     glGenBuffers(1, &gVBO1);
     glBindBuffer(GL_ARRAY_BUFFER, gVBO1);
-    glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), vertexData1, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), gVertexData1, GL_STATIC_DRAW);
 
     // create VAO1
     glGenVertexArrays(1, &gVAO1);
@@ -243,7 +250,8 @@ void loadGlData() {
     // create VBO2
     glGenBuffers(1, &gVBO2);
     glBindBuffer(GL_ARRAY_BUFFER, gVBO2);
-    glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), vertexData2, GL_STATIC_DRAW);
+    glBufferData(GL_ARRAY_BUFFER, 9 * sizeof(GLfloat), gVertexData2, GL_STATIC_DRAW);
+    gBufferBytes += 18 * sizeof(GLfloat);
 
     // create VAO2
     glGenVertexArrays(1, &gVAO2);
@@ -253,12 +261,132 @@ void loadGlData() {
     glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
 }
 
+// attribute format matching the stream encoding
+void setMeshAttribute(GLuint location, const MeshStream &stream) {
+    GLint size = (GLint) stream.components;
+    GLenum type = GL_FLOAT;
+    GLboolean normalized = GL_FALSE;
+    switch (stream.format) {
+        case MESH_FORMAT_SNORM16:
+            type = GL_SHORT;
+            normalized = GL_TRUE;
+            break;
+        case MESH_FORMAT_HALF:
+            type = GL_HALF_FLOAT;
+            break;
+        case MESH_FORMAT_SNORM_10_10_10_2:
+            // packed types are always read as 4 components
+            size = 4;
+            type = GL_INT_2_10_10_10_REV;
+            normalized = GL_TRUE;
+            break;
+        default:
+            break;
+    }
+    glVertexAttribPointer(location, size, type, normalized, (GLsizei) stream.stride, NULL);
+}
+
+// maps the mesh file and uploads the streams straight from the mapping
+bool loadMesh(const string &path) {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    MeshFile meshFile;
+    if (!meshFile.open(path)) {
+        return false;
+    }
+    const MeshFileHeader &header = meshFile.getHeader();
+    const MeshStream *positions = meshFile.findStream(MESH_ATTRIBUTE_POSITION);
+    if (positions == nullptr || positions->format == MESH_FORMAT_SNORM_10_10_10_2) {
+        cout << path << " has no usable positions" << endl;
+        return false;
+    }
+
+    // fit the bounding box into clip space
+    GLfloat extent = 0.f;
+    for (int i = 0; i < 3; i++) {
+        gMeshCenter[i] = (header.boundsMin[i] + header.boundsMax[i]) * 0.5f;
+        extent = max(extent, header.boundsMax[i] - header.boundsMin[i]);
+        gMeshDecodeScale[i] = positions->decodeScale[i];
+        gMeshDecodeOffset[i] = positions->decodeOffset[i];
+    }
+    gMeshScale = extent > 0.f ? 1.8f / extent : 1.f;
+
+    gMeshShader = gShaderReloader->load("mesh.vert", "mesh.frag");
+    if (gMeshShader < 0) {
+        return false;
+    }
+
+    glGenVertexArrays(1, &gMeshVAO);
+    glBindVertexArray(gMeshVAO);
+
+    // one buffer per stream, no intermediate copy
+    const MeshAttribute attributes[2] = {MESH_ATTRIBUTE_POSITION, MESH_ATTRIBUTE_NORMAL};
+    for (GLuint location = 0; location < 2; location++) {
+        const MeshStream *stream = meshFile.findStream(attributes[location]);
+        if (stream == nullptr) {
+            glVertexAttrib3f(location, 0.f, 0.f, 0.f);
+            continue;
+        }
+        GLuint vbo;
+        glGenBuffers(1, &vbo);
+        glBindBuffer(GL_ARRAY_BUFFER, vbo);
+        glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) stream->bytes, meshFile.getStreamData(*stream), GL_STATIC_DRAW);
+        gBufferBytes += stream->bytes;
+        glEnableVertexAttribArray(location);
+        setMeshAttribute(location, *stream);
+    }
+
+    // the element buffer binding is part of the VAO
+    GLuint ebo;
+    glGenBuffers(1, &ebo);
+    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, (GLsizeiptr) header.indexBytes, meshFile.getIndexData(), GL_STATIC_DRAW);
+    gBufferBytes += header.indexBytes;
+    glBindVertexArray(0);
+
+    gMeshIndexSize = (GLsizei) header.indexSize;
+    gMeshIndexType = header.indexSize == 2 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT;
+    gMeshSubmeshes.clear();
+    for (uint32_t i = 0; i < header.submeshCount; i++) {
+        gMeshSubmeshes.push_back(meshFile.getSubmesh((int) i));
+    }
+
+    // wait for the upload so the time covers it
+    glFinish();
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    uint32_t bytesPerVertex = 0;
+    for (uint32_t i = 0; i < header.streamCount; i++) {
+        bytesPerVertex += meshFile.getStream((int) i).stride;
+    }
+    cout << "Loaded " << path << " (" << header.vertexCount << " vertices, " << header.indexCount / 3
+         << " triangles, " << bytesPerVertex << " bytes per vertex, " << meshFile.getFileSize() / 1024
+         << " KB) in " << ms << " ms" << endl;
+    return true;
+}
+
 void eventHandler() {
     while (SDL_PollEvent(&event)) {
         if (event.type == SDL_QUIT) {
             quit = true;
         }
 
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_o && gOverlay != nullptr) {
+            gOverlayEnabled = !gOverlayEnabled;
+            gOverlayBuiltAt = 0;
+        }
+
+        // toggle frame capture, the ring is flushed by updateCapture()
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_c && gFrameCapture != nullptr) {
+            gCaptureEnabled = !gCaptureEnabled;
+            cout << "Capture " << (gCaptureEnabled ? "on" : "off") << endl;
+        }
+
+        if (event.type == SDL_MOUSEMOTION) {
+            gPointerSeen = true;
+            gPointer[0] = event.motion.x * 2.f / SCREEN_WIDTH - 1.f;
+            gPointer[1] = 1.f - event.motion.y * 2.f / SCREEN_HEIGHT;
+        }
+
         if (event.type == SDL_WINDOWEVENT) {
             switch (event.window.event) {
                 case SDL_WINDOWEVENT_SHOWN:
@@ -291,32 +419,409 @@ void calculatePrintFps() {
         float avgFPS = countedFrames / (ticks / 1000.f);
         countedFrames++;
 
+        // the overlay shows it, no need for the console
         int ticksModule = ticks % 1000;
-        if (ticksModule >= 0 && ticksModule <= 12) {
+        if (!gOverlayEnabled && ticksModule >= 0 && ticksModule <= 12) {
             cout << "FPS " << avgFPS << endl;
         }
     }
 }
 
+void renderSoftware() {
+    const float green[4] = {0.f, 1.f, 0.f, 1.f};
+
+    // same frame as the GL path, triangle fans of 3 vertices are single triangles
+    gSoftRasterizer->clear(0.f, 0.f, 1.f, 1.f);
+    gSoftRasterizer->drawTriangles(gVertexData1, 3, green);
+    gSoftRasterizer->drawTriangles(gVertexData2, 3, green);
+    gSoftRasterizer->finish();
+}
+
+// binds the shader, call it only when the shader changes between draws
+void useShader(int shader) {
+    GLuint program = gShaderReloader->getProgram(shader);
+    glUseProgram(program);
+    if (shader == gMeshShader) {
+        if (program != gMeshUniforms.program) {
+            gMeshUniforms.program = program;
+            gMeshUniforms.center = glGetUniformLocation(program, "center");
+            gMeshUniforms.scale = glGetUniformLocation(program, "scale");
+            gMeshUniforms.decodeScale = glGetUniformLocation(program, "decodeScale");
+            gMeshUniforms.decodeOffset = glGetUniformLocation(program, "decodeOffset");
+        }
+        // a reloaded program starts with default uniforms, so set them every frame
+        glUniform3fv(gMeshUniforms.center, 1, gMeshCenter);
+        glUniform1f(gMeshUniforms.scale, gMeshScale);
+        glUniform3fv(gMeshUniforms.decodeScale, 1, gMeshDecodeScale);
+        glUniform3fv(gMeshUniforms.decodeOffset, 1, gMeshDecodeOffset);
+    }
+}
+
+// starts timing the frame's GL commands, with the result of an older frame
+// collected first when the GPU has it ready
+void beginGpuTimer() {
+    if (!gMetrics.isOpen()) {
+        return;
+    }
+    GLuint query = gGpuTimerQueries[gGpuTimerFrames % GPU_TIMER_QUERIES];
+    if (gGpuTimerFrames >= GPU_TIMER_QUERIES) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(query, GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_TRUE) {
+            GLuint64 ns = 0;
+            glGetQueryObjectui64v(query, GL_QUERY_RESULT, &ns);
+            gGpuTimeNs = ns;
+        }
+    }
+    glBeginQuery(GL_TIME_ELAPSED, query);
+}
+
+void endGpuTimer() {
+    if (!gMetrics.isOpen()) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    gGpuTimerFrames++;
+}
+
+// main thread, once the frame is done
+void recordFrameStats(double frameMs) {
+    gFrameHistory[gFrameHistoryNext] = (float) frameMs;
+    gFrameHistoryNext = (gFrameHistoryNext + 1) % FRAME_HISTORY;
+    gLastDrawCalls = gFrameDrawCalls;
+    gFrameDrawCalls = 0;
+
+    gMetrics.addDrawCalls(gLastDrawCalls);
+    gMetrics.setGpuTimeMs(gGpuTimeNs / 1e6);
+    gMetrics.setMemoryBytes(gBufferBytes);
+    gMetrics.endFrame(frameMs);
+}
+
+// the stats of the last frames, as overlay vertices
+void buildOverlay() {
+    Uint64 start = SDL_GetPerformanceCounter();
+
+    const GLubyte white[4] = {255, 255, 255, 255};
+    const GLubyte graphColor[4] = {90, 220, 90, 255};
+    const GLubyte targetColor[4] = {220, 90, 90, 255};
+    const float graphMaxMs = 33.3f;
+
+    float ordered[FRAME_HISTORY];
+    float totalMs = 0.f;
+    float maxMs = 0.f;
+    for (int i = 0; i < FRAME_HISTORY; i++) {
+        ordered[i] = gFrameHistory[(gFrameHistoryNext + i) % FRAME_HISTORY];
+        totalMs += ordered[i];
+        maxMs = max(maxMs, ordered[i]);
+    }
+    const float lastMs = ordered[FRAME_HISTORY - 1];
+
+    const float x = 8.f;
+    const float lineHeight = (float) gOverlay->getLineHeight();
+    const float graphWidth = (float) FRAME_HISTORY;
+    const float graphHeight = 16.f;
+    float y = 8.f;
+
+    // Two short lines and no backdrop: software GL bills the overlay by the pixel, every frame. Its own cost is in
+    // the exit report.
+    gOverlay->begin();
+
+    char line[96];
+    snprintf(line, sizeof(line), "FPS %.1f %.2f ms max %.1f", totalMs > 0.f ? 1000.f * FRAME_HISTORY / totalMs : 0.f,
+             lastMs, maxMs);
+    gOverlay->text(x, y, line, white);
+    y += lineHeight;
+    snprintf(line, sizeof(line), "draws %u %lluKB reloads %d%s", gLastDrawCalls,
+             (unsigned long long) (gBufferBytes / 1024), gShaderReloads.load(), gCaptureEnabled ? " capture" : "");
+    gOverlay->text(x, y, line, white);
+    y += lineHeight + 2.f;
+
+    gOverlay->graph(x, y, graphWidth, graphHeight, ordered, FRAME_HISTORY, graphMaxMs, graphColor);
+    // 60 Hz
+    gOverlay->rect(x, y + graphHeight * (1.f - 16.7f / graphMaxMs), graphWidth, 1.f, targetColor);
+
+    gOverlayBuildMs = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    gOverlayTotalMs += gOverlayBuildMs;
+}
+
+// main thread, every frame the overlay is on: rebuilds it when the last build is old enough
+void updateOverlay() {
+    Uint64 now = SDL_GetPerformanceCounter();
+    double sinceBuildMs = (now - gOverlayBuiltAt) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (gOverlayBuiltAt == 0 || sinceBuildMs >= OVERLAY_REFRESH_MS) {
+        buildOverlay();
+        gOverlayBuiltAt = now;
+    }
+    gOverlayFrames++;
+}
+
+// draws the overlay built for this frame, on the thread owning the context
+void drawOverlay(const vector<TextVertex> &vertices) {
+    Uint64 start = SDL_GetPerformanceCounter();
+    gOverlay->draw(vertices, SCREEN_WIDTH, SCREEN_HEIGHT);
+    double ms = (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    gOverlayDrawMs = ms;
+    gOverlayGpuMs = gOverlay->getGpuMs();
+}
+
 void render() {
+    if (gSoftRasterizer != nullptr) {
+        renderSoftware();
+        return;
+    }
+
     // initialize clear color
     glClearColor(0.f, 0.f, 1.f, 1.f);
     // wipe the drawing surface clear
     glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
+    if (gMeshVAO != 0) {
+        glEnable(GL_DEPTH_TEST);
+        useShader(gMeshShader);
+        glBindVertexArray(gMeshVAO);
+        for (size_t i = 0; i < gMeshSubmeshes.size(); i++) {
+            glDrawElements(GL_TRIANGLES, (GLsizei) gMeshSubmeshes[i].indexCount, gMeshIndexType,
+                           (const GLvoid *) ((size_t) gMeshSubmeshes[i].firstIndex * gMeshIndexSize));
+        }
+        gFrameDrawCalls += (uint32_t) gMeshSubmeshes.size();
+        glBindVertexArray(0);
+        glUseProgram(NULL);
+        return;
+    }
+
     // bind program
-    glUseProgram(gProgramId);
+    glUseProgram(gShaderReloader->getProgram(gTriangleShader));
     glBindVertexArray(gVAO1);
     // draw points 0-3 from the currently bound VAO with current in-use shader
     glDrawArrays(GL_TRIANGLE_FAN, 0, 3);
 
     glBindVertexArray(gVAO2);
     glDrawArrays(GL_TRIANGLE_FAN, 0, 3);
+    gFrameDrawCalls += 2;
 
     // unbind program
     glUseProgram(NULL);
 }
 
+// captures the frame, or flushes the ring once capture was turned off
+void updateCapture(bool enabled) {
+    if (gFrameCapture == nullptr) {
+        return;
+    }
+    if (enabled) {
+        gFrameCapture->capture();
+    } else if (gCaptureActive) {
+        gFrameCapture->flush();
+    }
+    gCaptureActive = enabled;
+}
+
+// keeps the CPU busy for --sim-ms, standing in for game logic
+void simulate() {
+    if (gSimulationMs <= 0.0) {
+        return;
+    }
+    Uint64 end = SDL_GetPerformanceCounter() + (Uint64) (gSimulationMs * SDL_GetPerformanceFrequency() / 1000.0);
+    while (SDL_GetPerformanceCounter() < end) {
+    }
+}
+
+// main thread: what render() draws, as data the render thread can replay
+void recordFrame(FramePacket &packet) {
+    packet.vertices.assign(gVertexData1, gVertexData1 + 9);
+    packet.vertices.insert(packet.vertices.end(), gVertexData2, gVertexData2 + 9);
+    if (gPointerSeen) {
+        // centre the small triangle on the pointer
+        for (int v = 0; v < 3; v++) {
+            packet.vertices[9 + v * 3] += gPointer[0] - 0.7f;
+            packet.vertices[9 + v * 3 + 1] += gPointer[1] - 0.5667f;
+        }
+    }
+
+    packet.commands.clear();
+    if (gMeshVAO != 0) {
+        for (size_t i = 0; i < gMeshSubmeshes.size(); i++) {
+            DrawCommand command = {gMeshShader, gMeshVAO, GL_TRIANGLES, 0, (GLsizei) gMeshSubmeshes[i].indexCount,
+                                   gMeshIndexType, (size_t) gMeshSubmeshes[i].firstIndex * gMeshIndexSize};
+            packet.commands.push_back(command);
+        }
+    } else {
+        DrawCommand first = {gTriangleShader, 0, GL_TRIANGLE_FAN, 0, 3, 0, 0};
+        DrawCommand second = {gTriangleShader, 0, GL_TRIANGLE_FAN, 3, 3, 0, 0};
+        packet.commands.push_back(first);
+        packet.commands.push_back(second);
+    }
+    packet.capture = gCaptureEnabled;
+}
+
+void loadFrameBuffers(int framesInFlight) {
+    glGenVertexArrays(framesInFlight, gFrameVAO);
+    glGenBuffers(framesInFlight, gFrameVBO);
+    for (int i = 0; i < framesInFlight; i++) {
+        glBindVertexArray(gFrameVAO[i]);
+        glBindBuffer(GL_ARRAY_BUFFER, gFrameVBO[i]);
+        glBufferData(GL_ARRAY_BUFFER, 18 * sizeof(GLfloat), NULL, GL_DYNAMIC_DRAW);
+        gBufferBytes += 18 * sizeof(GLfloat);
+        glEnableVertexAttribArray(0);
+        glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+// render thread: replays the packet of a slot
+void renderPacket(int slot) {
+    Uint64 frameStart = SDL_GetPerformanceCounter();
+    const FramePacket &packet = gPackets[slot];
+    bool reloading = gShaderReloader->update();
+    gShaderReloads = gShaderReloader->getReloads();
+
+    // the pipeline fenced the slot's previous frame, so the buffer is not in
+    // use anymore and the driver doesn't need to synchronize the write
+    glBindBuffer(GL_ARRAY_BUFFER, gFrameVBO[slot]);
+    GLsizeiptr size = packet.vertices.size() * sizeof(GLfloat);
+    void *mapped = glMapBufferRange(GL_ARRAY_BUFFER, 0, size, GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+    if (mapped != nullptr) {
+        memcpy(mapped, packet.vertices.data(), (size_t) size);
+        glUnmapBuffer(GL_ARRAY_BUFFER);
+    }
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    beginGpuTimer();
+    glClearColor(0.f, 0.f, 1.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+    if (gMeshVAO != 0) {
+        glEnable(GL_DEPTH_TEST);
+    }
+    int shader = -1;
+    for (size_t i = 0; i < packet.commands.size(); i++) {
+        const DrawCommand &command = packet.commands[i];
+        if (command.shader != shader) {
+            shader = command.shader;
+            useShader(shader);
+        }
+        glBindVertexArray(command.vao != 0 ? command.vao : gFrameVAO[slot]);
+        if (command.indexType != 0) {
+            glDrawElements(command.mode, command.count, command.indexType, (const GLvoid *) command.indexOffset);
+        } else {
+            glDrawArrays(command.mode, command.first, command.count);
+        }
+    }
+    glBindVertexArray(0);
+    glUseProgram(NULL);
+    endGpuTimer();
+
+    updateCapture(packet.capture);
+    if (!packet.overlay.empty()) {
+        drawOverlay(packet.overlay);
+    }
+
+    double frameMs = (SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+    if (reloading) {
+        gReloadFrames++;
+        gReloadMaxFrameMs = max(gReloadMaxFrameMs, frameMs);
+        if (frameMs > gHitchThresholdMs) {
+            gReloadHitches++;
+        }
+    } else {
+        gOtherMaxFrameMs = max(gOtherMaxFrameMs, frameMs);
+    }
+}
+
+/*
+ * Input, simulation and recording on this thread while the render thread
+ * draws and presents the previous frames. False when the render thread
+ * couldn't be started.
+ */
+bool runPipelined(SDL_Window *window, SDL_GLContext glContext, int framesInFlight) {
+    loadFrameBuffers(framesInFlight);
+
+    FramePipeline pipeline(framesInFlight);
+    if (!pipeline.start(window, glContext, renderPacket)) {
+        // the context is still current here
+        glDeleteBuffers(framesInFlight, gFrameVBO);
+        glDeleteVertexArrays(framesInFlight, gFrameVAO);
+        return false;
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    Uint64 frameStart = start;
+    while (!quit) {
+        int slot = pipeline.beginFrame();
+        // input is sampled as late as possible, once a slot is free
+        Uint64 inputTime = SDL_GetPerformanceCounter();
+        eventHandler();
+        calculatePrintFps();
+        simulate();
+        recordFrame(gPackets[slot]);
+        gFrameDrawCalls += (uint32_t) gPackets[slot].commands.size();
+        gPackets[slot].overlay.clear();
+        if (gOverlayEnabled) {
+            updateOverlay();
+            // unchanged vertices only composite the overlay's cached image
+            gPackets[slot].overlay = gOverlay->getVertices();
+            // drawn a frame or more later, the last draw's time stands in
+            gOverlayTotalMs += gOverlayDrawMs;
+        }
+        pipeline.submitFrame(slot, inputTime);
+
+        Uint64 now = SDL_GetPerformanceCounter();
+        double frameMs = (now - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        frameStart = now;
+        recordFrameStats(frameMs);
+        gFrameTimeMs[gCaptureEnabled ? 1 : 0] += frameMs;
+        gFrameTimeCount[gCaptureEnabled ? 1 : 0]++;
+    }
+    pipeline.stop();
+    double seconds = (double) (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    glDeleteBuffers(framesInFlight, gFrameVBO);
+    glDeleteVertexArrays(framesInFlight, gFrameVAO);
+
+    cout << "----------------------------------------------------------------" << endl;
+    cout << "Frames in flight " << pipeline.getFramesInFlight() << ": " << pipeline.getFrames() << " frames, "
+         << pipeline.getFrames() / seconds << " frames/sec" << endl;
+    cout << "Input to present latency: " << pipeline.getAverageLatencyMs() << " ms average, "
+         << pipeline.getLatencyPercentileMs(0.5) << " median, " << pipeline.getLatencyPercentileMs(0.99)
+         << " p99, " << pipeline.getMaxLatencyMs() << " max" << endl;
+    cout << "Waiting: main thread " << pipeline.getMainWaitMs() / max(1, pipeline.getFrames())
+         << " ms/frame for a free slot, render thread " << pipeline.getFenceWaitMs() / max(1, pipeline.getFrames())
+         << " ms/frame on fences" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+    return true;
+}
+
+void printCaptureReport() {
+    cout << "----------------------------------------------------------------" << endl;
+    for (int on = 0; on < 2; on++) {
+        if (gFrameTimeCount[on] > 0) {
+            cout << "Capture " << (on ? "on " : "off") << ": " << gFrameTimeMs[on] / gFrameTimeCount[on]
+                 << " ms per frame (" << gFrameTimeCount[on] << " frames)" << endl;
+        }
+    }
+    if (gFrameTimeCount[0] > 0 && gFrameTimeCount[1] > 0) {
+        cout << "Capture overhead: "
+             << gFrameTimeMs[1] / gFrameTimeCount[1] - gFrameTimeMs[0] / gFrameTimeCount[0]
+             << " ms per frame" << endl;
+    }
+    cout << "Frames written " << gFrameCapture->getFramesWritten()
+         << ", dropped " << gFrameCapture->getFramesDropped()
+         << ", readback stalls " << gFrameCapture->getStalls() << endl;
+    cout << "----------------------------------------------------------------" << endl;
+}
+
+void printReloadReport() {
+    cout << "----------------------------------------------------------------" << endl;
+    cout << "Shader reloads " << gShaderReloader->getReloads() << ", failed " << gShaderReloader->getFailures()
+         << " (" << gShaderReloader->getBackendName() << ")" << endl;
+    cout << "Reload latency: " << gShaderReloader->getAverageLatencyMs() << " ms average, "
+         << gShaderReloader->getMaxLatencyMs() << " ms max" << endl;
+    cout << "Frames during reloads " << gReloadFrames << ", slowest " << gReloadMaxFrameMs << " ms, "
+         << gReloadHitches << " above " << gHitchThresholdMs << " ms" << endl;
+    cout << "Slowest frame outside reloads " << gOtherMaxFrameMs << " ms" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+}
+
 void printVersions() {
     cout << "----------------------------------------------------------------" << endl;
     cout << "Graphics Successfully Initialized" << endl;
@@ -326,10 +831,144 @@ void printVersions() {
     cout << "   Renderer: " << glGetString(GL_RENDERER) << endl;
     cout << "    Shading: " << glGetString(GL_SHADING_LANGUAGE_VERSION) << endl;
     cout << "       GLEW: " << glewGetString(GLEW_VERSION) << endl;
+    cout << "    Shaders: " << gShaderReloader->getBackendName() << endl;
     cout << "----------------------------------------------------------------" << endl;
 }
 
-int main() {
+// renders frames of random small triangles and prints the throughput
+void benchmarkSoftware(int triangleCount) {
+    const int frames = 20;
+    const float color[4] = {1.f, 0.5f, 0.f, 1.f};
+
+    mt19937 random(42);
+    uniform_real_distribution<float> center(-1.f, 1.f);
+    uniform_real_distribution<float> offset(-0.02f, 0.02f);
+
+    vector<float> positions((size_t) triangleCount * 9);
+    for (int t = 0; t < triangleCount; t++) {
+        float cx = center(random);
+        float cy = center(random);
+        for (int v = 0; v < 3; v++) {
+            positions[t * 9 + v * 3 + 0] = cx + offset(random);
+            positions[t * 9 + v * 3 + 1] = cy + offset(random);
+            positions[t * 9 + v * 3 + 2] = 0.f;
+        }
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int frame = 0; frame < frames; frame++) {
+        gSoftRasterizer->clear(0.f, 0.f, 0.f, 1.f);
+        gSoftRasterizer->drawTriangles(positions.data(), triangleCount * 3, color);
+        gSoftRasterizer->finish();
+    }
+    double seconds = (double) (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    cout << "Software rasterizer (" << SoftRasterizer::simdName() << ", "
+         << gSoftRasterizer->getThreadCount() << " threads): "
+         << (triangleCount * (double) frames) / seconds << " triangles/sec, "
+         << seconds * 1000.0 / frames << " ms per frame" << endl;
+}
+
+/*
+ * GPU-less path: renders the Lesson4 frame into an offscreen buffer.
+ *   --dump <file.ppm>     writes the image
+ *   --golden <file.ppm>   fails unless the image is pixel identical
+ *   --bench <triangles>   triangles/sec benchmark
+ */
+int runSoftware(int threads, const string &dumpPath, const string &goldenPath, int benchTriangles) {
+    SoftRasterizer rasterizer(SCREEN_WIDTH, SCREEN_HEIGHT, threads);
+    gSoftRasterizer = &rasterizer;
+
+    render();
+
+    int result = 0;
+    if (!dumpPath.empty() && !rasterizer.savePPM(dumpPath)) {
+        result = 1;
+    }
+
+    if (!goldenPath.empty()) {
+        long different = rasterizer.comparePPM(goldenPath);
+        if (different != 0) {
+            cout << "Golden image mismatch: " << different << " pixels differ from " << goldenPath << endl;
+            result = 1;
+        } else {
+            cout << "Golden image match: " << goldenPath << endl;
+        }
+    }
+
+    if (benchTriangles > 0) {
+        benchmarkSoftware(benchTriangles);
+    }
+
+    gSoftRasterizer = nullptr;
+    return result;
+}
+
+int main(int argc, char *argv[]) {
+    bool software = false;
+    int threads = 0;
+    int benchTriangles = 0;
+    string dumpPath;
+    string goldenPath;
+    string captureDirectory;
+    string meshPath;
+    string shaderDirectory = LESSON4_SHADER_DIR;
+    string metricsName;
+    bool shaderWorker = false;
+    int framesInFlight = 0;
+    FrameCapture::Format captureFormat = FrameCapture::FORMAT_PPM;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--software") == 0) {
+            software = true;
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--dump") == 0 && i + 1 < argc) {
+            dumpPath = argv[++i];
+        } else if (strcmp(argv[i], "--golden") == 0 && i + 1 < argc) {
+            goldenPath = argv[++i];
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchTriangles = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) {
+            captureDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--capture-format") == 0 && i + 1 < argc &&
+                   FrameCapture::parseFormat(argv[i + 1], captureFormat)) {
+            i++;
+        } else if (strcmp(argv[i], "--mesh") == 0 && i + 1 < argc) {
+            meshPath = argv[++i];
+        } else if (strcmp(argv[i], "--shaders") == 0 && i + 1 < argc) {
+            shaderDirectory = argv[++i];
+        } else if (strcmp(argv[i], "--shader-worker") == 0) {
+            shaderWorker = true;
+        } else if (strcmp(argv[i], "--hitch-ms") == 0 && i + 1 < argc) {
+            gHitchThresholdMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--no-vsync") == 0) {
+            gVsync = false;
+        } else if (strcmp(argv[i], "--frames-in-flight") == 0 && i + 1 < argc) {
+            framesInFlight = atoi(argv[++i]);
+            if (framesInFlight < 1 || framesInFlight > FramePipeline::MAX_FRAMES_IN_FLIGHT) {
+                cout << "--frames-in-flight must be 1 to " << FramePipeline::MAX_FRAMES_IN_FLIGHT << endl;
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sim-ms") == 0 && i + 1 < argc) {
+            gSimulationMs = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--metrics") == 0 && i + 1 < argc) {
+            metricsName = argv[++i];
+        } else if (strcmp(argv[i], "--overlay") == 0) {
+            gOverlayEnabled = true;
+        } else {
+            cout << "usage: " << argv[0] << endl
+                 << "    [--mesh file.mesh] [--capture directory [--capture-format raw|ppm|png]] [--no-vsync]" << endl
+                 << "    [--shaders directory] [--shader-worker] [--hitch-ms ms]" << endl
+                 << "    [--frames-in-flight 1-3] [--sim-ms ms] [--metrics /name] [--overlay]" << endl
+                 << "    [--software [--threads n] [--dump file.ppm] [--golden file.ppm] [--bench triangles]]" << endl;
+            return 1;
+        }
+    }
+
+    if (software) {
+        return runSoftware(threads, dumpPath, goldenPath, benchTriangles);
+    }
+
     if (!initSDL()) {
         return 1;
     }
@@ -350,22 +989,117 @@ int main() {
         return 1;
     }
 
+    ShaderReloader shaderReloader(shaderDirectory);
+    if (!shaderReloader.init(window, glContext, shaderWorker)) {
+        return 1;
+    }
+    gShaderReloader = &shaderReloader;
+
     if (!initGLStructure()) {
         return 1;
     }
 
     loadGlData();
 
+    if (!meshPath.empty() && !loadMesh(meshPath)) {
+        return 1;
+    }
+
     printVersions();
 
+    FrameCapture frameCapture(SCREEN_WIDTH, SCREEN_HEIGHT, captureDirectory, captureFormat);
+    if (!captureDirectory.empty()) {
+        if (!frameCapture.init()) {
+            return 1;
+        }
+        gFrameCapture = &frameCapture;
+        gCaptureEnabled = true;
+        cout << "Capturing to " << captureDirectory << ", press 'c' to toggle" << endl;
+    }
+
+    // font pixels 1:1, software GL bills the overlay by the pixel and 2x covers four times as many
+    TextOverlay overlay(1);
+    if (!overlay.init()) {
+        return 1;
+    }
+    gOverlay = &overlay;
+    cout << "Press 'o' to toggle the stats overlay" << endl;
+
+    if (!metricsName.empty()) {
+        if (!gMetrics.open(metricsName)) {
+            return 1;
+        }
+        glGenQueries(GPU_TIMER_QUERIES, gGpuTimerQueries);
+    }
+
     fpsTimer.start();
 
+    // no silent fallback to the sequential loop when pipelining was asked for
+    if (framesInFlight > 0 && !runPipelined(window, glContext, framesInFlight)) {
+        return 1;
+    }
+
     while (!quit) {
+        Uint64 frameStart = SDL_GetPerformanceCounter();
+
         eventHandler();
         calculatePrintFps();
+        simulate();
+        bool reloading = gShaderReloader->update();
+        gShaderReloads = gShaderReloader->getReloads();
+        beginGpuTimer();
         render();
+        endGpuTimer();
+        updateCapture(gCaptureEnabled);
+        // after the capture, recorded frames stay clean
+        if (gOverlayEnabled) {
+            updateOverlay();
+            drawOverlay(gOverlay->getVertices());
+            gOverlayTotalMs += gOverlayDrawMs;
+        }
         SDL_GL_SwapWindow(window);
+
+        double frameMs = (SDL_GetPerformanceCounter() - frameStart) * 1000.0 / SDL_GetPerformanceFrequency();
+        recordFrameStats(frameMs);
+        gFrameTimeMs[gCaptureEnabled ? 1 : 0] += frameMs;
+        gFrameTimeCount[gCaptureEnabled ? 1 : 0]++;
+        if (reloading) {
+            gReloadFrames++;
+            gReloadMaxFrameMs = max(gReloadMaxFrameMs, frameMs);
+            if (frameMs > gHitchThresholdMs) {
+                gReloadHitches++;
+            }
+        } else {
+            gOtherMaxFrameMs = max(gOtherMaxFrameMs, frameMs);
+        }
+    }
+
+    if (gFrameCapture != nullptr) {
+        gFrameCapture->finish();
+        printCaptureReport();
+    }
+    if (gMeshVAO != 0 && gFrameTimeCount[0] > 0) {
+        cout << "Mesh frame time: " << gFrameTimeMs[0] / gFrameTimeCount[0] << " ms ("
+             << gFrameTimeCount[0] << " frames)" << endl;
+    }
+
+    if (gShaderReloader->getReloads() > 0 || gShaderReloader->getFailures() > 0) {
+        printReloadReport();
+    }
+    gShaderReloader->shutdown();
+    gShaderReloader = nullptr;
+
+    if (gMetrics.isOpen()) {
+        glDeleteQueries(GPU_TIMER_QUERIES, gGpuTimerQueries);
+        gMetrics.close();
+    }
+
+    if (gOverlayFrames > 0) {
+        cout << "Overlay: " << gOverlayTotalMs / gOverlayFrames << " ms CPU per frame (build and draw), "
+             << gOverlayGpuMs << " ms GPU" << endl;
     }
+    gOverlay->shutdown();
+    gOverlay = nullptr;
 
     // clean up everything
     cleanup(&glContext, window);
@@ -0,0 +1,10 @@
+#version 400
+
+in vec3 vNormal;
+
+out vec4 frag_colour;
+
+void main() {
+    float light = length(vNormal) > 0.0 ? abs(dot(normalize(vNormal), normalize(vec3(0.3, 0.5, 1.0)))) : 1.0;
+    frag_colour = vec4(vec3(0.2, 0.9, 0.2) * (0.2 + 0.8 * light), 1.0);
+}
@@ -0,0 +1,18 @@
+#version 400
+
+layout(location = 0) in vec3 position;
+layout(location = 1) in vec3 normal;
+
+// quantized positions are expanded with the stream's decode scale/offset
+uniform vec3 decodeScale;
+uniform vec3 decodeOffset;
+// fits the mesh bounds into clip space
+uniform vec3 center;
+uniform float scale;
+
+out vec3 vNormal;
+
+void main() {
+    vNormal = normal;
+    gl_Position = vec4((position * decodeScale + decodeOffset - center) * scale, 1.0);
+}
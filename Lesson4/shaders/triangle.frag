@@ -0,0 +1,7 @@
+#version 400
+
+out vec4 frag_colour;
+
+void main() {
+    frag_colour = vec4(0.0, 1.0, 0.0, 1.0);
+}
@@ -0,0 +1,370 @@
+//
+// Frustum culling of a large synthetic scene with a refittable BVH
+//
+#include <iostream>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+#include <Timer.h>
+#include <Bvh.h>
+#include <Math3D.h>
+
+using namespace std;
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+// scene size and how many objects move every frame
+const float WORLD_HALF_SIZE = 1000.0f;
+const float MOVING_FRACTION = 0.01f;
+
+// GL vars
+GLuint gProgramId = 0;
+GLuint gVAO = 0;
+GLuint gVBO = 0;
+GLint gMVPLocation = -1;
+
+// scene vars
+vector<AABB> gBounds;
+vector<int> gVisible;
+vector<int> gMoved;
+vector<GLfloat> gPointData;
+Bvh gBvh;
+mt19937 gRandom(1234);
+
+// game loop vars
+bool quit = false;
+SDL_Event event;
+
+int countedFrames = 1;
+Timer fpsTimer;
+
+// culling statistics accumulated between two prints
+struct FrameStats {
+    int frames;
+    double visible;
+    double culled;
+    double cullMs;
+    double refitMs;
+};
+FrameStats gStats;
+
+bool initSDL() {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        cout << "SDL_Init error " << SDL_GetError() << endl;
+        return false;
+    }
+    return true;
+}
+
+void setOpenGLVersion() {
+    // set GL version
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+}
+
+SDL_Window *createSDLWindow() {
+    SDL_Window *window = SDL_CreateWindow("SDL / OpenGL - Frustum culling",
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          SCREEN_WIDTH, SCREEN_HEIGHT,
+                                          SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+
+    if (window == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        SDL_Quit();
+        return nullptr;
+    }
+
+    return window;
+}
+
+SDL_GLContext initSDLGLContext(SDL_Window *window) {
+    SDL_GLContext glContext = SDL_GL_CreateContext(window);
+    if (glContext == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        cleanup(window);
+        SDL_Quit();
+        return nullptr;
+    }
+
+    // immediate swap, we want to see the cost of culling not the vsync
+    SDL_GL_SetSwapInterval(0);
+
+    return glContext;
+}
+
+bool initGLEW(SDL_Window *window) {
+    GLenum error;
+    glewExperimental = GL_TRUE;
+    error = glewInit();
+    if (GLEW_OK != error) {
+        cout << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        cleanup(window);
+        SDL_Quit();
+        return false;
+    }
+    return true;
+}
+
+GLuint compileShader(GLenum type, const GLchar *source) {
+    GLuint shaderId = glCreateShader(type);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE) {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shaderId, maxLength, NULL, infoLog.data());
+        cout << "Unable to compile shader " << shaderId << endl << infoLog.data() << endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+bool initGLStructure() {
+    const GLchar *vertexShaderSource =
+            "#version 400\n"
+            "uniform mat4 mvp;\n"
+            "in vec3 vp;\n"
+            "void main() { gl_Position = mvp * vec4(vp, 1.0); }";
+
+    const GLchar *fragmentShaderSource =
+            "#version 400\n"
+            "out vec4 frag_colour;\n"
+            "void main() { frag_colour = vec4(0.0, 1.0, 0.0, 1.0); }";
+
+    GLuint vertexShaderId = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShaderId = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShaderId == 0 || fragmentShaderId == 0) {
+        return false;
+    }
+
+    gProgramId = glCreateProgram();
+    glAttachShader(gProgramId, vertexShaderId);
+    glAttachShader(gProgramId, fragmentShaderId);
+    glLinkProgram(gProgramId);
+
+    // shaders are no longer needed once the program is linked
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(gProgramId, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE) {
+        cout << "Error linking program " << gProgramId << endl;
+        return false;
+    }
+
+    gMVPLocation = glGetUniformLocation(gProgramId, "mvp");
+    return true;
+}
+
+void createScene(int objectCount) {
+    uniform_real_distribution<float> position(-WORLD_HALF_SIZE, WORLD_HALF_SIZE);
+    uniform_real_distribution<float> halfSize(0.5f, 2.0f);
+
+    gBounds.resize(objectCount);
+    for (int i = 0; i < objectCount; i++) {
+        Vec3 center = vec3(position(gRandom), position(gRandom), position(gRandom));
+        float h = halfSize(gRandom);
+        gBounds[i].min = center - vec3(h, h, h);
+        gBounds[i].max = center + vec3(h, h, h);
+    }
+
+    Timer buildTimer;
+    buildTimer.start();
+    gBvh.build(gBounds);
+    cout << "BVH built: " << objectCount << " objects, " << gBvh.nodeCount() << " nodes in "
+         << buildTimer.getTicks() << " ms" << endl;
+
+    gVisible.reserve(objectCount);
+    gPointData.reserve((size_t) objectCount * 3);
+}
+
+void loadGlData() {
+    // the VBO is refilled every frame with the centres of the visible objects
+    glGenBuffers(1, &gVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+
+    glGenVertexArrays(1, &gVAO);
+    glBindVertexArray(gVAO);
+    glEnableVertexAttribArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 0, NULL);
+}
+
+void eventHandler() {
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            quit = true;
+        }
+        if (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_q) {
+            quit = true;
+        }
+    }
+}
+
+// moves a small part of the scene so the BVH has to be refitted
+void updateScene() {
+    uniform_int_distribution<int> pick(0, (int) gBounds.size() - 1);
+    uniform_real_distribution<float> step(-1.0f, 1.0f);
+
+    int moving = (int) (gBounds.size() * MOVING_FRACTION);
+    gMoved.clear();
+    for (int i = 0; i < moving; i++) {
+        int object = pick(gRandom);
+        Vec3 delta = vec3(step(gRandom), step(gRandom), step(gRandom));
+        gBounds[object].min = gBounds[object].min + delta;
+        gBounds[object].max = gBounds[object].max + delta;
+        gMoved.push_back(object);
+    }
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    gBvh.refit(gBounds, gMoved);
+    Uint64 end = SDL_GetPerformanceCounter();
+    gStats.refitMs += (end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+Mat4 cameraMatrix() {
+    // slowly orbit in the middle of the scene
+    float angle = SDL_GetTicks() / 4000.0f;
+    Vec3 eye = vec3(0.0f, 0.0f, 0.0f);
+    Vec3 target = vec3(cos(angle), 0.2f, sin(angle));
+    Mat4 view = mat4LookAt(eye, target, vec3(0.0f, 1.0f, 0.0f));
+    Mat4 projection = mat4Perspective(1.0f, (float) SCREEN_WIDTH / SCREEN_HEIGHT, 0.5f, WORLD_HALF_SIZE);
+    return projection * view;
+}
+
+void cullScene(const Mat4 &viewProjection) {
+    Frustum frustum = frustumFromMatrix(viewProjection);
+
+    CullStats cullStats;
+    gVisible.clear();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    gBvh.cull(frustum, gVisible, cullStats);
+    Uint64 end = SDL_GetPerformanceCounter();
+
+    gStats.frames++;
+    gStats.visible += cullStats.visible;
+    gStats.culled += cullStats.culled;
+    gStats.cullMs += (end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+void render(const Mat4 &viewProjection) {
+    // only the visible objects are submitted
+    gPointData.resize(gVisible.size() * 3);
+    for (size_t i = 0; i < gVisible.size(); i++) {
+        const AABB &box = gBounds[gVisible[i]];
+        gPointData[i * 3 + 0] = (box.min.x + box.max.x) * 0.5f;
+        gPointData[i * 3 + 1] = (box.min.y + box.max.y) * 0.5f;
+        gPointData[i * 3 + 2] = (box.min.z + box.max.z) * 0.5f;
+    }
+
+    glClearColor(0.f, 0.f, 0.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+
+    glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+    glBufferData(GL_ARRAY_BUFFER, gPointData.size() * sizeof(GLfloat), gPointData.data(), GL_STREAM_DRAW);
+
+    glUseProgram(gProgramId);
+    glUniformMatrix4fv(gMVPLocation, 1, GL_FALSE, viewProjection.m);
+    glBindVertexArray(gVAO);
+    glDrawArrays(GL_POINTS, 0, (GLsizei) gVisible.size());
+    glUseProgram(0);
+}
+
+void calculatePrintStats() {
+    int ticks = fpsTimer.getTicks();
+    if (ticks < 1000 || gStats.frames == 0) {
+        return;
+    }
+
+    float avgFPS = countedFrames / (ticks / 1000.f);
+    cout << "FPS " << avgFPS
+         << " | visible " << (int) (gStats.visible / gStats.frames)
+         << " culled " << (int) (gStats.culled / gStats.frames)
+         << " | cull " << gStats.cullMs / gStats.frames << " ms"
+         << " refit " << gStats.refitMs / gStats.frames << " ms per frame" << endl;
+
+    memset(&gStats, 0, sizeof(gStats));
+    countedFrames = 0;
+    fpsTimer.start();
+}
+
+int main(int argc, char *argv[]) {
+    // number of objects in the scene, 1M by default
+    int objectCount = 1000000;
+    if (argc > 1) {
+        objectCount = atoi(argv[1]);
+    }
+    if (objectCount <= 0) {
+        cout << "usage: " << argv[0] << " [object count]" << endl;
+        return 1;
+    }
+
+    if (!initSDL()) {
+        return 1;
+    }
+
+    setOpenGLVersion();
+
+    SDL_Window *window = createSDLWindow();
+    if (window == nullptr) {
+        return 1;
+    }
+
+    SDL_GLContext glContext = initSDLGLContext(window);
+    if (glContext == nullptr) {
+        return 1;
+    }
+
+    if (!initGLEW(window)) {
+        return 1;
+    }
+
+    if (!initGLStructure()) {
+        return 1;
+    }
+
+    loadGlData();
+    glPointSize(2.0f);
+
+    createScene(objectCount);
+    memset(&gStats, 0, sizeof(gStats));
+
+    fpsTimer.start();
+
+    while (!quit) {
+        eventHandler();
+        updateScene();
+
+        Mat4 viewProjection = cameraMatrix();
+        cullScene(viewProjection);
+        render(viewProjection);
+
+        SDL_GL_SwapWindow(window);
+
+        countedFrames++;
+        calculatePrintStats();
+    }
+
+    // clean up everything
+    glDeleteBuffers(1, &gVBO);
+    glDeleteVertexArrays(1, &gVAO);
+    glDeleteProgram(gProgramId);
+    cleanup(&glContext, window);
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,664 @@
+//
+// Entity / component storage: springs simulated and drawn from packed component arrays
+//
+#include <iostream>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+#include <Timer.h>
+#include <Physics.h>
+#include <Registry.h>
+
+using namespace std;
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+// one simulation step per frame
+const float PHYSICS_DT = 1.0f / 60.0f;
+// part of the entities destroyed and created again every frame while churning
+const float CHURN_FRACTION = 0.01f;
+
+// components, State comes from Physics.h
+struct Transform {
+    float x;
+    float y;
+    // written by the physics system from State::x
+    float offsetX;
+    float scale;
+};
+
+struct Renderable {
+    GLuint program;
+    int mesh;
+    float color[3];
+};
+
+// instanced meshes referenced by Renderable::mesh
+struct Mesh {
+    GLuint vao;
+    GLuint vbo;
+    GLuint instanceVbo;
+    GLenum mode;
+    GLsizei vertexCount;
+};
+
+// instances of one program / mesh pair, rebuilt every frame
+struct Batch {
+    GLuint program;
+    int mesh;
+    vector<GLfloat> instances;
+};
+
+const int MESH_QUAD = 0;
+const int MESH_TRIANGLE = 1;
+const int MESH_COUNT = 2;
+// x, y, scale, r, g, b
+const int INSTANCE_FLOATS = 6;
+
+// GL vars
+GLuint gProgramId = 0;
+Mesh gMeshes[MESH_COUNT];
+vector<Batch> gBatches;
+
+// scene vars
+Registry gRegistry;
+vector<Entity> gEntities;
+int gGridSide = 1;
+float gTime = 0.0f;
+bool gChurn = false;
+mt19937 gRandom(1234);
+
+// game loop vars
+bool quit = false;
+SDL_Event event;
+
+int countedFrames = 1;
+Timer fpsTimer;
+
+// time spent per system, accumulated between two prints
+struct FrameStats {
+    int frames;
+    double physicsMs;
+    double gatherMs;
+    double churnMs;
+};
+FrameStats gStats;
+
+double elapsedMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+bool initSDL() {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        cout << "SDL_Init error " << SDL_GetError() << endl;
+        return false;
+    }
+    return true;
+}
+
+void setOpenGLVersion() {
+    // set GL version
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+}
+
+SDL_Window *createSDLWindow() {
+    SDL_Window *window = SDL_CreateWindow("SDL / OpenGL - Entities",
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          SCREEN_WIDTH, SCREEN_HEIGHT,
+                                          SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+
+    if (window == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        SDL_Quit();
+        return nullptr;
+    }
+
+    return window;
+}
+
+SDL_GLContext initSDLGLContext(SDL_Window *window) {
+    SDL_GLContext glContext = SDL_GL_CreateContext(window);
+    if (glContext == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        cleanup(window);
+        SDL_Quit();
+        return nullptr;
+    }
+
+    // immediate swap, we want to see the cost of the systems not the vsync
+    SDL_GL_SetSwapInterval(0);
+
+    return glContext;
+}
+
+bool initGLEW(SDL_Window *window) {
+    GLenum error;
+    glewExperimental = GL_TRUE;
+    error = glewInit();
+    if (GLEW_OK != error) {
+        cout << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        cleanup(window);
+        SDL_Quit();
+        return false;
+    }
+    return true;
+}
+
+GLuint compileShader(GLenum type, const GLchar *source) {
+    GLuint shaderId = glCreateShader(type);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE) {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shaderId, maxLength, NULL, infoLog.data());
+        cout << "Unable to compile shader " << shaderId << endl << infoLog.data() << endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+bool initGLStructure() {
+    const GLchar *vertexShaderSource =
+            "#version 410\n"
+            "layout(location = 0) in vec2 vp;\n"
+            "layout(location = 1) in vec3 instance;\n"
+            "layout(location = 2) in vec3 color;\n"
+            "out vec3 vColor;\n"
+            "void main() {\n"
+            "    vColor = color;\n"
+            "    gl_Position = vec4(instance.xy + vp * instance.z, 0.0, 1.0);\n"
+            "}";
+
+    const GLchar *fragmentShaderSource =
+            "#version 410\n"
+            "in vec3 vColor;\n"
+            "out vec4 frag_colour;\n"
+            "void main() { frag_colour = vec4(vColor, 1.0); }";
+
+    GLuint vertexShaderId = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShaderId = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShaderId == 0 || fragmentShaderId == 0) {
+        return false;
+    }
+
+    gProgramId = glCreateProgram();
+    glAttachShader(gProgramId, vertexShaderId);
+    glAttachShader(gProgramId, fragmentShaderId);
+    glLinkProgram(gProgramId);
+
+    // shaders are no longer needed once the program is linked
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(gProgramId, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE) {
+        cout << "Error linking program " << gProgramId << endl;
+        return false;
+    }
+    return true;
+}
+
+void createMesh(Mesh &mesh, GLenum mode, const GLfloat *vertices, GLsizei vertexCount) {
+    mesh.mode = mode;
+    mesh.vertexCount = vertexCount;
+
+    glGenVertexArrays(1, &mesh.vao);
+    glBindVertexArray(mesh.vao);
+
+    glGenBuffers(1, &mesh.vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.vbo);
+    glBufferData(GL_ARRAY_BUFFER, vertexCount * 2 * sizeof(GLfloat), vertices, GL_STATIC_DRAW);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+
+    // refilled every frame with the Transform / Renderable of each entity
+    glGenBuffers(1, &mesh.instanceVbo);
+    glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceVbo);
+    glBufferData(GL_ARRAY_BUFFER, 0, NULL, GL_STREAM_DRAW);
+    const GLsizei stride = INSTANCE_FLOATS * sizeof(GLfloat);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, stride, NULL);
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, stride, (const GLvoid *) (3 * sizeof(GLfloat)));
+    glVertexAttribDivisor(2, 1);
+
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void loadGlData() {
+    const GLfloat quad[] = {-0.5f, -0.5f, 0.5f, -0.5f, 0.5f, 0.5f, -0.5f, 0.5f};
+    const GLfloat triangle[] = {-0.5f, -0.5f, 0.5f, -0.5f, 0.0f, 0.5f};
+    createMesh(gMeshes[MESH_QUAD], GL_TRIANGLE_FAN, quad, 4);
+    createMesh(gMeshes[MESH_TRIANGLE], GL_TRIANGLES, triangle, 3);
+}
+
+// entity i of the grid: every one is drawn, three out of four are springs
+Entity spawnEntity(Registry &registry, int i) {
+    uniform_real_distribution<float> displacement(-1.0f, 1.0f);
+    const float cell = 2.0f / gGridSide;
+
+    Entity entity = registry.create();
+
+    Transform transform;
+    transform.x = -1.0f + (i % gGridSide + 0.5f) * cell;
+    transform.y = -1.0f + (i / gGridSide + 0.5f) * cell;
+    transform.offsetX = 0.0f;
+    transform.scale = cell * 0.8f;
+    registry.add<Transform>(entity, transform);
+
+    Renderable renderable;
+    renderable.program = gProgramId;
+    renderable.mesh = i % 3 == 0 ? MESH_TRIANGLE : MESH_QUAD;
+    renderable.color[0] = (float) (i % gGridSide) / gGridSide;
+    renderable.color[1] = (float) (i / gGridSide) / gGridSide;
+    renderable.color[2] = 0.6f;
+    registry.add<Renderable>(entity, renderable);
+
+    if (i % 4 != 0) {
+        State state;
+        state.x = displacement(gRandom);
+        state.v = 0.0f;
+        registry.add<State>(entity, state);
+    }
+    return entity;
+}
+
+void fillRegistry(Registry &registry, vector<Entity> &entities, int entityCount) {
+    gGridSide = 1;
+    while (gGridSide * gGridSide < entityCount) {
+        gGridSide++;
+    }
+
+    registry.reserve(entityCount);
+    registry.pool<Transform>().reserve(entityCount);
+    registry.pool<Renderable>().reserve(entityCount);
+    registry.pool<State>().reserve(entityCount);
+
+    entities.resize(entityCount);
+    for (int i = 0; i < entityCount; i++) {
+        entities[i] = spawnEntity(registry, i);
+    }
+}
+
+void createScene(int entityCount) {
+    // the physics system walks State and Transform side by side
+    gRegistry.group<State, Transform>();
+    fillRegistry(gRegistry, gEntities, entityCount);
+    cout << "Scene: " << entityCount << " entities, " << gRegistry.group<State, Transform>().size()
+         << " springs" << endl;
+}
+
+// the whole set of entities springs off again
+void kickScene() {
+    uniform_real_distribution<float> displacement(-1.0f, 1.0f);
+    gRegistry.each<State>([&](Entity, State &state) {
+        state.x = displacement(gRandom);
+        state.v = 0.0f;
+    });
+}
+
+void eventHandler() {
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            quit = true;
+        }
+        if (event.type == SDL_KEYDOWN) {
+            switch (event.key.keysym.sym) {
+                case SDLK_q:
+                    quit = true;
+                    break;
+                case SDLK_r:
+                    kickScene();
+                    break;
+                case SDLK_c:
+                    gChurn = !gChurn;
+                    cout << "Churn " << (gChurn ? "on" : "off") << endl;
+                    break;
+            }
+        }
+    }
+}
+
+// replaces a random part of the entities, keeps the group packed under load
+void churnScene() {
+    uniform_int_distribution<int> pick(0, (int) gEntities.size() - 1);
+    const int count = (int) (gEntities.size() * CHURN_FRACTION);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int n = 0; n < count; n++) {
+        int i = pick(gRandom);
+        gRegistry.destroy(gEntities[i]);
+        gEntities[i] = spawnEntity(gRegistry, i);
+    }
+    gStats.churnMs += elapsedMs(start);
+}
+
+void physicsSystem() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    const float cell = 2.0f / gGridSide;
+    const float t = gTime;
+    gRegistry.group<State, Transform>().each([=](Entity, State &state, Transform &transform) {
+        integrate(state, t, PHYSICS_DT);
+        transform.offsetX = state.x * cell;
+    });
+    gTime += PHYSICS_DT;
+    gStats.physicsMs += elapsedMs(start);
+}
+
+Batch &batchFor(GLuint program, int mesh) {
+    for (size_t i = 0; i < gBatches.size(); i++) {
+        if (gBatches[i].program == program && gBatches[i].mesh == mesh) {
+            return gBatches[i];
+        }
+    }
+    Batch batch;
+    batch.program = program;
+    batch.mesh = mesh;
+    gBatches.push_back(batch);
+    return gBatches.back();
+}
+
+void renderSystem() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < gBatches.size(); i++) {
+        gBatches[i].instances.clear();
+    }
+    gRegistry.each<Transform, Renderable>([](Entity, Transform &transform, Renderable &renderable) {
+        vector<GLfloat> &instances = batchFor(renderable.program, renderable.mesh).instances;
+        instances.push_back(transform.x + transform.offsetX);
+        instances.push_back(transform.y);
+        instances.push_back(transform.scale);
+        instances.push_back(renderable.color[0]);
+        instances.push_back(renderable.color[1]);
+        instances.push_back(renderable.color[2]);
+    });
+    gStats.gatherMs += elapsedMs(start);
+
+    glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    // one instanced draw per program / mesh pair
+    for (size_t i = 0; i < gBatches.size(); i++) {
+        const Batch &batch = gBatches[i];
+        if (batch.instances.empty()) {
+            continue;
+        }
+        const Mesh &mesh = gMeshes[batch.mesh];
+        glUseProgram(batch.program);
+        glBindVertexArray(mesh.vao);
+        glBindBuffer(GL_ARRAY_BUFFER, mesh.instanceVbo);
+        glBufferData(GL_ARRAY_BUFFER, batch.instances.size() * sizeof(GLfloat), batch.instances.data(),
+                     GL_STREAM_DRAW);
+        glDrawArraysInstanced(mesh.mode, 0, mesh.vertexCount, (GLsizei) (batch.instances.size() / INSTANCE_FLOATS));
+    }
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void calculatePrintStats() {
+    int ticks = fpsTimer.getTicks();
+    if (ticks < 1000 || gStats.frames == 0) {
+        return;
+    }
+
+    float avgFPS = countedFrames / (ticks / 1000.f);
+    cout << "FPS " << avgFPS
+         << " | entities " << gRegistry.alive()
+         << " | physics " << gStats.physicsMs / gStats.frames << " ms"
+         << " gather " << gStats.gatherMs / gStats.frames << " ms";
+    if (gChurn) {
+        cout << " churn " << gStats.churnMs / gStats.frames << " ms";
+    }
+    cout << " per frame" << endl;
+
+    memset(&gStats, 0, sizeof(gStats));
+    countedFrames = 0;
+    fpsTimer.start();
+}
+
+//////////////////////////////////
+// benchmark
+//////////////////////////////////
+
+// the same data as heap objects reached through pointers
+struct GameObject {
+    Transform transform;
+    Renderable renderable;
+    // null for the static ones
+    unique_ptr<State> state;
+};
+
+// runs pass() a few times, prints the average
+template<typename Func>
+void benchPass(const char *name, size_t entities, Func pass) {
+    const int PASSES = 10;
+    pass();
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int i = 0; i < PASSES; i++) {
+        pass();
+    }
+    double ms = elapsedMs(start) / PASSES;
+    cout << "  " << name << ": " << ms << " ms/pass, " << ms * 1e6 / entities << " ns/entity" << endl;
+}
+
+void integrateAndPlace(State &state, Transform &transform, float cell) {
+    integrate(state, 0.0f, PHYSICS_DT);
+    transform.offsetX = state.x * cell;
+}
+
+// random remove/add of State and destroy/create of whole entities
+void benchChurn(const char *name, Registry &registry, vector<Entity> &entities, int operations) {
+    uniform_int_distribution<int> pick(0, (int) entities.size() - 1);
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int n = 0; n < operations; n++) {
+        Entity entity = entities[pick(gRandom)];
+        if (registry.has<State>(entity)) {
+            State state = registry.get<State>(entity);
+            registry.remove<State>(entity);
+            registry.add<State>(entity, state);
+        }
+    }
+    double componentMs = elapsedMs(start);
+
+    start = SDL_GetPerformanceCounter();
+    for (int n = 0; n < operations; n++) {
+        int i = pick(gRandom);
+        registry.destroy(entities[i]);
+        entities[i] = spawnEntity(registry, i);
+    }
+    double entityMs = elapsedMs(start);
+
+    cout << "  " << name << " churn: State remove + add " << componentMs * 1e6 / operations << " ns/op, "
+         << "entity destroy + create " << entityMs * 1e6 / operations << " ns/op" << endl;
+}
+
+int benchmark(int entityCount) {
+    cout << "Benchmark, " << entityCount << " entities (3/4 with State)" << endl;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    createScene(entityCount);
+    cout << "  create: " << elapsedMs(start) << " ms" << endl;
+
+    // the same entities without the group, the pools keep their own order
+    Registry plain;
+    vector<Entity> plainEntities;
+    fillRegistry(plain, plainEntities, entityCount);
+
+    const float cell = 2.0f / gGridSide;
+    const size_t springs = gRegistry.pool<State>().size();
+
+    benchPass("group<State, Transform>", springs, [&]() {
+        gRegistry.group<State, Transform>().each([=](Entity, State &state, Transform &transform) {
+            integrateAndPlace(state, transform, cell);
+        });
+    });
+    benchPass("view<State, Transform>", springs, [&]() {
+        plain.each<State, Transform>([=](Entity, State &state, Transform &transform) {
+            integrateAndPlace(state, transform, cell);
+        });
+    });
+    benchPass("each<State> only", springs, [&]() {
+        gRegistry.each<State>([](Entity, State &state) {
+            integrate(state, 0.0f, PHYSICS_DT);
+        });
+    });
+
+    // heap objects visited in a shuffled order, as after a while of
+    // spawning and despawning
+    vector<unique_ptr<GameObject> > objects(entityCount);
+    for (int i = 0; i < entityCount; i++) {
+        Entity entity = gEntities[i];
+        objects[i].reset(new GameObject());
+        objects[i]->transform = gRegistry.get<Transform>(entity);
+        objects[i]->renderable = gRegistry.get<Renderable>(entity);
+        if (gRegistry.has<State>(entity)) {
+            objects[i]->state.reset(new State(gRegistry.get<State>(entity)));
+        }
+    }
+    shuffle(objects.begin(), objects.end(), gRandom);
+    benchPass("pointer chasing GameObject*", springs, [&]() {
+        for (size_t i = 0; i < objects.size(); i++) {
+            GameObject &object = *objects[i];
+            if (object.state) {
+                integrateAndPlace(*object.state, object.transform, cell);
+            }
+        }
+    });
+    objects.clear();
+
+    benchChurn("group", gRegistry, gEntities, entityCount / 10);
+    benchChurn("plain", plain, plainEntities, entityCount / 10);
+
+    // churn leaves the plain pools in unrelated orders, the group stays packed
+    const size_t churnedSprings = gRegistry.pool<State>().size();
+    benchPass("group<State, Transform> after churn", churnedSprings, [&]() {
+        gRegistry.group<State, Transform>().each([=](Entity, State &state, Transform &transform) {
+            integrateAndPlace(state, transform, cell);
+        });
+    });
+    benchPass("view<State, Transform> after churn", plain.pool<State>().size(), [&]() {
+        plain.each<State, Transform>([=](Entity, State &state, Transform &transform) {
+            integrateAndPlace(state, transform, cell);
+        });
+    });
+
+    // the render gather, no GL involved
+    size_t gathered = 0;
+    benchPass("gather Transform + Renderable", gRegistry.alive(), [&]() {
+        for (size_t i = 0; i < gBatches.size(); i++) {
+            gBatches[i].instances.clear();
+        }
+        gRegistry.each<Transform, Renderable>([](Entity, Transform &transform, Renderable &renderable) {
+            vector<GLfloat> &instances = batchFor(renderable.program, renderable.mesh).instances;
+            instances.push_back(transform.x + transform.offsetX);
+            instances.push_back(transform.y);
+            instances.push_back(transform.scale);
+            instances.push_back(renderable.color[0]);
+            instances.push_back(renderable.color[1]);
+            instances.push_back(renderable.color[2]);
+        });
+        gathered = gBatches.size();
+    });
+    cout << "  " << gathered << " batches" << endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    // number of entities, 100k on screen, 1M for the benchmark
+    int entityCount = 0;
+    bool bench = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--bench") == 0) {
+            bench = true;
+        } else if (atoi(argv[i]) > 0) {
+            entityCount = atoi(argv[i]);
+        } else {
+            cout << "usage: " << argv[0] << " [--bench] [entity count]" << endl;
+            return 1;
+        }
+    }
+    if (entityCount == 0) {
+        entityCount = bench ? 1000000 : 100000;
+    }
+
+    // headless, no window or GL needed
+    if (bench) {
+        return benchmark(entityCount);
+    }
+
+    if (!initSDL()) {
+        return 1;
+    }
+
+    setOpenGLVersion();
+
+    SDL_Window *window = createSDLWindow();
+    if (window == nullptr) {
+        return 1;
+    }
+
+    SDL_GLContext glContext = initSDLGLContext(window);
+    if (glContext == nullptr) {
+        return 1;
+    }
+
+    if (!initGLEW(window)) {
+        return 1;
+    }
+
+    if (!initGLStructure()) {
+        return 1;
+    }
+
+    loadGlData();
+    createScene(entityCount);
+    memset(&gStats, 0, sizeof(gStats));
+
+    fpsTimer.start();
+
+    while (!quit) {
+        eventHandler();
+        if (gChurn) {
+            churnScene();
+        }
+        physicsSystem();
+        renderSystem();
+
+        SDL_GL_SwapWindow(window);
+
+        gStats.frames++;
+        countedFrames++;
+        calculatePrintStats();
+    }
+
+    // clean up everything
+    for (int i = 0; i < MESH_COUNT; i++) {
+        glDeleteBuffers(1, &gMeshes[i].vbo);
+        glDeleteBuffers(1, &gMeshes[i].instanceVbo);
+        glDeleteVertexArrays(1, &gMeshes[i].vao);
+    }
+    glDeleteProgram(gProgramId);
+    cleanup(&glContext, window);
+    SDL_Quit();
+
+    return 0;
+}
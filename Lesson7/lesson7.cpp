@@ -0,0 +1,515 @@
+//
+// Lesson3's damped springs as particles, integrated by a compute shader and drawn from the same buffer
+//
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+#include <Timer.h>
+#include <Physics.h>
+
+using namespace std;
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+// Lesson3's time step
+const float DT = 0.1f;
+const GLuint WORK_GROUP_SIZE = 256;
+// GPU and CPU results may differ by this much after the validation steps
+const float VALIDATION_TOLERANCE = 1e-4f;
+const int VALIDATION_STEPS = 100;
+
+// GL vars
+GLuint gComputeProgram = 0;
+GLuint gRenderProgram = 0;
+GLuint gStateBuffer = 0;
+GLuint gVAO = 0;
+
+// simulation vars
+vector<State> gStates;
+int gParticleCount = 0;
+int gGridSide = 1;
+int gStepsPerFrame = 1;
+float gTime = 0.0f;
+bool gCpuPath = false;
+mt19937 gRandom(1234);
+
+// game loop vars
+bool quit = false;
+SDL_Event event;
+
+int countedFrames = 1;
+Timer fpsTimer;
+
+// time spent integrating, accumulated between two prints
+struct FrameStats {
+    int frames;
+    double simulationMs;
+};
+FrameStats gStats;
+
+double elapsedMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+bool initSDL() {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        cout << "SDL_Init error " << SDL_GetError() << endl;
+        return false;
+    }
+    return true;
+}
+
+void setOpenGLVersion() {
+    // compute shaders and shader storage buffers are core in 4.3
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+}
+
+SDL_Window *createSDLWindow() {
+    SDL_Window *window = SDL_CreateWindow("SDL / OpenGL - Compute particles",
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          SCREEN_WIDTH, SCREEN_HEIGHT,
+                                          SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+
+    if (window == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        SDL_Quit();
+        return nullptr;
+    }
+
+    return window;
+}
+
+SDL_GLContext initSDLGLContext(SDL_Window *window) {
+    SDL_GLContext glContext = SDL_GL_CreateContext(window);
+    if (glContext == nullptr) {
+        cout << "SDL_GL_CreateContext error (OpenGL 4.3 needed) " << SDL_GetError() << endl;
+        cleanup(window);
+        SDL_Quit();
+        return nullptr;
+    }
+
+    // immediate swap, we want to see the cost of the simulation not the vsync
+    SDL_GL_SetSwapInterval(0);
+
+    return glContext;
+}
+
+bool initGLEW(SDL_Window *window) {
+    GLenum error;
+    glewExperimental = GL_TRUE;
+    error = glewInit();
+    if (GLEW_OK != error) {
+        cout << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        cleanup(window);
+        SDL_Quit();
+        return false;
+    }
+    return true;
+}
+
+GLuint compileShader(GLenum type, const GLchar *source) {
+    GLuint shaderId = glCreateShader(type);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE) {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shaderId, maxLength, NULL, infoLog.data());
+        cout << "Unable to compile shader " << shaderId << endl << infoLog.data() << endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+GLuint linkProgram(const GLuint *shaders, int shaderCount) {
+    for (int i = 0; i < shaderCount; i++) {
+        if (shaders[i] == 0) {
+            return 0;
+        }
+    }
+
+    GLuint programId = glCreateProgram();
+    for (int i = 0; i < shaderCount; i++) {
+        glAttachShader(programId, shaders[i]);
+    }
+    glLinkProgram(programId);
+
+    // shaders are no longer needed once the program is linked
+    for (int i = 0; i < shaderCount; i++) {
+        glDeleteShader(shaders[i]);
+    }
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(programId, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE) {
+        cout << "Error linking program " << programId << endl;
+        glDeleteProgram(programId);
+        return 0;
+    }
+    return programId;
+}
+
+bool initGLStructure() {
+    // integrate() from Physics.cpp, one invocation per particle. precise keeps
+    // the compiler from fusing multiplies and adds, closer to the CPU results.
+    const GLchar *computeShaderSource =
+            "#version 430\n"
+            "layout(local_size_x = 256) in;\n"
+            "struct State { float x; float v; };\n"
+            "layout(std430, binding = 0) buffer States { State states[]; };\n"
+            "uniform uint count;\n"
+            "uniform float dt;\n"
+            "const float k = 10.0;\n"
+            "const float b = 1.0;\n"
+            "void main() {\n"
+            "    uint i = gl_GlobalInvocationID.x;\n"
+            "    if (i >= count) return;\n"
+            "    precise float x = states[i].x;\n"
+            "    precise float v = states[i].v;\n"
+            "    float halfDt = dt * 0.5;\n"
+            "    precise float aDx = v;\n"
+            "    precise float aDv = -k * x - b * v;\n"
+            "    precise float bDx = v + aDv * halfDt;\n"
+            "    precise float bDv = -k * (x + aDx * halfDt) - b * bDx;\n"
+            "    precise float cDx = v + bDv * halfDt;\n"
+            "    precise float cDv = -k * (x + bDx * halfDt) - b * cDx;\n"
+            "    precise float dDx = v + cDv * dt;\n"
+            "    precise float dDv = -k * (x + cDx * dt) - b * dDx;\n"
+            "    precise float dxdt = 1.0 / 6.0 * (aDx + 2.0 * (bDx + cDx) + dDx);\n"
+            "    precise float dvdt = 1.0 / 6.0 * (aDv + 2.0 * (bDv + cDv) + dDv);\n"
+            "    states[i].x = x + dxdt * dt;\n"
+            "    states[i].v = v + dvdt * dt;\n"
+            "}";
+
+    // reads the particles straight from the buffer the compute shader writes,
+    // particle i sits at cell i of the grid, moved sideways by its spring
+    const GLchar *vertexShaderSource =
+            "#version 430\n"
+            "struct State { float x; float v; };\n"
+            "layout(std430, binding = 0) readonly buffer States { State states[]; };\n"
+            "uniform int side;\n"
+            "out vec3 vColor;\n"
+            "void main() {\n"
+            "    int i = gl_VertexID;\n"
+            "    vec2 cell = (vec2(i % side, i / side) + 0.5) / float(side) * 2.0 - 1.0;\n"
+            "    float x = states[i].x;\n"
+            "    gl_Position = vec4(cell.x + x * 2.0 / float(side), cell.y, 0.0, 1.0);\n"
+            "    vColor = vec3(0.5 + 0.5 * x, 0.5 - 0.5 * x, 1.0);\n"
+            "}";
+
+    const GLchar *fragmentShaderSource =
+            "#version 430\n"
+            "in vec3 vColor;\n"
+            "out vec4 frag_colour;\n"
+            "void main() { frag_colour = vec4(vColor, 1.0); }";
+
+    GLuint compute = compileShader(GL_COMPUTE_SHADER, computeShaderSource);
+    gComputeProgram = linkProgram(&compute, 1);
+
+    GLuint shaders[2] = {compileShader(GL_VERTEX_SHADER, vertexShaderSource),
+                         compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource)};
+    gRenderProgram = linkProgram(shaders, 2);
+
+    return gComputeProgram != 0 && gRenderProgram != 0;
+}
+
+void resetStates(vector<State> &states, int count) {
+    uniform_real_distribution<float> displacement(-1.0f, 1.0f);
+    states.resize(count);
+    for (int i = 0; i < count; i++) {
+        states[i].x = displacement(gRandom);
+        states[i].v = 0.0f;
+    }
+}
+
+void uploadStates(const vector<State> &states) {
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStateBuffer);
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, states.size() * sizeof(State), states.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void loadGlData(int particleCount) {
+    glGenBuffers(1, &gStateBuffer);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStateBuffer);
+    glBufferData(GL_SHADER_STORAGE_BUFFER, particleCount * sizeof(State), NULL, GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+    glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, gStateBuffer);
+
+    // no vertex attributes, but core profiles need a VAO bound to draw
+    glGenVertexArrays(1, &gVAO);
+}
+
+// steps of integrate() for every particle, on the GPU
+void dispatchSteps(int particleCount, int steps) {
+    glUseProgram(gComputeProgram);
+    glUniform1ui(glGetUniformLocation(gComputeProgram, "count"), (GLuint) particleCount);
+    glUniform1f(glGetUniformLocation(gComputeProgram, "dt"), DT);
+    const GLuint groups = ((GLuint) particleCount + WORK_GROUP_SIZE - 1) / WORK_GROUP_SIZE;
+    for (int i = 0; i < steps; i++) {
+        glDispatchCompute(groups, 1, 1);
+        // the next step and the draw read what this one wrote
+        glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    }
+    glUseProgram(0);
+}
+
+void readStates(vector<State> &states, int particleCount) {
+    states.resize(particleCount);
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, gStateBuffer);
+    glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, particleCount * sizeof(State), states.data());
+    glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void eventHandler() {
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            quit = true;
+        }
+        if (event.type == SDL_KEYDOWN) {
+            switch (event.key.keysym.sym) {
+                case SDLK_q:
+                    quit = true;
+                    break;
+                case SDLK_r:
+                    // like Lesson3, everything springs off again
+                    resetStates(gStates, gParticleCount);
+                    uploadStates(gStates);
+                    break;
+                case SDLK_g:
+                    // the CPU copy is stale while the GPU integrates
+                    if (!gCpuPath) {
+                        readStates(gStates, gParticleCount);
+                    }
+                    gCpuPath = !gCpuPath;
+                    cout << "Integrating on the " << (gCpuPath ? "CPU" : "GPU") << endl;
+                    break;
+            }
+        }
+    }
+}
+
+void simulate() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    if (gCpuPath) {
+        for (int i = 0; i < gStepsPerFrame; i++) {
+            integrateStates(gStates.data(), gStates.size(), gTime + i * DT, DT);
+        }
+        uploadStates(gStates);
+    } else {
+        dispatchSteps(gParticleCount, gStepsPerFrame);
+    }
+    gTime += gStepsPerFrame * DT;
+    gStats.simulationMs += elapsedMs(start);
+}
+
+void render() {
+    glClearColor(0.f, 0.f, 0.f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glUseProgram(gRenderProgram);
+    glUniform1i(glGetUniformLocation(gRenderProgram, "side"), gGridSide);
+    glBindVertexArray(gVAO);
+    glDrawArrays(GL_POINTS, 0, gParticleCount);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+void calculatePrintStats() {
+    int ticks = fpsTimer.getTicks();
+    if (ticks < 1000 || gStats.frames == 0) {
+        return;
+    }
+
+    float avgFPS = countedFrames / (ticks / 1000.f);
+    cout << "FPS " << avgFPS << " | " << (gCpuPath ? "CPU " : "GPU ") << gParticleCount << " particles"
+         << " | simulation " << gStats.simulationMs / gStats.frames << " ms per frame" << endl;
+
+    memset(&gStats, 0, sizeof(gStats));
+    countedFrames = 0;
+    fpsTimer.start();
+}
+
+// runs the same steps on the CPU and the GPU and compares the results
+bool validate(int particleCount) {
+    vector<State> cpu;
+    resetStates(cpu, particleCount);
+    vector<State> simd(cpu);
+    uploadStates(cpu);
+
+    for (int step = 0; step < VALIDATION_STEPS; step++) {
+        for (size_t i = 0; i < cpu.size(); i++) {
+            integrate(cpu[i], step * DT, DT);
+        }
+        integrateStates(simd.data(), simd.size(), step * DT, DT);
+    }
+    dispatchSteps(particleCount, VALIDATION_STEPS);
+
+    vector<State> gpu;
+    readStates(gpu, particleCount);
+
+    float simdError = 0.0f;
+    float gpuError = 0.0f;
+    for (int i = 0; i < particleCount; i++) {
+        simdError = max(simdError, max(fabs(simd[i].x - cpu[i].x), fabs(simd[i].v - cpu[i].v)));
+        gpuError = max(gpuError, max(fabs(gpu[i].x - cpu[i].x), fabs(gpu[i].v - cpu[i].v)));
+    }
+
+    bool passed = simdError <= VALIDATION_TOLERANCE && gpuError <= VALIDATION_TOLERANCE;
+    cout << "Validation, " << particleCount << " particles x " << VALIDATION_STEPS << " steps against integrate(): "
+         << physicsSimdName() << " max error " << simdError << ", compute shader max error " << gpuError
+         << (passed ? " - passed" : " - FAILED") << endl;
+    return passed;
+}
+
+// particles/sec of the scalar, SIMD and compute shader integrators
+void benchmark(int particleCount, int steps) {
+    vector<State> states;
+    resetStates(states, particleCount);
+    const double work = (double) particleCount * steps;
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    for (int step = 0; step < steps; step++) {
+        for (size_t i = 0; i < states.size(); i++) {
+            integrate(states[i], step * DT, DT);
+        }
+    }
+    double scalarMs = elapsedMs(start);
+
+    start = SDL_GetPerformanceCounter();
+    for (int step = 0; step < steps; step++) {
+        integrateStates(states.data(), states.size(), step * DT, DT);
+    }
+    double simdMs = elapsedMs(start);
+
+    // the CPU path also has to send the states to the GPU every frame
+    start = SDL_GetPerformanceCounter();
+    for (int step = 0; step < steps; step++) {
+        uploadStates(states);
+    }
+    glFinish();
+    double uploadMs = elapsedMs(start);
+
+    // warm up, the first dispatch may compile the shader for the device
+    uploadStates(states);
+    dispatchSteps(particleCount, 1);
+    glFinish();
+    start = SDL_GetPerformanceCounter();
+    dispatchSteps(particleCount, steps);
+    glFinish();
+    double gpuMs = elapsedMs(start);
+
+    cout << "Benchmark, " << particleCount << " particles x " << steps << " steps" << endl;
+    cout << "  CPU scalar:     " << work / scalarMs / 1000.0 << " M particles/sec" << endl;
+    cout << "  CPU " << physicsSimdName() << ":       " << work / simdMs / 1000.0 << " M particles/sec" << endl;
+    cout << "  upload per step: " << uploadMs / steps << " ms" << endl;
+    cout << "  compute shader: " << work / gpuMs / 1000.0 << " M particles/sec" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    int particleCount = 250000;
+    bool runValidation = false;
+    int benchSteps = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--cpu") == 0) {
+            gCpuPath = true;
+        } else if (strcmp(argv[i], "--steps") == 0 && i + 1 < argc) {
+            gStepsPerFrame = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--validate") == 0) {
+            runValidation = true;
+        } else if (strcmp(argv[i], "--bench") == 0 && i + 1 < argc) {
+            benchSteps = atoi(argv[++i]);
+        } else if (atoi(argv[i]) > 0) {
+            particleCount = atoi(argv[i]);
+        } else {
+            cout << "usage: " << argv[0] << " [--cpu] [--steps per frame] [--validate] [--bench steps] [particles]"
+                 << endl;
+            return 1;
+        }
+    }
+
+    if (!initSDL()) {
+        return 1;
+    }
+
+    setOpenGLVersion();
+
+    SDL_Window *window = createSDLWindow();
+    if (window == nullptr) {
+        return 1;
+    }
+
+    SDL_GLContext glContext = initSDLGLContext(window);
+    if (glContext == nullptr) {
+        return 1;
+    }
+
+    if (!initGLEW(window)) {
+        return 1;
+    }
+
+    if (!initGLStructure()) {
+        return 1;
+    }
+
+    gParticleCount = particleCount;
+    while (gGridSide * gGridSide < gParticleCount) {
+        gGridSide++;
+    }
+    loadGlData(gParticleCount);
+
+    if (runValidation || benchSteps > 0) {
+        int result = 0;
+        if (runValidation && !validate(gParticleCount)) {
+            result = 1;
+        }
+        if (benchSteps > 0) {
+            benchmark(gParticleCount, benchSteps);
+        }
+        cleanup(&glContext, window);
+        SDL_Quit();
+        return result;
+    }
+
+    resetStates(gStates, gParticleCount);
+    uploadStates(gStates);
+    memset(&gStats, 0, sizeof(gStats));
+
+    fpsTimer.start();
+
+    while (!quit) {
+        eventHandler();
+        simulate();
+        render();
+
+        SDL_GL_SwapWindow(window);
+
+        gStats.frames++;
+        countedFrames++;
+        calculatePrintStats();
+    }
+
+    // clean up everything
+    glDeleteBuffers(1, &gStateBuffer);
+    glDeleteVertexArrays(1, &gVAO);
+    glDeleteProgram(gComputeProgram);
+    glDeleteProgram(gRenderProgram);
+    cleanup(&glContext, window);
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,438 @@
+//
+// A grid of large textures, more than the memory budget holds, streamed by mip level as the camera moves
+//
+#include <iostream>
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+#include <Timer.h>
+#include <TextureStreamer.h>
+
+using namespace std;
+
+const int SCREEN_WIDTH = 800;
+const int SCREEN_HEIGHT = 600;
+
+// part of a grid cell covered by its quad
+const float QUAD_SIZE = 0.9f;
+
+// Procedural checker board standing in for texture files, each level is
+// generated on demand at its own resolution
+class CheckerTexture : public TextureSource {
+private:
+    int size;
+    uint8_t color[3];
+
+public:
+    CheckerTexture(int size, int id) : size(size) {
+        // a different hue per texture
+        float hue = fmod(id * 0.618034f, 1.f) * 6.f;
+        for (int c = 0; c < 3; c++) {
+            float distance = fabs(fmod(hue + c * 2.f, 6.f) - 3.f);
+            color[c] = (uint8_t) (255.f * min(1.f, max(0.f, distance - 1.f)));
+        }
+    }
+
+    int getWidth() const {
+        return size;
+    }
+
+    int getHeight() const {
+        return size;
+    }
+
+    void loadLevel(int level, std::vector<uint8_t> &texels) {
+        const int levelSize = max(1, size >> level);
+        texels.resize((size_t) levelSize * levelSize * 4);
+        uint8_t *texel = texels.data();
+        for (int y = 0; y < levelSize; y++) {
+            for (int x = 0; x < levelSize; x++) {
+                // level 0 coordinates: 64 texel cells, brighter towards the top
+                int u = x << level;
+                int v = y << level;
+                bool dark = ((u >> 6) + (v >> 6)) & 1;
+                int brightness = 128 + 127 * v / size;
+                for (int c = 0; c < 3; c++) {
+                    *texel++ = (uint8_t) ((dark ? color[c] / 3 : color[c]) * brightness / 255);
+                }
+                *texel++ = 255;
+            }
+        }
+    }
+};
+
+// GL vars
+GLuint gProgram = 0;
+GLuint gVAO = 0;
+GLuint gVBO = 0;
+GLint gQuadLocation = -1;
+GLint gCenterLocation = -1;
+GLint gScaleLocation = -1;
+
+// scene vars
+TextureStreamer *gStreamer = nullptr;
+int gGridSide = 16;
+// camera, in grid cells
+float gCenter[2] = {0.f, 0.f};
+float gViewHeight = 1.f;
+bool gPaused = false;
+int gCameraFrame = 0;
+bool gVsync = true;
+
+// game loop vars
+bool quit = false;
+SDL_Event event;
+
+int countedFrames = 1;
+Timer fpsTimer;
+
+// streaming counters at the last print, and the busiest frame
+TextureStreamerStats gPrintedStats;
+uint64_t gMaxFrameUploadBytes = 0;
+
+bool initSDL() {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        cout << "SDL_Init error " << SDL_GetError() << endl;
+        return false;
+    }
+    return true;
+}
+
+void setOpenGLVersion() {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 4);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 1);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+}
+
+SDL_Window *createSDLWindow() {
+    SDL_Window *window = SDL_CreateWindow("SDL / OpenGL - Texture streaming",
+                                          SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+                                          SCREEN_WIDTH, SCREEN_HEIGHT,
+                                          SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+
+    if (window == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        SDL_Quit();
+        return nullptr;
+    }
+
+    return window;
+}
+
+SDL_GLContext initSDLGLContext(SDL_Window *window) {
+    SDL_GLContext glContext = SDL_GL_CreateContext(window);
+    if (glContext == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        cleanup(window);
+        SDL_Quit();
+        return nullptr;
+    }
+
+    if (!gVsync) {
+        SDL_GL_SetSwapInterval(0);
+    } else if (SDL_GL_SetSwapInterval(1) != 0) {
+        cout << "Warning: unable to set VSync. Error " << SDL_GetError() << endl;
+    }
+
+    return glContext;
+}
+
+bool initGLEW(SDL_Window *window) {
+    GLenum error;
+    glewExperimental = GL_TRUE;
+    error = glewInit();
+    if (GLEW_OK != error) {
+        cout << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        cleanup(window);
+        SDL_Quit();
+        return false;
+    }
+    return true;
+}
+
+GLuint compileShader(GLenum type, const GLchar *source) {
+    GLuint shaderId = glCreateShader(type);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE) {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shaderId, maxLength, NULL, infoLog.data());
+        cout << "Unable to compile shader " << shaderId << endl << infoLog.data() << endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+bool initGLStructure() {
+    // quad = x, y, size of a grid cell's quad
+    const GLchar *vertexShaderSource =
+            "#version 410\n"
+            "layout(location = 0) in vec2 position;\n"
+            "uniform vec3 quad;\n"
+            "uniform vec2 center;\n"
+            "uniform vec2 scale;\n"
+            "out vec2 uv;\n"
+            "void main() {\n"
+            "    uv = position;\n"
+            "    gl_Position = vec4((quad.xy + position * quad.z - center) * scale, 0.0, 1.0);\n"
+            "}";
+
+    const GLchar *fragmentShaderSource =
+            "#version 410\n"
+            "in vec2 uv;\n"
+            "uniform sampler2D image;\n"
+            "out vec4 frag_colour;\n"
+            "void main() { frag_colour = texture(image, uv); }";
+
+    GLuint vertexShaderId = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShaderId = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShaderId == 0 || fragmentShaderId == 0) {
+        return false;
+    }
+
+    gProgram = glCreateProgram();
+    glAttachShader(gProgram, vertexShaderId);
+    glAttachShader(gProgram, fragmentShaderId);
+    glLinkProgram(gProgram);
+    glDeleteShader(vertexShaderId);
+    glDeleteShader(fragmentShaderId);
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(gProgram, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE) {
+        cout << "Error linking program " << gProgram << endl;
+        return false;
+    }
+
+    gQuadLocation = glGetUniformLocation(gProgram, "quad");
+    gCenterLocation = glGetUniformLocation(gProgram, "center");
+    gScaleLocation = glGetUniformLocation(gProgram, "scale");
+    return true;
+}
+
+void loadGlData() {
+    const GLfloat quad[] = {0.f, 0.f, 1.f, 0.f, 1.f, 1.f, 0.f, 1.f};
+
+    glGenBuffers(1, &gVBO);
+    glBindBuffer(GL_ARRAY_BUFFER, gVBO);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+
+    glGenVertexArrays(1, &gVAO);
+    glBindVertexArray(gVAO);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, NULL);
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+void eventHandler() {
+    while (SDL_PollEvent(&event)) {
+        if (event.type == SDL_QUIT) {
+            quit = true;
+        }
+        if (event.type == SDL_KEYDOWN) {
+            switch (event.key.keysym.sym) {
+                case SDLK_q:
+                    quit = true;
+                    break;
+                case SDLK_SPACE:
+                    gPaused = !gPaused;
+                    break;
+            }
+        }
+    }
+}
+
+// flies over the grid, zooming from single cells out to the whole grid
+void moveCamera() {
+    if (!gPaused) {
+        gCameraFrame++;
+    }
+    const float phase = gCameraFrame * 0.004f;
+    const float half = gGridSide * 0.5f;
+    gCenter[0] = half + half * 0.8f * sin(phase * 1.3f);
+    gCenter[1] = half + half * 0.8f * sin(phase * 0.9f);
+    gViewHeight = 1.2f + (gGridSide - 1.2f) * (0.5f + 0.5f * cos(phase * 2.3f));
+}
+
+void render() {
+    glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    const float viewWidth = gViewHeight * SCREEN_WIDTH / SCREEN_HEIGHT;
+    const float pixelsPerCell = SCREEN_HEIGHT / gViewHeight;
+
+    glUseProgram(gProgram);
+    glUniform2f(gCenterLocation, gCenter[0], gCenter[1]);
+    glUniform2f(gScaleLocation, 2.f / viewWidth, 2.f / gViewHeight);
+    glBindVertexArray(gVAO);
+    glActiveTexture(GL_TEXTURE0);
+
+    for (int y = 0; y < gGridSide; y++) {
+        for (int x = 0; x < gGridSide; x++) {
+            // only what is on screen is requested, the rest ages in the LRU
+            if (x + QUAD_SIZE < gCenter[0] - viewWidth * 0.5f || x > gCenter[0] + viewWidth * 0.5f ||
+                y + QUAD_SIZE < gCenter[1] - gViewHeight * 0.5f || y > gCenter[1] + gViewHeight * 0.5f) {
+                continue;
+            }
+            GLuint texture = gStreamer->request(y * gGridSide + x, pixelsPerCell * QUAD_SIZE);
+            glBindTexture(GL_TEXTURE_2D, texture);
+            glUniform3f(gQuadLocation, (float) x, (float) y, QUAD_SIZE);
+            glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
+        }
+    }
+
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glBindVertexArray(0);
+    glUseProgram(0);
+}
+
+double megabytes(uint64_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+void calculatePrintStats() {
+    int ticks = fpsTimer.getTicks();
+    if (ticks < 1000 || countedFrames == 0) {
+        return;
+    }
+
+    const TextureStreamerStats &stats = gStreamer->getStats();
+    long requests = stats.requests - gPrintedStats.requests;
+    long hits = stats.hits - gPrintedStats.hits;
+    uint64_t uploaded = stats.bytesUploaded - gPrintedStats.bytesUploaded;
+
+    float avgFPS = countedFrames / (ticks / 1000.f);
+    cout << "FPS " << avgFPS << " | hit rate " << (requests > 0 ? 100.0 * hits / requests : 100.0) << "%"
+         << " | uploaded " << uploaded / 1024.0 / countedFrames << " KB/frame"
+         << " | resident " << megabytes(gStreamer->getResidentBytes()) << " MB of "
+         << megabytes(gStreamer->getBudgetBytes()) << " MB" << endl;
+
+    gPrintedStats = stats;
+    countedFrames = 0;
+    fpsTimer.start();
+}
+
+void printReport(int frames, double seconds) {
+    const TextureStreamerStats &stats = gStreamer->getStats();
+    cout << "----------------------------------------------------------------" << endl;
+    cout << gStreamer->getCount() << " textures, " << megabytes(gStreamer->getTotalBytes())
+         << " MB with every mip level, budget " << megabytes(gStreamer->getBudgetBytes()) << " MB" << endl;
+    cout << frames << " frames in " << seconds << " s, " << frames / seconds << " frames/sec" << endl;
+    cout << "Hit rate " << (stats.requests > 0 ? 100.0 * stats.hits / stats.requests : 100.0) << "% of "
+         << stats.requests << " requests" << endl;
+    cout << "Uploaded " << megabytes(stats.bytesUploaded) << " MB with the tails, "
+         << stats.bytesUploaded / 1024.0 / max(1, frames) << " KB/frame average, "
+         << gMaxFrameUploadBytes / 1024.0 << " KB in the busiest frame" << endl;
+    cout << "Levels uploaded " << stats.levelsUploaded << ", evicted " << stats.levelsEvicted << endl;
+    cout << "Peak resident " << megabytes(gStreamer->getPeakBytes()) << " MB" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    double budgetMB = 48.0;
+    double uploadKB = 2048.0;
+    int textureSize = 1024;
+    int maxFrames = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--budget-mb") == 0 && i + 1 < argc) {
+            budgetMB = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--upload-kb") == 0 && i + 1 < argc) {
+            uploadKB = atof(argv[++i]);
+        } else if (strcmp(argv[i], "--grid") == 0 && i + 1 < argc) {
+            gGridSide = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--texture-size") == 0 && i + 1 < argc) {
+            textureSize = max(1, atoi(argv[++i]));
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            maxFrames = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--no-vsync") == 0) {
+            gVsync = false;
+        } else {
+            cout << "usage: " << argv[0] << " [--budget-mb mb] [--upload-kb kb per frame] [--grid side]" << endl
+                 << "    [--texture-size power of two] [--frames n] [--no-vsync]" << endl;
+            return 1;
+        }
+    }
+
+    if (!initSDL()) {
+        return 1;
+    }
+
+    setOpenGLVersion();
+
+    SDL_Window *window = createSDLWindow();
+    if (window == nullptr) {
+        return 1;
+    }
+
+    SDL_GLContext glContext = initSDLGLContext(window);
+    if (glContext == nullptr) {
+        return 1;
+    }
+
+    if (!initGLEW(window)) {
+        return 1;
+    }
+
+    if (!initGLStructure()) {
+        return 1;
+    }
+
+    loadGlData();
+
+    // only the tails are uploaded here
+    gStreamer = new TextureStreamer((uint64_t) (budgetMB * 1024 * 1024), (uint64_t) (uploadKB * 1024));
+    for (int i = 0; i < gGridSide * gGridSide; i++) {
+        if (gStreamer->add(new CheckerTexture(textureSize, i)) < 0) {
+            return 1;
+        }
+    }
+
+    gPrintedStats = gStreamer->getStats();
+    fpsTimer.start();
+
+    int frames = 0;
+    Uint64 start = SDL_GetPerformanceCounter();
+    while (!quit) {
+        eventHandler();
+        moveCamera();
+        render();
+
+        uint64_t uploadedBefore = gStreamer->getStats().bytesUploaded;
+        gStreamer->update();
+        gMaxFrameUploadBytes = max(gMaxFrameUploadBytes, gStreamer->getStats().bytesUploaded - uploadedBefore);
+
+        SDL_GL_SwapWindow(window);
+
+        countedFrames++;
+        calculatePrintStats();
+        if (++frames == maxFrames) {
+            quit = true;
+        }
+    }
+    double seconds = (double) (SDL_GetPerformanceCounter() - start) / SDL_GetPerformanceFrequency();
+
+    printReport(frames, seconds);
+
+    // clean up everything, the textures go with the streamer
+    delete gStreamer;
+    gStreamer = nullptr;
+    glDeleteBuffers(1, &gVBO);
+    glDeleteVertexArrays(1, &gVAO);
+    glDeleteProgram(gProgram);
+    cleanup(&glContext, window);
+    SDL_Quit();
+
+    return 0;
+}
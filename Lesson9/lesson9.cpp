@@ -0,0 +1,536 @@
+//
+// Several windows, their GL contexts sharing buffers, textures and programs, each drawn on its own thread
+//
+#include <iostream>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+#include <Cleanup.h>
+
+using namespace std;
+
+const int WINDOW_WIDTH = 480;
+const int WINDOW_HEIGHT = 360;
+const int MAX_WINDOWS = 4;
+const int TEXTURE_SIZE = 64;
+
+// one window, its context and what its thread measured
+struct RenderWindow {
+    int index;
+    SDL_Window *window;
+    SDL_GLContext context;
+    // not shared, VAOs are containers and belong to one context
+    GLuint vao;
+    // written by the thread drawing the window only
+    vector<double> frameMs;
+    Uint64 firstFrameEnd;
+    Uint64 lastFrameEnd;
+    thread renderThread;
+};
+
+// shared by every context, owned by the resource context
+SDL_Window *gResourceWindow = nullptr;
+SDL_GLContext gResourceContext = nullptr;
+GLuint gProgram = 0;
+GLuint gVertexBuffer = 0;
+GLuint gTexture = 0;
+
+RenderWindow gWindows[MAX_WINDOWS];
+bool gVsync = true;
+// synthetic vsync in Hz, 0 for off: a sleep to the next boundary after every swap, for surfaces whose swap
+// doesn't block (offscreen, headless). Boundaries are shared by all windows as on one display.
+double gEmulatedVsyncHz = 0.0;
+const chrono::steady_clock::time_point gVblankOrigin = chrono::steady_clock::now();
+// all windows drawn in turn by the main thread, to compare with a thread each
+bool gSingleThread = false;
+// frames per window, 0 until closed
+long gFrameLimit = 0;
+
+// game loop vars, quit is the user closing, stop ends the render threads
+atomic<bool> quit(false);
+atomic<bool> stop(false);
+atomic<int> gRunningThreads(0);
+SDL_Event event;
+
+double elapsedMs(Uint64 start, Uint64 end) {
+    return (end - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+bool initSDL() {
+    if (SDL_Init(SDL_INIT_VIDEO) != 0) {
+        cout << "SDL_Init error " << SDL_GetError() << endl;
+        return false;
+    }
+    return true;
+}
+
+void setOpenGLVersion() {
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, 3);
+    SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_CORE);
+}
+
+// A hidden window whose context creates the shared objects. Windows come and go, it stays.
+bool initResourceContext() {
+    gResourceWindow = SDL_CreateWindow("SDL / OpenGL - resources", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED,
+                                       1, 1, SDL_WINDOW_HIDDEN | SDL_WINDOW_OPENGL);
+    if (gResourceWindow == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        return false;
+    }
+    gResourceContext = SDL_GL_CreateContext(gResourceWindow);
+    if (gResourceContext == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        return false;
+    }
+
+    GLenum error;
+    glewExperimental = GL_TRUE;
+    error = glewInit();
+    if (GLEW_OK != error) {
+        cout << "GLEWInit error: " << glewGetErrorString(error) << endl;
+        return false;
+    }
+    return true;
+}
+
+GLuint compileShader(GLenum type, const GLchar *source) {
+    GLuint shaderId = glCreateShader(type);
+    glShaderSource(shaderId, 1, &source, NULL);
+    glCompileShader(shaderId);
+
+    GLint shaderCompiled = GL_FALSE;
+    glGetShaderiv(shaderId, GL_COMPILE_STATUS, &shaderCompiled);
+    if (shaderCompiled != GL_TRUE) {
+        GLint maxLength = 0;
+        glGetShaderiv(shaderId, GL_INFO_LOG_LENGTH, &maxLength);
+        vector<char> infoLog(maxLength + 1, 0);
+        glGetShaderInfoLog(shaderId, maxLength, NULL, infoLog.data());
+        cout << "Unable to compile shader " << shaderId << endl << infoLog.data() << endl;
+        glDeleteShader(shaderId);
+        return 0;
+    }
+    return shaderId;
+}
+
+bool initGLStructure() {
+    // uniforms would be shared with the program, so the per-window tint and angle come in as a constant
+    // attribute (location 2), which is context state
+    const GLchar *vertexShaderSource =
+            "#version 330 core\n"
+            "layout(location = 0) in vec2 position;\n"
+            "layout(location = 1) in vec2 texcoord;\n"
+            "layout(location = 2) in vec4 tintAngle;\n"
+            "out vec2 vTexcoord;\n"
+            "out vec3 vTint;\n"
+            "void main() {\n"
+            "    float c = cos(tintAngle.w);\n"
+            "    float s = sin(tintAngle.w);\n"
+            "    gl_Position = vec4(c * position.x - s * position.y, s * position.x + c * position.y, 0.0, 1.0);\n"
+            "    vTexcoord = texcoord;\n"
+            "    vTint = tintAngle.rgb;\n"
+            "}";
+    const GLchar *fragmentShaderSource =
+            "#version 330 core\n"
+            "in vec2 vTexcoord;\n"
+            "in vec3 vTint;\n"
+            "uniform sampler2D checker;\n"
+            "out vec4 fragColor;\n"
+            "void main() { fragColor = vec4(texture(checker, vTexcoord).rgb * vTint, 1.0); }";
+
+    GLuint vertexShader = compileShader(GL_VERTEX_SHADER, vertexShaderSource);
+    GLuint fragmentShader = compileShader(GL_FRAGMENT_SHADER, fragmentShaderSource);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        return false;
+    }
+    gProgram = glCreateProgram();
+    glAttachShader(gProgram, vertexShader);
+    glAttachShader(gProgram, fragmentShader);
+    glLinkProgram(gProgram);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint programSuccess = GL_TRUE;
+    glGetProgramiv(gProgram, GL_LINK_STATUS, &programSuccess);
+    if (programSuccess != GL_TRUE) {
+        cout << "Error linking program " << gProgram << endl;
+        return false;
+    }
+    // set once here, sampler unit 0 for every context
+    glUseProgram(gProgram);
+    glUniform1i(glGetUniformLocation(gProgram, "checker"), 0);
+    glUseProgram(0);
+    return true;
+}
+
+void loadGlData() {
+    // a quad, position and texcoord interleaved
+    const GLfloat quad[] = {
+            -0.6f, -0.6f, 0.f, 0.f,
+            0.6f, -0.6f, 1.f, 0.f,
+            -0.6f, 0.6f, 0.f, 1.f,
+            0.6f, 0.6f, 1.f, 1.f
+    };
+    glGenBuffers(1, &gVertexBuffer);
+    glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+    glBufferData(GL_ARRAY_BUFFER, sizeof(quad), quad, GL_STATIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    vector<GLubyte> texels(TEXTURE_SIZE * TEXTURE_SIZE * 4);
+    for (int y = 0; y < TEXTURE_SIZE; y++) {
+        for (int x = 0; x < TEXTURE_SIZE; x++) {
+            GLubyte value = ((x / 8 + y / 8) % 2) ? 255 : 90;
+            for (int c = 0; c < 4; c++) {
+                texels[(y * TEXTURE_SIZE + x) * 4 + c] = value;
+            }
+        }
+    }
+    glGenTextures(1, &gTexture);
+    glBindTexture(GL_TEXTURE_2D, gTexture);
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, TEXTURE_SIZE, TEXTURE_SIZE, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                 texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // other contexts only see the objects once their creation has completed
+    glFinish();
+}
+
+// Creates the window and a context sharing with the resource context. Left current on no thread.
+bool createRenderWindow(RenderWindow &target, int index) {
+    target.index = index;
+    target.window = nullptr;
+    target.context = nullptr;
+    target.vao = 0;
+    target.frameMs.clear();
+    target.firstFrameEnd = 0;
+    target.lastFrameEnd = 0;
+
+    // a display each while there are enough, side by side on the first one after that
+    int x = SDL_WINDOWPOS_CENTERED_DISPLAY(index);
+    int y = SDL_WINDOWPOS_CENTERED_DISPLAY(index);
+    if (index >= SDL_GetNumVideoDisplays()) {
+        x = 20 + (index % 2) * (WINDOW_WIDTH + 20);
+        y = 40 + (index / 2) * (WINDOW_HEIGHT + 40);
+    }
+    char title[64];
+    snprintf(title, sizeof(title), "SDL / OpenGL - window %d", index + 1);
+    target.window = SDL_CreateWindow(title, x, y, WINDOW_WIDTH, WINDOW_HEIGHT, SDL_WINDOW_SHOWN | SDL_WINDOW_OPENGL);
+    if (target.window == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        return false;
+    }
+
+    // the new context shares with the current one, the resource context
+    SDL_GL_MakeCurrent(gResourceWindow, gResourceContext);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    target.context = SDL_GL_CreateContext(target.window);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    if (target.context == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        return false;
+    }
+
+    // swap interval and VAO belong to the context, set up while it's current here
+    if (!gVsync || gEmulatedVsyncHz > 0.0) {
+        SDL_GL_SetSwapInterval(0);
+    } else if (SDL_GL_SetSwapInterval(1) != 0) {
+        cout << "Warning: unable to set VSync. Error " << SDL_GetError() << endl;
+    }
+    glGenVertexArrays(1, &target.vao);
+    glBindVertexArray(target.vao);
+    glBindBuffer(GL_ARRAY_BUFFER, gVertexBuffer);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), NULL);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(GLfloat), (const GLvoid *) (2 * sizeof(GLfloat)));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    // a context is current on one thread at a time, the render thread takes it
+    SDL_GL_MakeCurrent(target.window, nullptr);
+    return true;
+}
+
+void destroyRenderWindow(RenderWindow &target) {
+    if (target.context != nullptr) {
+        SDL_GL_MakeCurrent(target.window, target.context);
+        glDeleteVertexArrays(1, &target.vao);
+        SDL_GL_MakeCurrent(target.window, nullptr);
+    }
+    cleanup(&target.context, target.window);
+    target.context = nullptr;
+    target.window = nullptr;
+}
+
+// Sleeps to the next emulated vblank, nothing when not emulating
+void waitForEmulatedVblank() {
+    if (gEmulatedVsyncHz <= 0.0) {
+        return;
+    }
+    const chrono::duration<double> period(1.0 / gEmulatedVsyncHz);
+    const chrono::duration<double> sinceOrigin = chrono::steady_clock::now() - gVblankOrigin;
+    const chrono::duration<double> next = period * (floor(sinceOrigin / period) + 1.0);
+    this_thread::sleep_until(gVblankOrigin + chrono::duration_cast<chrono::steady_clock::duration>(next));
+}
+
+// Draws one frame into the window, its context current on the calling thread
+void drawFrame(RenderWindow &target, long frame) {
+    const GLfloat tints[MAX_WINDOWS][3] = {{1.f, 0.4f, 0.4f}, {0.4f, 1.f, 0.4f}, {0.4f, 0.6f, 1.f}, {1.f, 1.f, 0.4f}};
+    const GLfloat *tint = tints[target.index];
+
+    glViewport(0, 0, WINDOW_WIDTH, WINDOW_HEIGHT);
+    glClearColor(0.1f, 0.1f, 0.1f, 1.f);
+    glClear(GL_COLOR_BUFFER_BIT);
+
+    glUseProgram(gProgram);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, gTexture);
+    glBindVertexArray(target.vao);
+    // each window turns at its own speed
+    glVertexAttrib4f(2, tint[0], tint[1], tint[2], frame * 0.01f * (target.index + 1));
+    glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+    glBindVertexArray(0);
+    glBindTexture(GL_TEXTURE_2D, 0);
+    glUseProgram(0);
+}
+
+// The first frame of a context builds the driver's state for it (shader variants...), it's left out of the times
+void recordFrame(RenderWindow &target, long frame, Uint64 &last) {
+    Uint64 now = SDL_GetPerformanceCounter();
+    if (frame == 0) {
+        target.firstFrameEnd = now;
+    } else {
+        target.frameMs.push_back(elapsedMs(last, now));
+    }
+    target.lastFrameEnd = now;
+    last = now;
+}
+
+// render thread of one window: its vsync blocks it and no other window
+void renderLoop(RenderWindow *target) {
+    if (SDL_GL_MakeCurrent(target->window, target->context) != 0) {
+        cout << "SDL_GL_MakeCurrent error " << SDL_GetError() << endl;
+        quit = true;
+        gRunningThreads--;
+        return;
+    }
+
+    Uint64 last = SDL_GetPerformanceCounter();
+    for (long frame = 0; !stop && (gFrameLimit == 0 || frame < gFrameLimit); frame++) {
+        drawFrame(*target, frame);
+        SDL_GL_SwapWindow(target->window);
+        waitForEmulatedVblank();
+        recordFrame(*target, frame, last);
+    }
+
+    SDL_GL_MakeCurrent(target->window, nullptr);
+    gRunningThreads--;
+}
+
+// all windows from the calling thread, one context after the other
+void renderSequential(int windowCount) {
+    Uint64 last[MAX_WINDOWS];
+    for (int i = 0; i < windowCount; i++) {
+        last[i] = SDL_GetPerformanceCounter();
+    }
+    for (long frame = 0; !quit && (gFrameLimit == 0 || frame < gFrameLimit); frame++) {
+        for (int i = 0; i < windowCount; i++) {
+            RenderWindow &target = gWindows[i];
+            SDL_GL_MakeCurrent(target.window, target.context);
+            drawFrame(target, frame);
+            SDL_GL_SwapWindow(target.window);
+            waitForEmulatedVblank();
+            recordFrame(target, frame, last[i]);
+        }
+
+        while (SDL_PollEvent(&event) != 0) {
+            if (event.type == SDL_QUIT ||
+                (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) ||
+                (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE)) {
+                quit = true;
+            }
+        }
+    }
+    SDL_GL_MakeCurrent(gWindows[0].window, nullptr);
+}
+
+// windows and events stay on the main thread, SDL wants them there
+void eventHandler() {
+    while (SDL_PollEvent(&event) != 0) {
+        if (event.type == SDL_QUIT ||
+            (event.type == SDL_KEYDOWN && event.key.keysym.sym == SDLK_ESCAPE) ||
+            (event.type == SDL_WINDOWEVENT && event.window.event == SDL_WINDOWEVENT_CLOSE)) {
+            quit = true;
+        }
+    }
+}
+
+struct RunStats {
+    double wallMs;
+    long frames;
+};
+
+// Draws with windowCount windows until closed or gFrameLimit frames each, prints each window's frame times
+RunStats run(int windowCount) {
+    RunStats stats = {0.0, 0};
+    for (int i = 0; i < windowCount; i++) {
+        if (!createRenderWindow(gWindows[i], i)) {
+            for (int j = 0; j <= i; j++) {
+                destroyRenderWindow(gWindows[j]);
+            }
+            quit = true;
+            return stats;
+        }
+    }
+
+    if (gSingleThread) {
+        renderSequential(windowCount);
+    } else {
+        stop = false;
+        gRunningThreads = windowCount;
+        for (int i = 0; i < windowCount; i++) {
+            gWindows[i].renderThread = thread(renderLoop, &gWindows[i]);
+        }
+        // the threads end at the frame limit, or when asked to on quit
+        while (gRunningThreads > 0 && !quit) {
+            eventHandler();
+            SDL_Delay(1);
+        }
+        stop = true;
+        for (int i = 0; i < windowCount; i++) {
+            gWindows[i].renderThread.join();
+        }
+    }
+    // from the first timed frame of any window to the last frame of all
+    Uint64 start = 0;
+    Uint64 end = 0;
+    for (int i = 0; i < windowCount; i++) {
+        if (gWindows[i].firstFrameEnd != 0) {
+            start = start == 0 ? gWindows[i].firstFrameEnd : min(start, gWindows[i].firstFrameEnd);
+            end = max(end, gWindows[i].lastFrameEnd);
+        }
+    }
+    stats.wallMs = elapsedMs(start, end);
+
+    cout << windowCount << (windowCount == 1 ? " window" : " windows")
+         << (gSingleThread ? ", one thread" : ", a thread each");
+    if (gEmulatedVsyncHz > 0.0) {
+        cout << ", synthetic vsync emulated at " << gEmulatedVsyncHz << " Hz by sleeping" << endl;
+    } else {
+        cout << (gVsync ? ", vsync" : ", no vsync") << endl;
+    }
+    for (int i = 0; i < windowCount; i++) {
+        vector<double> &frameMs = gWindows[i].frameMs;
+        stats.frames += (long) frameMs.size();
+        if (frameMs.empty()) {
+            continue;
+        }
+        double total = 0.0;
+        for (size_t f = 0; f < frameMs.size(); f++) {
+            total += frameMs[f];
+        }
+        vector<double> sorted(frameMs);
+        sort(sorted.begin(), sorted.end());
+        char line[160];
+        snprintf(line, sizeof(line), "  window %d: %ld frames, %.2f ms average (%.1f fps), p50 %.2f p99 %.2f max %.2f",
+                 i + 1, (long) frameMs.size(), total / frameMs.size(), frameMs.size() * 1000.0 / total,
+                 sorted[sorted.size() / 2], sorted[min(sorted.size() - 1, sorted.size() * 99 / 100)],
+                 sorted.back());
+        cout << line << endl;
+    }
+
+    for (int i = 0; i < windowCount; i++) {
+        destroyRenderWindow(gWindows[i]);
+    }
+    return stats;
+}
+
+int main(int argc, char *argv[]) {
+    int windowCount = 2;
+    bool scaling = false;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--windows") == 0 && i + 1 < argc) {
+            windowCount = atoi(argv[++i]);
+            valid = windowCount >= 1 && windowCount <= MAX_WINDOWS;
+        } else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc) {
+            gFrameLimit = atol(argv[++i]);
+            valid = gFrameLimit > 0;
+        } else if (strcmp(argv[i], "--scaling") == 0) {
+            scaling = true;
+        } else if (strcmp(argv[i], "--single-thread") == 0) {
+            gSingleThread = true;
+        } else if (strcmp(argv[i], "--no-vsync") == 0) {
+            gVsync = false;
+        } else if (strcmp(argv[i], "--emulate-vsync") == 0 && i + 1 < argc) {
+            gEmulatedVsyncHz = atof(argv[++i]);
+            valid = gEmulatedVsyncHz > 0.0;
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || (!gVsync && gEmulatedVsyncHz > 0.0)) {
+        cout << "usage: " << argv[0] << endl
+             << "    [--windows 1-4] [--frames per window] [--scaling] [--single-thread]" << endl
+             << "    [--no-vsync | --emulate-vsync hz]" << endl;
+        return 1;
+    }
+    // the scaling runs need an end
+    if (scaling && gFrameLimit == 0) {
+        gFrameLimit = 300;
+    }
+
+    if (!initSDL()) {
+        return 1;
+    }
+
+    setOpenGLVersion();
+
+    if (!initResourceContext() || !initGLStructure()) {
+        cleanup(&gResourceContext, gResourceWindow);
+        SDL_Quit();
+        return 1;
+    }
+    loadGlData();
+    cout << "GL " << glGetString(GL_RENDERER) << ", " << SDL_GetNumVideoDisplays() << " display(s)" << endl;
+    SDL_GL_MakeCurrent(gResourceWindow, nullptr);
+
+    if (scaling) {
+        // frames per second over all windows, against what one window gets
+        vector<RunStats> runs;
+        for (int count = 1; count <= windowCount && !quit; count++) {
+            runs.push_back(run(count));
+        }
+        cout << (gEmulatedVsyncHz > 0.0 ? "Scaling, synthetic vsync:" : "Scaling:") << endl;
+        for (size_t i = 0; i < runs.size() && runs[0].wallMs > 0.0 && runs[i].wallMs > 0.0; i++) {
+            const double fps = runs[i].frames * 1000.0 / runs[i].wallMs;
+            const double oneWindowFps = runs[0].frames * 1000.0 / runs[0].wallMs;
+            char line[128];
+            snprintf(line, sizeof(line), "  %d: %.1f frames/sec in total, %.1f per window, %.2fx one window",
+                     (int) i + 1, fps, fps / (i + 1), fps / oneWindowFps);
+            cout << line << endl;
+        }
+    } else {
+        run(windowCount);
+    }
+
+    // clean up everything
+    SDL_GL_MakeCurrent(gResourceWindow, gResourceContext);
+    glDeleteTextures(1, &gTexture);
+    glDeleteBuffers(1, &gVertexBuffer);
+    glDeleteProgram(gProgram);
+    cleanup(&gResourceContext, gResourceWindow);
+    SDL_Quit();
+
+    return 0;
+}
@@ -0,0 +1,213 @@
+//
+// Offline OBJ -> binary mesh converter, plus a load benchmark of both formats
+//
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <MeshFile.h>
+#include <MeshOptimizer.h>
+#include <ObjLoader.h>
+
+using namespace std;
+
+double secondsSince(const chrono::steady_clock::time_point &start) {
+    return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+// peak resident set size in bytes
+size_t peakMemory() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+#ifdef __APPLE__
+    return (size_t) usage.ru_maxrss;
+#else
+    return (size_t) usage.ru_maxrss * 1024;
+#endif
+}
+
+double megabytes(size_t bytes) {
+    return bytes / (1024.0 * 1024.0);
+}
+
+// bytes per vertex over all streams of a written file
+uint32_t streamBytesPerVertex(const MeshFile &meshFile) {
+    uint32_t bytes = 0;
+    for (uint32_t i = 0; i < meshFile.getHeader().streamCount; i++) {
+        bytes += meshFile.getStream((int) i).stride;
+    }
+    return bytes;
+}
+
+int convert(const string &objPath, const string &meshPath, bool optimize, const MeshWriteOptions &options) {
+    MeshData mesh;
+    auto start = chrono::steady_clock::now();
+    if (!loadObj(objPath, mesh)) {
+        return 1;
+    }
+    cout << "Parsed " << objPath << " in " << secondsSince(start) * 1000.0 << " ms: "
+         << mesh.vertexCount() << " vertices, " << mesh.indices.size() / 3 << " triangles, "
+         << mesh.submeshes.size() << " submeshes" << endl;
+
+    const uint32_t floatBytes = (uint32_t) ((mesh.positions.size() + mesh.normals.size() + mesh.texcoords.size()) *
+                                            sizeof(float) / max<size_t>(mesh.vertexCount(), 1));
+    const float acmr16 = computeAcmr(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 16);
+    const float acmr32 = computeAcmr(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 32);
+
+    if (optimize) {
+        start = chrono::steady_clock::now();
+        optimizeMesh(mesh);
+        cout << "Optimized in " << secondsSince(start) * 1000.0 << " ms" << endl;
+    }
+
+    if (!writeMeshFile(meshPath, mesh, options)) {
+        return 1;
+    }
+
+    MeshFile meshFile;
+    if (!meshFile.open(meshPath)) {
+        return 1;
+    }
+    cout << "Wrote " << meshPath << " (positions " << meshFormatName(options.positionFormat)
+         << ", normals " << meshFormatName(options.normalFormat)
+         << ", texcoords " << meshFormatName(options.texcoordFormat) << ")" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+    cout << "                  before    after" << endl;
+    cout << "ACMR (FIFO 16):   " << acmr16 << "    "
+         << computeAcmr(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 16) << endl;
+    cout << "ACMR (FIFO 32):   " << acmr32 << "    "
+         << computeAcmr(mesh.indices.data(), mesh.indices.size(), mesh.vertexCount(), 32) << endl;
+    cout << "Bytes per vertex: " << floatBytes << "        " << streamBytesPerVertex(meshFile) << endl;
+    cout << "File size:        " << megabytes(meshFile.getFileSize()) << " MB" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+    return 0;
+}
+
+// n x n quads on a gently waving surface
+int generateGrid(int n, const string &objPath) {
+    FILE *file = fopen(objPath.c_str(), "w");
+    if (file == nullptr) {
+        cout << "Unable to open " << objPath << " for writing" << endl;
+        return 1;
+    }
+
+    fprintf(file, "o grid\n");
+    for (int y = 0; y <= n; y++) {
+        for (int x = 0; x <= n; x++) {
+            float u = (float) x / n;
+            float v = (float) y / n;
+            float z = 0.05f * sinf(u * 20.0f) * cosf(v * 20.0f);
+            fprintf(file, "v %f %f %f\nvn 0 0 1\nvt %f %f\n", u * 2.0f - 1.0f, v * 2.0f - 1.0f, z, u, v);
+        }
+    }
+    for (int y = 0; y < n; y++) {
+        for (int x = 0; x < n; x++) {
+            int a = y * (n + 1) + x + 1;
+            int b = a + 1;
+            int c = a + n + 2;
+            int d = a + n + 1;
+            fprintf(file, "f %d/%d/%d %d/%d/%d %d/%d/%d %d/%d/%d\n", a, a, a, b, b, b, c, c, c, d, d, d);
+        }
+    }
+    fclose(file);
+
+    cout << "Wrote " << objPath << ": " << 2 * n * n << " triangles" << endl;
+    return 0;
+}
+
+int benchmark(const string &objPath, const string &meshPath) {
+    // mesh file first, the OBJ parse would hide its footprint in the peak
+    size_t memoryBefore = peakMemory();
+    auto start = chrono::steady_clock::now();
+    MeshFile meshFile;
+    if (!meshFile.open(meshPath)) {
+        return 1;
+    }
+    double openSeconds = secondsSince(start);
+
+    // read every byte once, like the GL upload does
+    unsigned long long sum = 0;
+    const MeshFileHeader header = meshFile.getHeader();
+    for (uint32_t i = 0; i < header.streamCount; i++) {
+        const MeshStream &stream = meshFile.getStream((int) i);
+        const unsigned char *data = (const unsigned char *) meshFile.getStreamData(stream);
+        for (uint64_t b = 0; b < stream.bytes; b += 64) {
+            sum += data[b];
+        }
+    }
+    const unsigned char *indices = (const unsigned char *) meshFile.getIndexData();
+    for (uint64_t b = 0; b < header.indexBytes; b += 64) {
+        sum += indices[b];
+    }
+    double meshSeconds = secondsSince(start);
+    size_t meshMemory = peakMemory() - memoryBefore;
+    size_t fileSize = meshFile.getFileSize();
+    meshFile.close();
+
+    memoryBefore = peakMemory();
+    start = chrono::steady_clock::now();
+    MeshData mesh;
+    if (!loadObj(objPath, mesh)) {
+        return 1;
+    }
+    double objSeconds = secondsSince(start);
+    size_t objMemory = peakMemory() - memoryBefore;
+
+    cout << "----------------------------------------------------------------" << endl;
+    cout << "Triangles: " << header.indexCount / 3 << ", vertices: " << header.vertexCount << endl;
+    cout << "OBJ  parse:        " << objSeconds * 1000.0 << " ms, peak memory +"
+         << megabytes(objMemory) << " MB (mesh arrays " << megabytes(mesh.memoryBytes()) << " MB)" << endl;
+    cout << "mesh mmap:         " << openSeconds * 1000.0 << " ms" << endl;
+    cout << "mesh mmap + read:  " << meshSeconds * 1000.0 << " ms, peak memory +"
+         << megabytes(meshMemory) << " MB (file " << megabytes(fileSize) << " MB, page cache backed)" << endl;
+    cout << "Speedup: " << objSeconds / meshSeconds << "x" << " (checksum " << sum << ")" << endl;
+    cout << "----------------------------------------------------------------" << endl;
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc == 4 && strcmp(argv[1], "--grid") == 0 && atoi(argv[2]) > 0) {
+        return generateGrid(atoi(argv[2]), argv[3]);
+    }
+    if (argc == 4 && strcmp(argv[1], "--bench") == 0) {
+        return benchmark(argv[2], argv[3]);
+    }
+
+    bool optimize = false;
+    MeshWriteOptions options;
+    vector<string> paths;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--optimize") == 0) {
+            optimize = true;
+        } else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc) {
+            valid = parseMeshFormat(argv[++i], options.positionFormat) &&
+                    options.positionFormat != MESH_FORMAT_SNORM_10_10_10_2;
+        } else if (strcmp(argv[i], "--normals") == 0 && i + 1 < argc) {
+            valid = parseMeshFormat(argv[++i], options.normalFormat);
+        } else if (strcmp(argv[i], "--texcoords") == 0 && i + 1 < argc) {
+            valid = parseMeshFormat(argv[++i], options.texcoordFormat) &&
+                    options.texcoordFormat != MESH_FORMAT_SNORM_10_10_10_2;
+        } else if (argv[i][0] != '-') {
+            paths.push_back(argv[i]);
+        } else {
+            valid = false;
+        }
+    }
+    if (valid && paths.size() == 2) {
+        return convert(paths[0], paths[1], optimize, options);
+    }
+
+    cout << "usage: " << argv[0] << " [--optimize] [--positions float|snorm16|half]" << endl
+         << "           [--normals float|snorm16|half|10_10_10_2] [--texcoords float|snorm16|half]" << endl
+         << "           input.obj output.mesh" << endl
+         << "       " << argv[0] << " --grid n output.obj       (n x n quads, 1M+ triangles from n = 708)" << endl
+         << "       " << argv[0] << " --bench input.obj input.mesh" << endl;
+    return 1;
+}
@@ -0,0 +1,117 @@
+//
+// Samples the metrics a lesson publishes with --metrics, for external monitoring
+//
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <unistd.h>
+#include <Metrics.h>
+
+using namespace std;
+
+// resident set size of the publisher, -1 once it is gone. Read here so the
+// render loop never pays for it.
+long long residentBytes(uint32_t pid) {
+    char path[64];
+    snprintf(path, sizeof(path), "/proc/%u/statm", pid);
+    FILE *file = fopen(path, "r");
+    if (file == nullptr) {
+        return -1;
+    }
+    long long pages = 0;
+    long long resident = 0;
+    int read = fscanf(file, "%lld %lld", &pages, &resident);
+    fclose(file);
+    if (read != 2) {
+        return -1;
+    }
+    return resident * sysconf(_SC_PAGESIZE);
+}
+
+void printText(const MetricsSample &sample, double fps, long long rss) {
+    cout << "frame " << sample.frame << " | " << fps << " fps | frame " << sample.frameMs << " ms, p50 "
+         << sample.frameMsP50 << " p90 " << sample.frameMsP90 << " p99 " << sample.frameMsP99 << " max "
+         << sample.frameMsMax << " | gpu " << sample.gpuMs << " ms | " << sample.drawCalls << " draws | "
+         << sample.simulationSteps << " steps | dropped " << sample.droppedFrames << " | "
+         << sample.memoryBytes / 1024 << " KB app, " << rss / 1024 << " KB resident" << endl;
+}
+
+void printJson(const MetricsSample &sample, double fps, long long rss) {
+    cout << "{\"frame\":" << sample.frame << ",\"time_ns\":" << sample.timeNs << ",\"fps\":" << fps
+         << ",\"frame_ms\":" << sample.frameMs << ",\"frame_ms_p50\":" << sample.frameMsP50
+         << ",\"frame_ms_p90\":" << sample.frameMsP90 << ",\"frame_ms_p99\":" << sample.frameMsP99
+         << ",\"frame_ms_max\":" << sample.frameMsMax << ",\"gpu_ms\":" << sample.gpuMs
+         << ",\"draw_calls\":" << sample.drawCalls << ",\"simulation_steps\":" << sample.simulationSteps
+         << ",\"dropped_frames\":" << sample.droppedFrames << ",\"memory_bytes\":" << sample.memoryBytes
+         << ",\"resident_bytes\":" << rss << "}" << endl;
+}
+
+int main(int argc, char *argv[]) {
+    string name;
+    double rate = 1.0;
+    long count = 0;
+    bool json = false;
+    bool valid = true;
+    for (int i = 1; i < argc && valid; i++) {
+        if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc) {
+            rate = atof(argv[++i]);
+            valid = rate > 0.0;
+        } else if (strcmp(argv[i], "--count") == 0 && i + 1 < argc) {
+            count = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--json") == 0) {
+            json = true;
+        } else if (argv[i][0] == '/' && name.empty()) {
+            name = argv[i];
+        } else {
+            valid = false;
+        }
+    }
+    if (!valid || name.empty()) {
+        cout << "usage: " << argv[0] << " /name [--rate samples per second] [--count samples] [--json]" << endl;
+        return 1;
+    }
+
+    MetricsReader reader;
+    if (!reader.open(name)) {
+        return 1;
+    }
+    const uint32_t pid = reader.getPid();
+
+    MetricsSample last;
+    memset(&last, 0, sizeof(last));
+    const chrono::duration<double> period(1.0 / rate);
+    auto next = chrono::steady_clock::now();
+    for (long sampled = 0; count <= 0 || sampled < count; sampled++) {
+        this_thread::sleep_until(next);
+        next += chrono::duration_cast<chrono::steady_clock::duration>(period);
+
+        long long rss = residentBytes(pid);
+        if (rss < 0) {
+            cout << "Publisher " << pid << " exited" << endl;
+            return 0;
+        }
+
+        MetricsSample sample;
+        if (!reader.read(sample)) {
+            // the writer is never blocked, try again next period
+            cout << "Busy, sample skipped" << endl;
+            continue;
+        }
+
+        double fps = 0.0;
+        if (last.frame != 0 && sample.timeNs > last.timeNs) {
+            fps = (sample.frame - last.frame) * 1e9 / (sample.timeNs - last.timeNs);
+        }
+        if (json) {
+            printJson(sample, fps, rss);
+        } else {
+            printText(sample, fps, rss);
+        }
+        last = sample;
+    }
+    return 0;
+}
@@ -0,0 +1,83 @@
+#ifndef SDLTUTORIALS_BVH_H
+#define SDLTUTORIALS_BVH_H
+
+#include <vector>
+#include "Math3D.h"
+
+// Axis aligned bounding box of one object
+struct AABB {
+    Vec3 min;
+    Vec3 max;
+};
+
+// Six planes (a, b, c, d) pointing inwards: left, right, bottom, top, near, far
+struct Frustum {
+    float planes[6][4];
+};
+
+// Extracts the frustum planes from a view-projection matrix (Gribb/Hartmann)
+Frustum frustumFromMatrix(const Mat4 &viewProjection);
+
+struct CullStats {
+    int visible;
+    int culled;
+    int nodesVisited;
+};
+
+/*
+ * Bounding volume hierarchy over a fixed set of objects.
+ * build() sorts the objects into leaves once; when objects move, refit()
+ * only updates the boxes of the touched leaves and their ancestors instead
+ * of rebuilding the tree. cull() walks the tree and tests the objects of
+ * partially visible leaves four at a time with SSE.
+ */
+class Bvh {
+private:
+    struct Node {
+        AABB bounds;
+        // index of the first child, the second one is left + 1. -1 for leaves
+        int left;
+        int parent;
+        // range of slots covered by this node
+        int begin;
+        int count;
+    };
+
+    std::vector<Node> nodes;
+
+    // slot -> object, object -> slot and slot -> leaf
+    std::vector<int> slotObject;
+    std::vector<int> objectSlot;
+    std::vector<int> slotLeaf;
+
+    // object centres and half extents by slot (SoA for the SIMD leaf test)
+    std::vector<float> centerX, centerY, centerZ;
+    std::vector<float> extentX, extentY, extentZ;
+
+    std::vector<unsigned char> dirty;
+
+    void storeSlot(int slot, const AABB &box);
+    void updateLeafBounds(Node &node);
+    void cullLeaf(const Frustum &frustum, const Node &node, int planeMask, std::vector<int> &visible) const;
+
+public:
+    // max number of objects stored in a leaf
+    static const int LEAF_SIZE = 8;
+
+    Bvh();
+
+    // Builds the tree from scratch, object i uses bounds[i]
+    void build(const std::vector<AABB> &bounds);
+
+    // Updates the boxes of movedObjects and refits the nodes above them
+    void refit(const std::vector<AABB> &bounds, const std::vector<int> &movedObjects);
+
+    // Appends the visible object ids to visible
+    void cull(const Frustum &frustum, std::vector<int> &visible, CullStats &stats) const;
+
+    int nodeCount() const;
+    int objectCount() const;
+};
+
+
+#endif //SDLTUTORIALS_BVH_H
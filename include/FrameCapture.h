@@ -0,0 +1,89 @@
+#ifndef SDLTUTORIALS_FRAMECAPTURE_H
+#define SDLTUTORIALS_FRAMECAPTURE_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+
+/*
+ * Records the rendered frames without stalling the GL pipeline.
+ *
+ * capture() starts an asynchronous glReadPixels into one pixel pack buffer
+ * of a ring and maps the buffer filled RING_SIZE - 1 frames earlier, which
+ * the GPU has normally finished by then (a fence tells for sure). The pixels
+ * are copied out of the mapping and encoded to disk by a worker thread.
+ * When the worker falls behind, frames are dropped instead of blocking.
+ */
+class FrameCapture {
+public:
+    enum Format {
+        FORMAT_RAW,  // RGBA8, top row first, no header
+        FORMAT_PPM,
+        FORMAT_PNG   // needs SDL2_image
+    };
+
+    static const int RING_SIZE = 3;
+    static const int MAX_QUEUED_FRAMES = 8;
+
+private:
+    struct Frame {
+        int number;
+        std::vector<unsigned char> pixels;
+    };
+
+    int width;
+    int height;
+    std::string directory;
+    Format format;
+
+    GLuint pixelBuffers[RING_SIZE];
+    GLsync fences[RING_SIZE];
+    int bufferFrame[RING_SIZE];
+    int frameNumber;
+
+    // worker state
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::deque<Frame> queue;
+    std::vector<std::vector<unsigned char> > freeBuffers;
+    bool stopping;
+
+    int framesWritten;
+    int framesDropped;
+    int stalls;
+
+    void readBack(int slot);
+    void workerLoop();
+    bool encode(const Frame &frame);
+
+public:
+    FrameCapture(int width, int height, const std::string &directory, Format format);
+    ~FrameCapture();
+
+    // Creates the pixel buffers and starts the encoder, needs a current GL context
+    bool init();
+
+    // Call after rendering a frame, before swapping
+    void capture();
+
+    // Reads back the frames still in flight
+    void flush();
+
+    // Flushes and waits until every queued frame is on disk
+    void finish();
+
+    int getFramesWritten();
+    int getFramesDropped();
+    // times a mapped buffer was not ready yet and we had to wait for the GPU
+    int getStalls() const;
+
+    static bool parseFormat(const std::string &name, Format &format);
+};
+
+
+#endif //SDLTUTORIALS_FRAMECAPTURE_H
@@ -0,0 +1,94 @@
+#ifndef SDLTUTORIALS_FRAMEPIPELINE_H
+#define SDLTUTORIALS_FRAMEPIPELINE_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+
+/*
+ * Runs GL submission and presentation on a render thread, so the main
+ * thread can sample input, simulate and record frame N+1 while frame N is
+ * drawn and presented.
+ *
+ * A frame occupies one of framesInFlight slots from beginFrame() until the
+ * GPU has finished it (a fence after the swap), so per slot resources such
+ * as streamed vertex buffers can be rewritten without the driver having to
+ * synchronize. With 1 frame in flight everything runs in sequence.
+ *
+ * Latency is measured from the input sample time given to submitFrame() to
+ * the GPU timestamp written after the frame's swap, i.e. until the frame is
+ * ready to scan out; the display's own delay is not included.
+ */
+class FramePipeline {
+public:
+    static const int MAX_FRAMES_IN_FLIGHT = 3;
+
+    // draws a frame from the data recorded in the slot, on the render thread
+    typedef std::function<void(int slot)> RenderFunction;
+
+private:
+    int framesInFlight;
+    SDL_Window *window;
+    SDL_GLContext context;
+    RenderFunction render;
+
+    std::thread renderThread;
+    std::mutex mutex;
+    std::condition_variable frameQueued;
+    std::condition_variable slotFreed;
+    std::deque<int> queued;
+    std::vector<int> freeSlots;
+    bool stopping;
+
+    // render thread only: frames submitted to the GPU, oldest first
+    std::deque<int> gpuFrames;
+    GLsync fences[MAX_FRAMES_IN_FLIGHT];
+    GLuint timestampQueries[MAX_FRAMES_IN_FLIGHT];
+    Uint64 inputTimes[MAX_FRAMES_IN_FLIGHT];
+    // GL_TIMESTAMP minus the performance counter, both in ns
+    double gpuClockOffsetNs;
+
+    std::vector<double> latenciesMs;
+    int frames;
+    double mainWaitMs;
+    double fenceWaitMs;
+
+    void renderLoop();
+    bool retireOldest(GLuint64 timeoutNs);
+    double counterToNs(Uint64 counter) const;
+
+public:
+    FramePipeline(int framesInFlight);
+    ~FramePipeline();
+
+    // Moves the context, current on the caller, to the render thread
+    bool start(SDL_Window *window, SDL_GLContext context, RenderFunction render);
+
+    // Main thread: waits for a free slot and returns it
+    int beginFrame();
+    // Main thread: hands the recorded slot to the render thread
+    void submitFrame(int slot, Uint64 inputTime);
+
+    // Draws the queued frames, waits for the GPU and makes the context
+    // current on the caller again
+    void stop();
+
+    int getFramesInFlight() const;
+    int getFrames() const;
+    double getAverageLatencyMs() const;
+    // p in [0, 1]
+    double getLatencyPercentileMs(double p) const;
+    double getMaxLatencyMs() const;
+    // main thread blocked in beginFrame()
+    double getMainWaitMs() const;
+    // render thread blocked on GPU fences
+    double getFenceWaitMs() const;
+};
+
+
+#endif //SDLTUTORIALS_FRAMEPIPELINE_H
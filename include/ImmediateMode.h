@@ -0,0 +1,67 @@
+#ifndef SDLTUTORIALS_IMMEDIATEMODE_H
+#define SDLTUTORIALS_IMMEDIATEMODE_H
+
+#include <GL/glew.h>
+
+/*
+ * glBegin/glEnd style drawing that also runs on core profile contexts.
+ *
+ * The batched backend converts every primitive to points, lines or
+ * triangles and appends it to one CPU vertex buffer; consecutive primitives
+ * of the same kind become a single draw. imFlush() uploads the buffer once
+ * and issues the draws, it must run before the frame is swapped and before
+ * any other GL call that has to see the pending primitives (clears, blend
+ * state, ...). imPointSize and imLoadMatrixf flush by themselves.
+ *
+ * The native backend forwards to the real glBegin/glEnd, for compatibility
+ * contexts and for comparing both paths. Positions go through imLoadMatrixf
+ * only, the fixed function matrix stack isn't emulated.
+ *
+ * Define IMMEDIATE_MODE_REDIRECT before including this header to keep
+ * legacy code calling glBegin/glVertex/glColor/glEnd unchanged.
+ */
+enum ImBackend {
+    IM_BACKEND_NATIVE,
+    IM_BACKEND_BATCHED
+};
+
+struct ImStats {
+    // batched backend only
+    long vertices;
+    // the native backend counts one per glBegin/glEnd pair
+    int drawCalls;
+    int flushes;
+};
+
+// Needs a current context, GL 3.2 or newer for the batched backend
+bool imInit(ImBackend backend);
+void imShutdown();
+
+void imBegin(GLenum mode);
+void imEnd();
+void imVertex2f(GLfloat x, GLfloat y);
+void imVertex3f(GLfloat x, GLfloat y, GLfloat z);
+void imColor3f(GLfloat r, GLfloat g, GLfloat b);
+void imColor4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a);
+void imPointSize(GLfloat size);
+// column major model-view-projection matrix, identity by default
+void imLoadMatrixf(const GLfloat *matrix);
+
+// Draws everything buffered since the last flush
+void imFlush();
+
+ImStats imGetStats();
+void imResetStats();
+
+#ifdef IMMEDIATE_MODE_REDIRECT
+#define glBegin imBegin
+#define glEnd imEnd
+#define glVertex2f imVertex2f
+#define glVertex3f imVertex3f
+#define glColor3f imColor3f
+#define glColor4f imColor4f
+#define glPointSize imPointSize
+#endif
+
+
+#endif //SDLTUTORIALS_IMMEDIATEMODE_H
@@ -0,0 +1,70 @@
+#ifndef SDLTUTORIALS_INPUTRECORDER_H
+#define SDLTUTORIALS_INPUTRECORDER_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include <SDL.h>
+
+/*
+ * Compact binary log of the input of a game loop, so a run can be replayed
+ * deterministically.
+ *
+ * Layout (little endian):
+ *   header: "SDLR", uint32 version
+ *   frame:  float deltaTime, uint16 eventCount, eventCount * event
+ *   event:  uint32 type, int32 key, uint8 windowEvent
+ *
+ * Only the event fields the lessons look at are kept: quit, key and window
+ * events. Anything else is not recorded.
+ */
+class InputRecorder {
+private:
+    FILE *file;
+    std::vector<unsigned char> buffer;
+    std::vector<SDL_Event> frameEvents;
+    int frames;
+
+    void flushBuffer();
+
+public:
+    InputRecorder();
+    ~InputRecorder();
+
+    bool open(const std::string &path);
+    void close();
+
+    // Events are kept until endFrame() writes them with the frame delta time
+    void recordEvent(const SDL_Event &event);
+    void endFrame(float deltaTime);
+
+    int getFrames() const;
+};
+
+class InputPlayer {
+private:
+    std::vector<unsigned char> data;
+    size_t position;
+
+public:
+    InputPlayer();
+
+    // Reads the whole recording in memory
+    bool open(const std::string &path);
+
+    // Next recorded frame, false at the end of the recording
+    bool nextFrame(float &deltaTime, std::vector<SDL_Event> &events);
+};
+
+// FNV-1a, used to checksum the simulation state
+inline unsigned long long fnv1a(const void *bytes, size_t size, unsigned long long hash = 14695981039346656037ULL) {
+    const unsigned char *p = (const unsigned char *) bytes;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+
+#endif //SDLTUTORIALS_INPUTRECORDER_H
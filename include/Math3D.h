@@ -0,0 +1,118 @@
+#ifndef SDLTUTORIALS_MATH3D_H
+#define SDLTUTORIALS_MATH3D_H
+
+#include <cmath>
+
+/*
+ * Minimal vector / matrix helpers used by the lessons that need a camera.
+ * Matrices are column-major, the same layout glUniformMatrix4fv expects
+ * with transpose = GL_FALSE.
+ */
+struct Vec3 {
+    float x;
+    float y;
+    float z;
+};
+
+inline Vec3 vec3(float x, float y, float z) {
+    Vec3 v;
+    v.x = x;
+    v.y = y;
+    v.z = z;
+    return v;
+}
+
+inline Vec3 operator+(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.x + b.x, a.y + b.y, a.z + b.z);
+}
+
+inline Vec3 operator-(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.x - b.x, a.y - b.y, a.z - b.z);
+}
+
+inline Vec3 operator*(const Vec3 &a, float s) {
+    return vec3(a.x * s, a.y * s, a.z * s);
+}
+
+inline float dot(const Vec3 &a, const Vec3 &b) {
+    return a.x * b.x + a.y * b.y + a.z * b.z;
+}
+
+inline Vec3 cross(const Vec3 &a, const Vec3 &b) {
+    return vec3(a.y * b.z - a.z * b.y,
+                a.z * b.x - a.x * b.z,
+                a.x * b.y - a.y * b.x);
+}
+
+inline Vec3 normalize(const Vec3 &a) {
+    float length = std::sqrt(dot(a, a));
+    if (length == 0.0f) {
+        return a;
+    }
+    return a * (1.0f / length);
+}
+
+struct Mat4 {
+    // column-major, m[column * 4 + row]
+    float m[16];
+};
+
+inline Mat4 mat4Identity() {
+    Mat4 r;
+    for (int i = 0; i < 16; i++) {
+        r.m[i] = (i % 5 == 0) ? 1.0f : 0.0f;
+    }
+    return r;
+}
+
+inline Mat4 operator*(const Mat4 &a, const Mat4 &b) {
+    Mat4 r;
+    for (int column = 0; column < 4; column++) {
+        for (int row = 0; row < 4; row++) {
+            float sum = 0.0f;
+            for (int k = 0; k < 4; k++) {
+                sum += a.m[k * 4 + row] * b.m[column * 4 + k];
+            }
+            r.m[column * 4 + row] = sum;
+        }
+    }
+    return r;
+}
+
+// fovY in radians
+inline Mat4 mat4Perspective(float fovY, float aspect, float zNear, float zFar) {
+    Mat4 r;
+    for (int i = 0; i < 16; i++) {
+        r.m[i] = 0.0f;
+    }
+    float f = 1.0f / std::tan(fovY * 0.5f);
+    r.m[0] = f / aspect;
+    r.m[5] = f;
+    r.m[10] = (zFar + zNear) / (zNear - zFar);
+    r.m[11] = -1.0f;
+    r.m[14] = 2.0f * zFar * zNear / (zNear - zFar);
+    return r;
+}
+
+inline Mat4 mat4LookAt(const Vec3 &eye, const Vec3 &center, const Vec3 &up) {
+    Vec3 f = normalize(center - eye);
+    Vec3 s = normalize(cross(f, up));
+    Vec3 u = cross(s, f);
+
+    Mat4 r = mat4Identity();
+    r.m[0] = s.x;
+    r.m[4] = s.y;
+    r.m[8] = s.z;
+    r.m[1] = u.x;
+    r.m[5] = u.y;
+    r.m[9] = u.z;
+    r.m[2] = -f.x;
+    r.m[6] = -f.y;
+    r.m[10] = -f.z;
+    r.m[12] = -dot(s, eye);
+    r.m[13] = -dot(u, eye);
+    r.m[14] = dot(f, eye);
+    return r;
+}
+
+#endif //SDLTUTORIALS_MATH3D_H
@@ -0,0 +1,142 @@
+#ifndef SDLTUTORIALS_MESHFILE_H
+#define SDLTUTORIALS_MESHFILE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*
+ * Binary mesh container, laid out so the runtime can mmap the file and hand
+ * the vertex streams and the index buffer straight to glBufferData.
+ *
+ *   MeshFileHeader
+ *   MeshStream[streamCount]
+ *   MeshSubmesh[submeshCount]
+ *   stream data, index data (each section aligned to MESH_ALIGNMENT)
+ *
+ * Everything is little endian. Offsets are from the start of the file.
+ * Streams can be quantized, the value of each component is
+ * stored * decodeScale + decodeOffset, where stored is what GL reads with
+ * normalization on (snorm16, 10-10-10-2) or the raw half float.
+ */
+const uint32_t MESH_MAGIC = 0x4853454d;  // "MESH"
+const uint32_t MESH_VERSION = 2;
+const uint32_t MESH_ALIGNMENT = 16;
+
+enum MeshAttribute {
+    MESH_ATTRIBUTE_POSITION = 0,
+    MESH_ATTRIBUTE_NORMAL = 1,
+    MESH_ATTRIBUTE_TEXCOORD = 2
+};
+
+enum MeshFormat {
+    MESH_FORMAT_FLOAT32 = 0,
+    // 3 component streams are padded to 4 shorts, 8 bytes per vertex
+    MESH_FORMAT_SNORM16 = 1,
+    MESH_FORMAT_HALF = 2,
+    // x, y, z in 10 bit snorm and 2 unused bits, 3 component streams only
+    MESH_FORMAT_SNORM_10_10_10_2 = 3
+};
+
+struct MeshFileHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t vertexCount;
+    uint32_t indexCount;
+    // 2 or 4
+    uint32_t indexSize;
+    uint32_t streamCount;
+    uint32_t submeshCount;
+    uint32_t reserved;
+    float boundsMin[3];
+    float boundsMax[3];
+    uint64_t indexOffset;
+    uint64_t indexBytes;
+};
+
+// one vertex attribute, not interleaved
+struct MeshStream {
+    uint32_t attribute;
+    uint32_t format;
+    uint32_t components;
+    // bytes per vertex
+    uint32_t stride;
+    uint64_t offset;
+    uint64_t bytes;
+    float decodeScale[4];
+    float decodeOffset[4];
+};
+
+struct MeshSubmesh {
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    char name[24];
+};
+
+// CPU side mesh, what the OBJ loader produces and the writer consumes
+struct MeshData {
+    // 3 floats per vertex, normals and texcoords (2 floats) may be empty
+    std::vector<float> positions;
+    std::vector<float> normals;
+    std::vector<float> texcoords;
+    std::vector<uint32_t> indices;
+    std::vector<MeshSubmesh> submeshes;
+
+    size_t vertexCount() const;
+    // heap bytes held by the arrays
+    size_t memoryBytes() const;
+};
+
+// stream formats used by writeMeshFile
+struct MeshWriteOptions {
+    MeshFormat positionFormat;
+    MeshFormat normalFormat;
+    MeshFormat texcoordFormat;
+
+    MeshWriteOptions();
+};
+
+// Writes mesh to path, 16 bit indices are used when they fit
+bool writeMeshFile(const std::string &path, const MeshData &mesh,
+                   const MeshWriteOptions &options = MeshWriteOptions());
+
+// "float", "snorm16", "half" or "10_10_10_2", false if unknown
+bool parseMeshFormat(const char *name, MeshFormat &format);
+const char *meshFormatName(MeshFormat format);
+
+/*
+ * Read-only memory mapping of a mesh file. The pointers stay valid until
+ * close(); nothing is copied, pages are loaded by the OS on first access.
+ */
+class MeshFile {
+private:
+    int fd;
+    void *mapping;
+    size_t mappingSize;
+
+    const MeshFileHeader *header;
+    const MeshStream *streams;
+    const MeshSubmesh *submeshes;
+
+    bool validate(const std::string &path);
+
+public:
+    MeshFile();
+    ~MeshFile();
+
+    bool open(const std::string &path);
+    void close();
+
+    const MeshFileHeader &getHeader() const;
+    const MeshStream &getStream(int index) const;
+    // stream with the given attribute, nullptr if the mesh doesn't have it
+    const MeshStream *findStream(MeshAttribute attribute) const;
+    const void *getStreamData(const MeshStream &stream) const;
+    const void *getIndexData() const;
+    const MeshSubmesh &getSubmesh(int index) const;
+    size_t getFileSize() const;
+};
+
+
+#endif //SDLTUTORIALS_MESHFILE_H
@@ -0,0 +1,33 @@
+#ifndef SDLTUTORIALS_MESHOPTIMIZER_H
+#define SDLTUTORIALS_MESHOPTIMIZER_H
+
+#include <cstddef>
+#include <cstdint>
+#include "MeshFile.h"
+
+/*
+ * Offline mesh processing run by the converter before writing a mesh file.
+ *
+ * optimizeVertexCache reorders triangles with Tom Forsyth's "Linear-speed
+ * vertex cache optimisation" so recently transformed vertices are reused,
+ * optimizeVertexFetch then renumbers the vertices in first use order so the
+ * vertex streams are read front to back.
+ */
+
+// Reorders the triangles of one index range in place
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount);
+
+// Renumbers vertices in the order the indices first use them and drops
+// unreferenced ones. Returns the new vertex count.
+size_t optimizeVertexFetch(MeshData &mesh);
+
+// Both passes, the cache pass runs per submesh so the ranges stay valid
+void optimizeMesh(MeshData &mesh);
+
+// Average cache miss ratio: vertices transformed per triangle with a FIFO
+// post-transform cache of cacheSize entries. 0.5 is the ideal for large
+// regular meshes, 3 means no reuse at all.
+float computeAcmr(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize);
+
+
+#endif //SDLTUTORIALS_MESHOPTIMIZER_H
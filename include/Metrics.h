@@ -0,0 +1,117 @@
+#ifndef SDLTUTORIALS_METRICS_H
+#define SDLTUTORIALS_METRICS_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+/*
+ * Live frame metrics in POSIX shared memory, for monitoring tools that can't
+ * read stdout.
+ *
+ * The application publishes a fixed layout MetricsBlock once per frame; any
+ * process can map the same name read only and sample it. The block is
+ * protected by a sequence lock: the writer makes the sequence odd, writes the
+ * sample and makes it even again, a reader copies the sample and retries when
+ * the sequence was odd or changed meanwhile. The writer never waits for
+ * readers and publishing is a memcpy, no system calls.
+ */
+const uint32_t METRICS_MAGIC = 0x4d545253;
+const uint32_t METRICS_VERSION = 1;
+// frames the percentiles are computed over
+const int METRICS_WINDOW = 128;
+
+struct MetricsSample {
+    // frames published so far
+    uint64_t frame;
+    // steady clock time of the publication
+    uint64_t timeNs;
+    // frames slower than 1.5 times the target frame time, since the start
+    uint64_t droppedFrames;
+    // as reported by the application, e.g. its GL buffers
+    uint64_t memoryBytes;
+    // the last frame, then the last METRICS_WINDOW frames
+    float frameMs;
+    float frameMsP50;
+    float frameMsP90;
+    float frameMsP99;
+    float frameMsMax;
+    // last measured GPU time of a frame, 0 when not measured
+    float gpuMs;
+    // in the last frame
+    uint32_t drawCalls;
+    uint32_t simulationSteps;
+};
+
+struct MetricsBlock {
+    uint32_t magic;
+    uint32_t version;
+    // odd while the sample is being written
+    std::atomic<uint32_t> sequence;
+    // of the publishing process
+    uint32_t pid;
+    MetricsSample sample;
+};
+
+static_assert(sizeof(MetricsSample) == 64, "MetricsSample layout changed");
+static_assert(sizeof(MetricsBlock) == 80, "MetricsBlock layout changed");
+static_assert(ATOMIC_INT_LOCK_FREE == 2, "the sequence must be lock free to be shared between processes");
+
+/*
+ * Writer side. The setters collect the current frame, endFrame() publishes
+ * it; everything is a no-op until open() succeeds, so lessons can call them
+ * unconditionally.
+ */
+class MetricsPublisher {
+private:
+    std::string name;
+    int fd;
+    MetricsBlock *block;
+
+    MetricsSample pending;
+    float frameTimes[METRICS_WINDOW];
+    int frameTimeCount;
+    int nextFrameTime;
+    double targetFrameMs;
+
+public:
+    MetricsPublisher();
+    ~MetricsPublisher();
+
+    // Creates the shared memory object, a name like "/lesson4"
+    bool open(const std::string &name);
+    // Unmaps and removes the object
+    void close();
+    bool isOpen() const;
+
+    // 1000 / 60 by default
+    void setTargetFrameMs(double ms);
+    void addDrawCalls(uint32_t count);
+    void addSimulationSteps(uint32_t steps);
+    void setGpuTimeMs(double ms);
+    void setMemoryBytes(uint64_t bytes);
+
+    // Publishes the frame, the per frame counters restart at 0
+    void endFrame(double frameMs);
+};
+
+class MetricsReader {
+private:
+    int fd;
+    const MetricsBlock *block;
+
+public:
+    MetricsReader();
+    ~MetricsReader();
+
+    bool open(const std::string &name);
+    void close();
+
+    // A consistent copy of the sample, false when every attempt overlapped
+    // a write
+    bool read(MetricsSample &sample, int attempts = 100) const;
+    uint32_t getPid() const;
+};
+
+
+#endif //SDLTUTORIALS_METRICS_H
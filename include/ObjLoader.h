@@ -0,0 +1,15 @@
+#ifndef SDLTUTORIALS_OBJLOADER_H
+#define SDLTUTORIALS_OBJLOADER_H
+
+#include <string>
+#include "MeshFile.h"
+
+/*
+ * Wavefront OBJ text parser. Faces are triangulated as fans and every unique
+ * position/texcoord/normal combination becomes one indexed vertex.
+ * Each "o", "g" or "usemtl" statement starts a new submesh.
+ */
+bool loadObj(const std::string &path, MeshData &mesh);
+
+
+#endif //SDLTUTORIALS_OBJLOADER_H
\ No newline at end of file
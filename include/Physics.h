@@ -0,0 +1,35 @@
+#ifndef SDLTUTORIALS_PHYSICS_H
+#define SDLTUTORIALS_PHYSICS_H
+
+#include <cstddef>
+
+/*
+ * Damped spring integrated with RK4, see
+ * http://gafferongames.com/game-physics/fix-your-timestep/
+ *
+ * State is a plain struct so it can be stored as a component and iterated
+ * in packed arrays.
+ */
+struct State {
+    float x;
+    float v;
+};
+
+struct Derivative {
+    float dx;
+    float dv;
+};
+
+State interpolate(const State &previous, const State &current, float alpha);
+float acceleration(const State &state, float t);
+Derivative evaluate(const State &initial, float t);
+Derivative evaluate(const State &initial, float t, float dt, const Derivative &d);
+void integrate(State &state, float t, float dt);
+
+// integrate() over an array, 4 states at a time with SSE2. The arithmetic is
+// the same and in the same order, so the results match integrate() exactly.
+void integrateStates(State *states, size_t count, float t, float dt);
+const char *physicsSimdName();
+
+
+#endif //SDLTUTORIALS_PHYSICS_H
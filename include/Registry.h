@@ -0,0 +1,344 @@
+#ifndef SDLTUTORIALS_REGISTRY_H
+#define SDLTUTORIALS_REGISTRY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+/*
+ * Entity / component storage built on sparse sets.
+ *
+ * Every component type lives in its own pool: a dense array of components,
+ * a parallel dense array with the owning entities and a sparse array mapping
+ * an entity index to its dense position. Adding, removing and looking up are
+ * O(1), removal swaps the last element into the hole so the arrays never
+ * have gaps and iterating a pool is a linear walk.
+ *
+ * Iterating two components:
+ *   - each<A, B>() walks the smaller pool and looks the entity up in the
+ *     other one (a view, works for any pair, one indirection per entity)
+ *   - group<A, B>() owns both pools and keeps the entities that have both
+ *     packed at the front of each in the same order, so the pair is walked
+ *     with no lookup at all. A pool can be owned by one group only.
+ *
+ * Component pointers and references are invalidated by adding or removing
+ * components of the same type.
+ */
+typedef uint32_t Entity;
+
+// 20 bits of index, 12 bits of version so stale handles of recycled slots
+// are detected
+const uint32_t ENTITY_INDEX_BITS = 20;
+const uint32_t ENTITY_INDEX_MASK = (1u << ENTITY_INDEX_BITS) - 1;
+const uint32_t ENTITY_VERSION_MASK = 0xfffu;
+const Entity NULL_ENTITY = 0xffffffffu;
+
+inline uint32_t entityIndex(Entity entity) {
+    return entity & ENTITY_INDEX_MASK;
+}
+
+inline uint32_t entityVersion(Entity entity) {
+    return entity >> ENTITY_INDEX_BITS;
+}
+
+class SparseSet {
+protected:
+    static const uint32_t ABSENT = 0xffffffffu;
+
+    std::vector<uint32_t> sparse;
+    std::vector<Entity> dense;
+
+    // keeps the component array in step with dense
+    virtual void swapComponents(size_t a, size_t b) = 0;
+    virtual void popComponent() = 0;
+
+    void insertEntity(Entity entity);
+
+public:
+    virtual ~SparseSet() {}
+
+    bool contains(Entity entity) const {
+        uint32_t index = entityIndex(entity);
+        return index < sparse.size() && sparse[index] != ABSENT && dense[sparse[index]] == entity;
+    }
+
+    // dense position, the entity must be contained
+    size_t indexOf(Entity entity) const {
+        return sparse[entityIndex(entity)];
+    }
+
+    size_t size() const {
+        return dense.size();
+    }
+
+    const Entity *entities() const {
+        return dense.data();
+    }
+
+    void swapEntries(size_t a, size_t b);
+    void remove(Entity entity);
+    virtual void clear();
+    virtual void reserve(size_t capacity);
+};
+
+template<typename T>
+class ComponentPool : public SparseSet {
+    std::vector<T> components;
+
+protected:
+    void swapComponents(size_t a, size_t b) {
+        std::swap(components[a], components[b]);
+    }
+
+    void popComponent() {
+        components.pop_back();
+    }
+
+public:
+    T &add(Entity entity, const T &component) {
+        insertEntity(entity);
+        components.push_back(component);
+        return components.back();
+    }
+
+    T &get(Entity entity) {
+        return components[indexOf(entity)];
+    }
+
+    const T &get(Entity entity) const {
+        return components[indexOf(entity)];
+    }
+
+    T *tryGet(Entity entity) {
+        return contains(entity) ? &components[indexOf(entity)] : nullptr;
+    }
+
+    T *data() {
+        return components.data();
+    }
+
+    void clear() {
+        SparseSet::clear();
+        components.clear();
+    }
+
+    void reserve(size_t capacity) {
+        SparseSet::reserve(capacity);
+        components.reserve(capacity);
+    }
+};
+
+// The entities having both components, packed at the front of both pools
+struct GroupData {
+    SparseSet *first;
+    SparseSet *second;
+    size_t size;
+
+    bool contains(Entity entity) const {
+        return first->contains(entity) && first->indexOf(entity) < size;
+    }
+
+    void onAdd(Entity entity);
+    void onRemove(Entity entity);
+};
+
+template<typename A, typename B>
+class Group {
+    ComponentPool<A> *first;
+    ComponentPool<B> *second;
+    const GroupData *data;
+
+public:
+    Group(ComponentPool<A> *first, ComponentPool<B> *second, const GroupData *data)
+            : first(first), second(second), data(data) {
+    }
+
+    size_t size() const {
+        return data->size;
+    }
+
+    // parallel arrays of size() elements
+    const Entity *entities() const {
+        return first->entities();
+    }
+
+    A *firstData() {
+        return first->data();
+    }
+
+    B *secondData() {
+        return second->data();
+    }
+
+    // func(Entity, A &, B &), must not add or remove A or B
+    template<typename Func>
+    void each(Func func) {
+        const Entity *entity = first->entities();
+        A *a = first->data();
+        B *b = second->data();
+        const size_t count = data->size;
+        for (size_t i = 0; i < count; i++) {
+            func(entity[i], a[i], b[i]);
+        }
+    }
+};
+
+class Registry {
+    // per entity index: the current handle when alive, the next free index
+    // with the next version when destroyed
+    std::vector<Entity> entitySlots;
+    uint32_t freeList;
+    size_t aliveCount;
+
+    std::vector<std::unique_ptr<SparseSet> > pools;
+    // owning group per pool, null when not owned
+    std::vector<GroupData *> owners;
+    std::vector<std::unique_ptr<GroupData> > groups;
+
+    static size_t nextTypeIndex() {
+        static size_t next = 0;
+        return next++;
+    }
+
+    template<typename T>
+    static size_t typeIndex() {
+        static const size_t index = nextTypeIndex();
+        return index;
+    }
+
+    template<typename T>
+    ComponentPool<T> &assure() {
+        const size_t type = typeIndex<T>();
+        if (type >= pools.size()) {
+            pools.resize(type + 1);
+            owners.resize(type + 1, nullptr);
+        }
+        if (!pools[type]) {
+            pools[type].reset(new ComponentPool<T>());
+        }
+        return *static_cast<ComponentPool<T> *>(pools[type].get());
+    }
+
+public:
+    Registry();
+
+    Entity create();
+    // removes every component of the entity and recycles its index
+    void destroy(Entity entity);
+    bool valid(Entity entity) const;
+    size_t alive() const;
+    void reserve(size_t entities);
+    void clear();
+
+    // replaces the component when the entity already has one
+    template<typename T>
+    T &add(Entity entity, const T &component = T()) {
+        ComponentPool<T> &pool = assure<T>();
+        if (pool.contains(entity)) {
+            return pool.get(entity) = component;
+        }
+        T &added = pool.add(entity, component);
+        GroupData *owner = owners[typeIndex<T>()];
+        if (owner != nullptr) {
+            owner->onAdd(entity);
+            // the group may have moved it
+            return pool.get(entity);
+        }
+        return added;
+    }
+
+    template<typename T>
+    void remove(Entity entity) {
+        ComponentPool<T> &pool = assure<T>();
+        if (!pool.contains(entity)) {
+            return;
+        }
+        GroupData *owner = owners[typeIndex<T>()];
+        if (owner != nullptr) {
+            owner->onRemove(entity);
+        }
+        pool.remove(entity);
+    }
+
+    template<typename T>
+    bool has(Entity entity) {
+        return assure<T>().contains(entity);
+    }
+
+    template<typename T>
+    T &get(Entity entity) {
+        return assure<T>().get(entity);
+    }
+
+    template<typename T>
+    T *tryGet(Entity entity) {
+        return assure<T>().tryGet(entity);
+    }
+
+    template<typename T>
+    ComponentPool<T> &pool() {
+        return assure<T>();
+    }
+
+    // func(Entity, T &) over the whole pool
+    template<typename T, typename Func>
+    void each(Func func) {
+        ComponentPool<T> &pool = assure<T>();
+        const Entity *entity = pool.entities();
+        T *component = pool.data();
+        const size_t count = pool.size();
+        for (size_t i = 0; i < count; i++) {
+            func(entity[i], component[i]);
+        }
+    }
+
+    // func(Entity, A &, B &) for the entities having both, lookups into the
+    // larger pool
+    template<typename A, typename B, typename Func>
+    void each(Func func) {
+        ComponentPool<A> &a = assure<A>();
+        ComponentPool<B> &b = assure<B>();
+        if (a.size() <= b.size()) {
+            const Entity *entity = a.entities();
+            A *component = a.data();
+            for (size_t i = 0; i < a.size(); i++) {
+                if (b.contains(entity[i])) {
+                    func(entity[i], component[i], b.get(entity[i]));
+                }
+            }
+        } else {
+            const Entity *entity = b.entities();
+            B *component = b.data();
+            for (size_t i = 0; i < b.size(); i++) {
+                if (a.contains(entity[i])) {
+                    func(entity[i], a.get(entity[i]), component[i]);
+                }
+            }
+        }
+    }
+
+    // Owning group of A and B, created on first use. Returns a group of size
+    // 0 without owning anything when A or B is already owned by another group.
+    template<typename A, typename B>
+    Group<A, B> group() {
+        ComponentPool<A> &a = assure<A>();
+        ComponentPool<B> &b = assure<B>();
+        GroupData *data = findGroup(&a, &b);
+        if (data == nullptr) {
+            data = createGroup(typeIndex<A>(), typeIndex<B>());
+        }
+        if (data == nullptr) {
+            static const GroupData empty = {nullptr, nullptr, 0};
+            return Group<A, B>(&a, &b, &empty);
+        }
+        return Group<A, B>(&a, &b, data);
+    }
+
+private:
+    GroupData *findGroup(SparseSet *first, SparseSet *second);
+    GroupData *createGroup(size_t first, size_t second);
+};
+
+
+#endif //SDLTUTORIALS_REGISTRY_H
@@ -0,0 +1,115 @@
+#ifndef SDLTUTORIALS_SHADERRELOADER_H
+#define SDLTUTORIALS_SHADERRELOADER_H
+
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+#include <GL/glew.h>
+#include <SDL.h>
+
+/*
+ * Programs built from vertex/fragment shader files that are rebuilt in the
+ * background when the files change (inotify on Linux, mtime polling
+ * elsewhere). The compile runs on the driver's threads through
+ * GL_KHR_parallel_shader_compile when available, otherwise on a worker
+ * thread with its own shared context. A rebuilt program replaces the old one
+ * only once it linked, on errors the old program stays in use.
+ *
+ * Program objects are swapped, so uniform values must be set again after a
+ * reload; the simplest is setting them every frame.
+ */
+class ShaderReloader {
+public:
+    enum Backend {
+        BACKEND_PARALLEL_COMPILE,
+        BACKEND_WORKER_CONTEXT
+    };
+
+private:
+    struct Program {
+        std::string vertexFile;
+        std::string fragmentFile;
+        GLuint program;
+
+        // rebuild in flight, dirty when the files changed again meanwhile
+        bool pending;
+        bool dirty;
+        Uint64 requestTime;
+
+        // parallel compile backend, the program being built
+        GLuint candidate;
+        GLuint candidateShaders[2];
+    };
+
+    struct Job {
+        int handle;
+        std::string vertexSource;
+        std::string fragmentSource;
+    };
+
+    struct Result {
+        int handle;
+        GLuint program;
+        GLsync fence;
+        std::string log;
+    };
+
+    std::string directory;
+    Backend backend;
+    std::vector<Program> programs;
+
+    int watchFd;
+    Uint64 lastPoll;
+    std::vector<long> modifiedTimes;
+
+    SDL_Window *workerWindow;
+    SDL_GLContext workerContext;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable jobReady;
+    std::deque<Job> jobs;
+    std::deque<Result> results;
+    bool stopWorker;
+
+    int reloads;
+    int failures;
+    double totalLatencyMs;
+    double maxLatencyMs;
+
+    bool readSources(const Program &program, std::string &vertexSource, std::string &fragmentSource);
+    void startRebuild(int handle);
+    void finishRebuild(int handle, GLuint program, const std::string &log);
+    void pollChanges(std::vector<std::string> &changed);
+    void workerLoop();
+
+public:
+    ShaderReloader(const std::string &directory);
+    ~ShaderReloader();
+
+    // window and context are the render thread's, current on the calling thread
+    bool init(SDL_Window *window, SDL_GLContext context, bool forceWorker);
+    // builds synchronously, returns a handle or -1 on error
+    int load(const std::string &vertexFile, const std::string &fragmentFile);
+    GLuint getProgram(int handle) const;
+
+    // render thread, once per frame: picks up changes, swaps finished programs.
+    // True when a rebuild was in flight or finished during the call.
+    bool update();
+    // a rebuild is in flight
+    bool isBusy() const;
+    void shutdown();
+
+    Backend getBackend() const;
+    const char *getBackendName() const;
+    int getReloads() const;
+    int getFailures() const;
+    // file change seen -> program swapped
+    double getAverageLatencyMs() const;
+    double getMaxLatencyMs() const;
+};
+
+
+#endif //SDLTUTORIALS_SHADERRELOADER_H
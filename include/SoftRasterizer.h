@@ -0,0 +1,98 @@
+#ifndef SDLTUTORIALS_SOFTRASTERIZER_H
+#define SDLTUTORIALS_SOFTRASTERIZER_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*
+ * Tile based software rasterizer for flat colored triangles.
+ *
+ * Triangles are set up in 28.4 fixed point, binned into TILE_SIZE x TILE_SIZE
+ * tiles and rasterized with half-space edge functions (top-left fill rule)
+ * when finish() is called. Tiles are shared between worker threads, each tile
+ * keeps the submission order so the output does not depend on the thread
+ * count or on the SIMD path (AVX2, SSE2 or scalar) - all integer math.
+ *
+ * Positions are normalized device coordinates (x, y, z) like Lesson4's VBOs,
+ * there is no clipping: vertices outside the guard band drop the triangle.
+ * Pixels are RGBA8, row 0 is the top of the image.
+ */
+class SoftRasterizer {
+private:
+    struct Triangle {
+        // fixed point screen coordinates, y down, counter-clockwise
+        int32_t x[3];
+        int32_t y[3];
+        // pixel bounding box, inclusive
+        int minX, minY, maxX, maxY;
+        uint32_t color;
+    };
+
+    int width;
+    int height;
+    // framebuffer is padded to whole tiles
+    int stride;
+    int tilesX;
+    int tilesY;
+    std::vector<uint32_t> colorBuffer;
+
+    bool clearPending;
+    uint32_t clearColor;
+    std::vector<Triangle> triangles;
+    // triangle indices per tile, in submission order
+    std::vector<std::vector<int> > bins;
+
+    // worker pool
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable workReady;
+    std::condition_variable workDone;
+    int generation;
+    int busyWorkers;
+    bool stopping;
+    std::atomic<int> nextTile;
+
+    void workerLoop();
+    void rasterizeTiles();
+    void rasterizeTile(int tile);
+    void rasterizeTriangle(const Triangle &triangle, int tileX0, int tileY0);
+
+public:
+    static const int SUBPIXEL_BITS = 4;
+    static const int TILE_SIZE = 64;
+
+    // threadCount 0 uses one thread per hardware thread
+    SoftRasterizer(int width, int height, int threadCount);
+    ~SoftRasterizer();
+
+    // Deferred until finish(), also drops everything drawn before
+    void clear(float red, float green, float blue, float alpha);
+
+    // Every 3 vertices (x, y, z) make one triangle
+    void drawTriangles(const float *positions, int vertexCount, const float color[4]);
+
+    // Rasterizes all binned triangles, the image is ready after this returns
+    void finish();
+
+    int getWidth() const;
+    int getHeight() const;
+    int getThreadCount() const;
+    uint32_t getPixel(int x, int y) const;
+
+    // Binary PPM (P6) dump of the color buffer
+    bool savePPM(const std::string &path) const;
+
+    // Number of pixels different from the PPM image at path, -1 if it can't be read
+    long comparePPM(const std::string &path) const;
+
+    // SIMD instruction set the rasterizer was compiled with
+    static const char *simdName();
+};
+
+
+#endif //SDLTUTORIALS_SOFTRASTERIZER_H
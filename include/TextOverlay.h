@@ -0,0 +1,106 @@
+#ifndef SDLTUTORIALS_TEXTOVERLAY_H
+#define SDLTUTORIALS_TEXTOVERLAY_H
+
+#include <cstdint>
+#include <vector>
+#include <GL/glew.h>
+
+struct TextVertex {
+    // pixels, origin at the top left
+    GLfloat x;
+    GLfloat y;
+    GLfloat u;
+    GLfloat v;
+    GLubyte color[4];
+};
+
+/*
+ * On-screen text and graphs for diagnostics.
+ *
+ * A built in 5x7 font is rasterized into a glyph atlas once, at init().
+ * Each frame text(), rect() and graph() append quads to one vertex array.
+ * When the quads differ from the last draw(), it composites them on the CPU
+ * into a cached image and uploads it. Every draw() is then one draw call of
+ * a few textured quads, one per band of rows with ink. Software GL pays per
+ * pixel covered and per triangle set up, so the bands skip the empty rows
+ * and columns, and the text only gets rasterized when it changes.
+ *
+ * Building (CPU) and drawing (GL) are separate so a frame can be built on
+ * one thread and drawn on another: hand getVertices() over and call
+ * draw(vertices) there.
+ */
+class TextOverlay {
+private:
+    int scale;
+    std::vector<TextVertex> vertices;
+
+    // coverage of the glyphs, ATLAS_COLUMNS x ATLAS_ROWS cells
+    std::vector<GLubyte> atlas;
+    // the vertices and screen size the cached image was composited for, and the image itself
+    std::vector<TextVertex> cachedVertices;
+    int cachedScreenWidth;
+    int cachedScreenHeight;
+    std::vector<GLubyte> image;
+
+    GLuint program;
+    GLuint vao;
+    GLuint vbo;
+    GLint screenLocation;
+    // the image is uploaded to the next texture of the ring, writing the one a frame still in flight samples
+    // would wait for that frame
+    static const int CACHE_TEXTURES = 2;
+    GLuint caches[CACHE_TEXTURES];
+    GLsizei cacheWidths[CACHE_TEXTURES];
+    GLsizei cacheHeights[CACHE_TEXTURES];
+    int cacheIndex;
+    // vertices of the quads covering the image's inked bands
+    GLsizei bandVertices;
+
+    // GL_TIMESTAMP pairs around every TIMER_INTERVAL-th draw(), read back a few timed draws later
+    static const int TIMER_QUERIES = 4;
+    static const int TIMER_INTERVAL = 16;
+    GLuint timerQueries[TIMER_QUERIES][2];
+    int draws;
+    int timedDraws;
+    double gpuMs;
+
+    void quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+              const GLubyte color[4]);
+    // composites the quads into the cached image and uploads it
+    void rasterize(const std::vector<TextVertex> &frameVertices, int screenWidth, int screenHeight);
+
+public:
+    // font pixels are scale x scale screen pixels
+    static const int GLYPH_WIDTH = 6;
+    static const int GLYPH_HEIGHT = 8;
+
+    TextOverlay(int scale = 2);
+    ~TextOverlay();
+
+    // Builds the atlas, the program and the cache textures, needs a GL 3.2 or newer context
+    bool init();
+    void shutdown();
+
+    // Starts a new frame's vertices
+    void begin();
+    // ASCII 32-126, '\n' starts a new line. Returns the x after the text.
+    float text(float x, float y, const char *string, const GLubyte color[4]);
+    void rect(float x, float y, float width, float height, const GLubyte color[4]);
+    // bars of values[0, count) scaled to maxValue, oldest on the left, none under a pixel tall
+    void graph(float x, float y, float width, float height, const float *values, int count, float maxValue,
+               const GLubyte color[4]);
+
+    const std::vector<TextVertex> &getVertices() const;
+
+    // One draw call, blended over whatever is in the framebuffer. The same vertices and screen size as the last call
+    // reuse the image.
+    void draw(int screenWidth, int screenHeight);
+    void draw(const std::vector<TextVertex> &frameVertices, int screenWidth, int screenHeight);
+
+    int getLineHeight() const;
+    // GPU time of a recent draw()
+    double getGpuMs() const;
+};
+
+
+#endif //SDLTUTORIALS_TEXTOVERLAY_H
@@ -0,0 +1,108 @@
+#ifndef SDLTUTORIALS_TEXTURESTREAMER_H
+#define SDLTUTORIALS_TEXTURESTREAMER_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <GL/glew.h>
+
+// Texels of a texture, one mip level at a time (a file, a generator...)
+class TextureSource {
+public:
+    virtual ~TextureSource() {}
+
+    // power of two sizes
+    virtual int getWidth() const = 0;
+    virtual int getHeight() const = 0;
+    // RGBA8, (width >> level) x (height >> level), at least 1 x 1
+    virtual void loadLevel(int level, std::vector<uint8_t> &texels) = 0;
+};
+
+struct TextureStreamerStats {
+    // request() calls, and the ones that found the detail they asked for
+    long requests;
+    long hits;
+    uint64_t bytesUploaded;
+    long levelsUploaded;
+    long levelsEvicted;
+};
+
+/*
+ * Keeps a set of textures within a memory budget by making only the mip
+ * levels that are needed resident.
+ *
+ * A texture starts with its small levels only (the tail, up to tailSize
+ * texels wide), which always stay resident. Every frame request() tells the
+ * streamer how many pixels a texture covers on screen; update() then streams
+ * the missing finer levels in, one level at a time from coarse to fine, with
+ * at most uploadBytesPerFrame uploaded per frame. When the budget is full the
+ * finest level of the least recently used texture is dropped first, then
+ * levels finer than a visible texture needs.
+ *
+ * Levels live in mutable textures, only [resident level, last level] are
+ * specified and GL_TEXTURE_BASE_LEVEL points at the finest one, so a texture
+ * is always complete and can be drawn while it streams. Memory is counted as
+ * the bytes of the specified levels.
+ */
+class TextureStreamer {
+private:
+    struct Entry {
+        std::unique_ptr<TextureSource> source;
+        GLuint texture;
+        int width;
+        int height;
+        int levels;
+        // finest level that stays resident
+        int tailLevel;
+        // finest level resident now
+        int residentLevel;
+        // finest level asked for this frame
+        int wantedLevel;
+        uint64_t lastUsedFrame;
+        bool requested;
+    };
+
+    std::vector<Entry> entries;
+    uint64_t budgetBytes;
+    uint64_t uploadBytesPerFrame;
+    int tailSize;
+
+    uint64_t frame;
+    uint64_t residentBytes;
+    uint64_t peakBytes;
+    TextureStreamerStats stats;
+    std::vector<uint8_t> texels;
+
+    uint64_t levelBytes(const Entry &entry, int level) const;
+    void uploadLevel(Entry &entry, int level);
+    void dropLevel(Entry &entry);
+    // evicts until bytes more fit, never from entry keep
+    bool makeRoom(uint64_t bytes, const Entry *keep);
+
+public:
+    TextureStreamer(uint64_t budgetBytes, uint64_t uploadBytesPerFrame, int tailSize = 32);
+    ~TextureStreamer();
+
+    // Takes ownership of the source and uploads its tail, -1 if the tail
+    // doesn't fit in the budget
+    int add(TextureSource *source);
+
+    // The texture covers about screenSize pixels across this frame. Returns
+    // the texture to draw with now, at whatever detail is resident.
+    GLuint request(int id, float screenSize);
+
+    // Streams and evicts for this frame's requests, once per frame
+    void update();
+
+    int getCount() const;
+    int getResidentLevel(int id) const;
+    uint64_t getResidentBytes() const;
+    uint64_t getPeakBytes() const;
+    uint64_t getBudgetBytes() const;
+    // every level of every texture, what keeping all resident would cost
+    uint64_t getTotalBytes() const;
+    const TextureStreamerStats &getStats() const;
+};
+
+
+#endif //SDLTUTORIALS_TEXTURESTREAMER_H
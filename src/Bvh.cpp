@@ -0,0 +1,356 @@
+#include <algorithm>
+#include <cmath>
+#include "Bvh.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define BVH_USE_SSE 1
+#endif
+
+Frustum frustumFromMatrix(const Mat4 &viewProjection) {
+    const float *m = viewProjection.m;
+    // row i, column j is m[j * 4 + i]
+    float rows[4][4];
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            rows[i][j] = m[j * 4 + i];
+        }
+    }
+
+    Frustum frustum;
+    for (int j = 0; j < 4; j++) {
+        frustum.planes[0][j] = rows[3][j] + rows[0][j];  // left
+        frustum.planes[1][j] = rows[3][j] - rows[0][j];  // right
+        frustum.planes[2][j] = rows[3][j] + rows[1][j];  // bottom
+        frustum.planes[3][j] = rows[3][j] - rows[1][j];  // top
+        frustum.planes[4][j] = rows[3][j] + rows[2][j];  // near
+        frustum.planes[5][j] = rows[3][j] - rows[2][j];  // far
+    }
+
+    // normalize so distances are in world units
+    for (int i = 0; i < 6; i++) {
+        float *p = frustum.planes[i];
+        float length = std::sqrt(p[0] * p[0] + p[1] * p[1] + p[2] * p[2]);
+        if (length > 0.0f) {
+            for (int j = 0; j < 4; j++) {
+                p[j] /= length;
+            }
+        }
+    }
+    return frustum;
+}
+
+Bvh::Bvh() {
+}
+
+void Bvh::storeSlot(int slot, const AABB &box) {
+    centerX[slot] = (box.min.x + box.max.x) * 0.5f;
+    centerY[slot] = (box.min.y + box.max.y) * 0.5f;
+    centerZ[slot] = (box.min.z + box.max.z) * 0.5f;
+    extentX[slot] = (box.max.x - box.min.x) * 0.5f;
+    extentY[slot] = (box.max.y - box.min.y) * 0.5f;
+    extentZ[slot] = (box.max.z - box.min.z) * 0.5f;
+}
+
+void Bvh::updateLeafBounds(Node &node) {
+    AABB &b = node.bounds;
+    b.min = vec3(INFINITY, INFINITY, INFINITY);
+    b.max = vec3(-INFINITY, -INFINITY, -INFINITY);
+    for (int s = node.begin; s < node.begin + node.count; s++) {
+        b.min.x = std::min(b.min.x, centerX[s] - extentX[s]);
+        b.min.y = std::min(b.min.y, centerY[s] - extentY[s]);
+        b.min.z = std::min(b.min.z, centerZ[s] - extentZ[s]);
+        b.max.x = std::max(b.max.x, centerX[s] + extentX[s]);
+        b.max.y = std::max(b.max.y, centerY[s] + extentY[s]);
+        b.max.z = std::max(b.max.z, centerZ[s] + extentZ[s]);
+    }
+}
+
+static AABB merge(const AABB &a, const AABB &b) {
+    AABB r;
+    r.min = vec3(std::min(a.min.x, b.min.x), std::min(a.min.y, b.min.y), std::min(a.min.z, b.min.z));
+    r.max = vec3(std::max(a.max.x, b.max.x), std::max(a.max.y, b.max.y), std::max(a.max.z, b.max.z));
+    return r;
+}
+
+void Bvh::build(const std::vector<AABB> &bounds) {
+    const int count = (int) bounds.size();
+
+    nodes.clear();
+    slotObject.resize(count);
+    objectSlot.resize(count);
+    slotLeaf.resize(count);
+
+    // pad the SoA arrays so the SIMD loop can always load 4 lanes
+    const size_t padded = (size_t) count + 4;
+    centerX.assign(padded, 0.0f);
+    centerY.assign(padded, 0.0f);
+    centerZ.assign(padded, 0.0f);
+    extentX.assign(padded, 0.0f);
+    extentY.assign(padded, 0.0f);
+    extentZ.assign(padded, 0.0f);
+
+    if (count == 0) {
+        dirty.clear();
+        return;
+    }
+
+    // object centroids, used to split
+    std::vector<Vec3> centroids(count);
+    for (int i = 0; i < count; i++) {
+        slotObject[i] = i;
+        centroids[i] = (bounds[i].min + bounds[i].max) * 0.5f;
+    }
+
+    Node root;
+    root.left = -1;
+    root.parent = -1;
+    root.begin = 0;
+    root.count = count;
+    nodes.reserve(2 * (count / LEAF_SIZE + 1));
+    nodes.push_back(root);
+
+    // top-down median split along the longest centroid axis.
+    // Children are always appended after their parent, so walking the node
+    // array backwards visits children before parents (used by refit)
+    std::vector<int> stack;
+    stack.push_back(0);
+    while (!stack.empty()) {
+        int index = stack.back();
+        stack.pop_back();
+
+        const int begin = nodes[index].begin;
+        const int n = nodes[index].count;
+        if (n <= LEAF_SIZE) {
+            continue;
+        }
+
+        Vec3 cmin = centroids[slotObject[begin]];
+        Vec3 cmax = cmin;
+        for (int s = begin + 1; s < begin + n; s++) {
+            const Vec3 &c = centroids[slotObject[s]];
+            cmin = vec3(std::min(cmin.x, c.x), std::min(cmin.y, c.y), std::min(cmin.z, c.z));
+            cmax = vec3(std::max(cmax.x, c.x), std::max(cmax.y, c.y), std::max(cmax.z, c.z));
+        }
+        Vec3 size = cmax - cmin;
+        int axis = 0;
+        if (size.y > size.x) {
+            axis = 1;
+        }
+        if (size.z > (axis == 0 ? size.x : size.y)) {
+            axis = 2;
+        }
+
+        const int half = n / 2;
+        std::nth_element(slotObject.begin() + begin,
+                         slotObject.begin() + begin + half,
+                         slotObject.begin() + begin + n,
+                         [&centroids, axis](int a, int b) {
+                             const float *ca = &centroids[a].x;
+                             const float *cb = &centroids[b].x;
+                             return ca[axis] < cb[axis];
+                         });
+
+        Node left;
+        left.left = -1;
+        left.parent = index;
+        left.begin = begin;
+        left.count = half;
+
+        Node right = left;
+        right.begin = begin + half;
+        right.count = n - half;
+
+        int leftIndex = (int) nodes.size();
+        nodes[index].left = leftIndex;
+        nodes.push_back(left);
+        nodes.push_back(right);
+
+        stack.push_back(leftIndex);
+        stack.push_back(leftIndex + 1);
+    }
+
+    for (int s = 0; s < count; s++) {
+        objectSlot[slotObject[s]] = s;
+        storeSlot(s, bounds[slotObject[s]]);
+    }
+
+    // compute the boxes bottom-up
+    for (int i = (int) nodes.size() - 1; i >= 0; i--) {
+        Node &node = nodes[i];
+        if (node.left < 0) {
+            updateLeafBounds(node);
+            for (int s = node.begin; s < node.begin + node.count; s++) {
+                slotLeaf[s] = i;
+            }
+        } else {
+            node.bounds = merge(nodes[node.left].bounds, nodes[node.left + 1].bounds);
+        }
+    }
+
+    dirty.assign(nodes.size(), 0);
+}
+
+void Bvh::refit(const std::vector<AABB> &bounds, const std::vector<int> &movedObjects) {
+    if (movedObjects.empty() || nodes.empty()) {
+        return;
+    }
+
+    for (size_t i = 0; i < movedObjects.size(); i++) {
+        int object = movedObjects[i];
+        int slot = objectSlot[object];
+        storeSlot(slot, bounds[object]);
+        dirty[slotLeaf[slot]] = 1;
+    }
+
+    // children come after their parents, so one backwards pass is enough
+    for (int i = (int) nodes.size() - 1; i >= 0; i--) {
+        if (!dirty[i]) {
+            continue;
+        }
+        dirty[i] = 0;
+
+        Node &node = nodes[i];
+        if (node.left < 0) {
+            updateLeafBounds(node);
+        } else {
+            node.bounds = merge(nodes[node.left].bounds, nodes[node.left + 1].bounds);
+        }
+        if (node.parent >= 0) {
+            dirty[node.parent] = 1;
+        }
+    }
+}
+
+void Bvh::cullLeaf(const Frustum &frustum, const Node &node, int planeMask, std::vector<int> &visible) const {
+    const int end = node.begin + node.count;
+
+#ifdef BVH_USE_SSE
+    for (int s = node.begin; s < end; s += 4) {
+        __m128 cx = _mm_loadu_ps(&centerX[s]);
+        __m128 cy = _mm_loadu_ps(&centerY[s]);
+        __m128 cz = _mm_loadu_ps(&centerZ[s]);
+        __m128 ex = _mm_loadu_ps(&extentX[s]);
+        __m128 ey = _mm_loadu_ps(&extentY[s]);
+        __m128 ez = _mm_loadu_ps(&extentZ[s]);
+
+        // lanes still considered inside
+        __m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+        for (int p = 0; p < 6; p++) {
+            if (!(planeMask & (1 << p))) {
+                continue;
+            }
+            const float *plane = frustum.planes[p];
+            // signed distance of the box corner furthest along the plane normal
+            __m128 d = _mm_add_ps(_mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(plane[0])),
+                                             _mm_mul_ps(cy, _mm_set1_ps(plane[1]))),
+                                  _mm_add_ps(_mm_mul_ps(cz, _mm_set1_ps(plane[2])),
+                                             _mm_set1_ps(plane[3])));
+            __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(ex, _mm_set1_ps(std::fabs(plane[0]))),
+                                             _mm_mul_ps(ey, _mm_set1_ps(std::fabs(plane[1])))),
+                                  _mm_mul_ps(ez, _mm_set1_ps(std::fabs(plane[2]))));
+            inside = _mm_and_ps(inside, _mm_cmpge_ps(_mm_add_ps(d, r), _mm_setzero_ps()));
+        }
+
+        int mask = _mm_movemask_ps(inside);
+        int lanes = std::min(4, end - s);
+        for (int lane = 0; lane < lanes; lane++) {
+            if (mask & (1 << lane)) {
+                visible.push_back(slotObject[s + lane]);
+            }
+        }
+    }
+#else
+    for (int s = node.begin; s < end; s++) {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++) {
+            if (!(planeMask & (1 << p))) {
+                continue;
+            }
+            const float *plane = frustum.planes[p];
+            float d = centerX[s] * plane[0] + centerY[s] * plane[1] + centerZ[s] * plane[2] + plane[3];
+            float r = extentX[s] * std::fabs(plane[0]) + extentY[s] * std::fabs(plane[1]) +
+                      extentZ[s] * std::fabs(plane[2]);
+            inside = d + r >= 0.0f;
+        }
+        if (inside) {
+            visible.push_back(slotObject[s]);
+        }
+    }
+#endif
+}
+
+void Bvh::cull(const Frustum &frustum, std::vector<int> &visible, CullStats &stats) const {
+    stats.visible = 0;
+    stats.culled = 0;
+    stats.nodesVisited = 0;
+
+    size_t firstVisible = visible.size();
+
+    if (!nodes.empty()) {
+        // node index and the planes its box still intersects
+        std::vector<int> stack;
+        stack.reserve(128);
+        stack.push_back(0);
+        stack.push_back(0x3f);
+
+        while (!stack.empty()) {
+            int planeMask = stack.back();
+            stack.pop_back();
+            int index = stack.back();
+            stack.pop_back();
+
+            const Node &node = nodes[index];
+            stats.nodesVisited++;
+
+            Vec3 c = (node.bounds.min + node.bounds.max) * 0.5f;
+            Vec3 e = (node.bounds.max - node.bounds.min) * 0.5f;
+
+            bool outside = false;
+            for (int p = 0; p < 6; p++) {
+                if (!(planeMask & (1 << p))) {
+                    continue;
+                }
+                const float *plane = frustum.planes[p];
+                float d = c.x * plane[0] + c.y * plane[1] + c.z * plane[2] + plane[3];
+                float r = e.x * std::fabs(plane[0]) + e.y * std::fabs(plane[1]) + e.z * std::fabs(plane[2]);
+                if (d + r < 0.0f) {
+                    outside = true;
+                    break;
+                }
+                if (d - r >= 0.0f) {
+                    // completely in front of this plane, children can skip it
+                    planeMask &= ~(1 << p);
+                }
+            }
+            if (outside) {
+                continue;
+            }
+
+            if (planeMask == 0) {
+                // fully inside the frustum, accept the whole subtree
+                for (int s = node.begin; s < node.begin + node.count; s++) {
+                    visible.push_back(slotObject[s]);
+                }
+            } else if (node.left < 0) {
+                cullLeaf(frustum, node, planeMask, visible);
+            } else {
+                stack.push_back(node.left);
+                stack.push_back(planeMask);
+                stack.push_back(node.left + 1);
+                stack.push_back(planeMask);
+            }
+        }
+    }
+
+    stats.visible = (int) (visible.size() - firstVisible);
+    stats.culled = objectCount() - stats.visible;
+}
+
+int Bvh::nodeCount() const {
+    return (int) nodes.size();
+}
+
+int Bvh::objectCount() const {
+    return (int) slotObject.size();
+}
@@ -0,0 +1,274 @@
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <utility>
+#include <SDL.h>
+#include "FrameCapture.h"
+
+#ifdef HAVE_SDL2_IMAGE
+#include <SDL_image.h>
+#endif
+
+using namespace std;
+
+FrameCapture::FrameCapture(int width, int height, const std::string &directory, Format format) :
+        width(width), height(height), directory(directory), format(format), frameNumber(0),
+        stopping(false), framesWritten(0), framesDropped(0), stalls(0) {
+    for (int i = 0; i < RING_SIZE; i++) {
+        pixelBuffers[i] = 0;
+        fences[i] = 0;
+        bufferFrame[i] = -1;
+    }
+}
+
+FrameCapture::~FrameCapture() {
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        worker.join();
+    }
+}
+
+bool FrameCapture::init() {
+#ifndef HAVE_SDL2_IMAGE
+    if (format == FORMAT_PNG) {
+        cout << "PNG capture needs SDL2_image, use raw or ppm" << endl;
+        return false;
+    }
+#endif
+
+    const GLsizeiptr size = (GLsizeiptr) width * height * 4;
+    glGenBuffers(RING_SIZE, pixelBuffers);
+    for (int i = 0; i < RING_SIZE; i++) {
+        glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, size, NULL, GL_STREAM_READ);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    GLenum error = glGetError();
+    if (error != GL_NO_ERROR) {
+        cout << "Unable to create capture pixel buffers, error " << error << endl;
+        return false;
+    }
+
+    worker = std::thread(&FrameCapture::workerLoop, this);
+    return true;
+}
+
+void FrameCapture::capture() {
+    // start the copy of this frame, glReadPixels returns immediately with a PBO bound
+    const int slot = frameNumber % RING_SIZE;
+    if (bufferFrame[slot] >= 0) {
+        // normally read back two frames ago already, never overwrite a pending frame
+        readBack(slot);
+    }
+
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    bufferFrame[slot] = frameNumber;
+
+    // map the oldest frame of the ring, RING_SIZE - 1 frames old
+    const int oldest = frameNumber - (RING_SIZE - 1);
+    if (oldest >= 0) {
+        const int oldestSlot = oldest % RING_SIZE;
+        if (bufferFrame[oldestSlot] == oldest) {
+            readBack(oldestSlot);
+        }
+    }
+
+    frameNumber++;
+}
+
+void FrameCapture::readBack(int slot) {
+    if (fences[slot] != 0) {
+        GLenum status = glClientWaitSync(fences[slot], 0, 0);
+        if (status == GL_TIMEOUT_EXPIRED) {
+            // the GPU is more than RING_SIZE - 1 frames behind, we have to wait
+            stalls++;
+            glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000000);
+        }
+        glDeleteSync(fences[slot]);
+        fences[slot] = 0;
+    }
+
+    const size_t size = (size_t) width * height * 4;
+    Frame frame;
+    frame.number = bufferFrame[slot];
+    bufferFrame[slot] = -1;
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if ((int) queue.size() >= MAX_QUEUED_FRAMES) {
+            // the encoder can't keep up, don't block the render loop
+            framesDropped++;
+            return;
+        }
+        if (!freeBuffers.empty()) {
+            frame.pixels = std::move(freeBuffers.back());
+            freeBuffers.pop_back();
+        }
+    }
+    frame.pixels.resize(size);
+
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, pixelBuffers[slot]);
+    const void *mapped = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, (GLsizeiptr) size, GL_MAP_READ_BIT);
+    if (mapped != NULL) {
+        memcpy(frame.pixels.data(), mapped, size);
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    if (mapped == NULL) {
+        cout << "Unable to map capture buffer for frame " << frame.number << endl;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        queue.push_back(std::move(frame));
+    }
+    frameQueued.notify_one();
+}
+
+void FrameCapture::flush() {
+    for (int number = frameNumber - RING_SIZE; number < frameNumber; number++) {
+        if (number < 0) {
+            continue;
+        }
+        const int slot = number % RING_SIZE;
+        if (bufferFrame[slot] == number) {
+            readBack(slot);
+        }
+    }
+}
+
+void FrameCapture::finish() {
+    flush();
+
+    if (worker.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        frameQueued.notify_one();
+        worker.join();
+    }
+
+    glDeleteBuffers(RING_SIZE, pixelBuffers);
+    for (int i = 0; i < RING_SIZE; i++) {
+        pixelBuffers[i] = 0;
+    }
+}
+
+void FrameCapture::workerLoop() {
+    for (;;) {
+        Frame frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (queue.empty() && !stopping) {
+                frameQueued.wait(lock);
+            }
+            // finish the queue before stopping
+            if (queue.empty()) {
+                return;
+            }
+            frame = std::move(queue.front());
+            queue.pop_front();
+        }
+
+        bool written = encode(frame);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (written) {
+            framesWritten++;
+        }
+        freeBuffers.push_back(std::move(frame.pixels));
+    }
+}
+
+bool FrameCapture::encode(const Frame &frame) {
+    static const char *extensions[] = {"raw", "ppm", "png"};
+    char name[64];
+    snprintf(name, sizeof(name), "/frame_%06d.%s", frame.number, extensions[format]);
+    string path = directory + name;
+
+    // GL rows start at the bottom, files at the top
+    const size_t rowSize = (size_t) width * 4;
+    std::vector<unsigned char> flipped(frame.pixels.size());
+    for (int y = 0; y < height; y++) {
+        memcpy(&flipped[y * rowSize], &frame.pixels[(height - 1 - y) * rowSize], rowSize);
+    }
+
+    if (format == FORMAT_PNG) {
+#ifdef HAVE_SDL2_IMAGE
+        SDL_Surface *surface = SDL_CreateRGBSurfaceFrom(flipped.data(), width, height, 32, (int) rowSize,
+                                                        0x000000ff, 0x0000ff00, 0x00ff0000, 0xff000000);
+        if (surface == nullptr) {
+            cout << "SDL_CreateRGBSurfaceFrom error " << SDL_GetError() << endl;
+            return false;
+        }
+        int result = IMG_SavePNG(surface, path.c_str());
+        SDL_FreeSurface(surface);
+        if (result != 0) {
+            cout << "IMG_SavePNG error " << SDL_GetError() << endl;
+            return false;
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+
+    ofstream file(path.c_str(), ios::binary);
+    if (!file) {
+        cout << "Unable to open " << path << " for writing" << endl;
+        return false;
+    }
+
+    if (format == FORMAT_RAW) {
+        file.write((const char *) flipped.data(), flipped.size());
+    } else {
+        file << "P6\n" << width << " " << height << "\n255\n";
+        std::vector<unsigned char> rgb((size_t) width * height * 3);
+        for (size_t i = 0, count = (size_t) width * height; i < count; i++) {
+            rgb[i * 3 + 0] = flipped[i * 4 + 0];
+            rgb[i * 3 + 1] = flipped[i * 4 + 1];
+            rgb[i * 3 + 2] = flipped[i * 4 + 2];
+        }
+        file.write((const char *) rgb.data(), rgb.size());
+    }
+    return (bool) file;
+}
+
+int FrameCapture::getFramesWritten() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return framesWritten;
+}
+
+int FrameCapture::getFramesDropped() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return framesDropped;
+}
+
+int FrameCapture::getStalls() const {
+    return stalls;
+}
+
+bool FrameCapture::parseFormat(const std::string &name, Format &format) {
+    if (name == "raw") {
+        format = FORMAT_RAW;
+    } else if (name == "ppm") {
+        format = FORMAT_PPM;
+    } else if (name == "png") {
+        format = FORMAT_PNG;
+    } else {
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <iostream>
+#include "FramePipeline.h"
+
+using namespace std;
+
+const int FramePipeline::MAX_FRAMES_IN_FLIGHT;
+
+namespace {
+
+// a wait that should never time out, glClientWaitSync has no infinite value
+const GLuint64 LONG_WAIT_NS = 1000000000ull;
+// while nothing is queued, how long to wait on a fence before checking again
+const GLuint64 IDLE_WAIT_NS = 1000000ull;
+
+}
+
+FramePipeline::FramePipeline(int framesInFlight) :
+        framesInFlight(max(1, min(framesInFlight, MAX_FRAMES_IN_FLIGHT))), window(nullptr), context(nullptr),
+        stopping(false), gpuClockOffsetNs(0.0), frames(0), mainWaitMs(0.0), fenceWaitMs(0.0) {
+    for (int i = 0; i < MAX_FRAMES_IN_FLIGHT; i++) {
+        fences[i] = 0;
+        timestampQueries[i] = 0;
+        inputTimes[i] = 0;
+    }
+}
+
+FramePipeline::~FramePipeline() {
+    if (renderThread.joinable()) {
+        stop();
+    }
+}
+
+bool FramePipeline::start(SDL_Window *window, SDL_GLContext context, RenderFunction render) {
+    this->window = window;
+    this->context = context;
+    this->render = render;
+
+    freeSlots.clear();
+    for (int i = framesInFlight - 1; i >= 0; i--) {
+        freeSlots.push_back(i);
+    }
+    stopping = false;
+
+    // a context can only be current on one thread
+    if (SDL_GL_MakeCurrent(window, nullptr) != 0) {
+        cout << "Unable to release the GL context: " << SDL_GetError() << endl;
+        return false;
+    }
+    renderThread = std::thread(&FramePipeline::renderLoop, this);
+    return true;
+}
+
+int FramePipeline::beginFrame() {
+    Uint64 start = SDL_GetPerformanceCounter();
+    std::unique_lock<std::mutex> lock(mutex);
+    slotFreed.wait(lock, [this] { return !freeSlots.empty(); });
+    int slot = freeSlots.back();
+    freeSlots.pop_back();
+    mainWaitMs += (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    return slot;
+}
+
+void FramePipeline::submitFrame(int slot, Uint64 inputTime) {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        inputTimes[slot] = inputTime;
+        queued.push_back(slot);
+    }
+    frameQueued.notify_one();
+}
+
+void FramePipeline::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    frameQueued.notify_one();
+    if (renderThread.joinable()) {
+        renderThread.join();
+    }
+    SDL_GL_MakeCurrent(window, context);
+}
+
+double FramePipeline::counterToNs(Uint64 counter) const {
+    return (double) counter * 1e9 / SDL_GetPerformanceFrequency();
+}
+
+void FramePipeline::renderLoop() {
+    SDL_GL_MakeCurrent(window, context);
+    glGenQueries(framesInFlight, timestampQueries);
+
+    // the GPU clock has its own origin, remember where it is now
+    GLint64 gpuNow = 0;
+    glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+    gpuClockOffsetNs = (double) gpuNow - counterToNs(SDL_GetPerformanceCounter());
+
+    while (true) {
+        int slot;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            if (queued.empty() && !gpuFrames.empty()) {
+                // nothing to draw, free a slot so the main thread can go on
+                lock.unlock();
+                retireOldest(IDLE_WAIT_NS);
+                continue;
+            }
+            frameQueued.wait(lock, [this] { return !queued.empty() || stopping; });
+            if (queued.empty()) {
+                break;
+            }
+            slot = queued.front();
+            queued.pop_front();
+        }
+
+        render(slot);
+        SDL_GL_SwapWindow(window);
+        glQueryCounter(timestampQueries[slot], GL_TIMESTAMP);
+        fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+        gpuFrames.push_back(slot);
+
+        // release whatever the GPU already finished, without waiting
+        while (!gpuFrames.empty() && retireOldest(0)) {
+        }
+    }
+
+    while (!gpuFrames.empty()) {
+        retireOldest(LONG_WAIT_NS);
+    }
+    glDeleteQueries(framesInFlight, timestampQueries);
+    SDL_GL_MakeCurrent(window, nullptr);
+}
+
+bool FramePipeline::retireOldest(GLuint64 timeoutNs) {
+    const int slot = gpuFrames.front();
+
+    Uint64 start = SDL_GetPerformanceCounter();
+    GLenum result = glClientWaitSync(fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, timeoutNs);
+    if (timeoutNs > 0) {
+        fenceWaitMs += (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+    }
+    if (result == GL_TIMEOUT_EXPIRED) {
+        return false;
+    }
+    if (result == GL_WAIT_FAILED) {
+        cout << "FramePipeline: fence wait failed" << endl;
+    }
+    glDeleteSync(fences[slot]);
+    fences[slot] = 0;
+
+    GLuint64 presented = 0;
+    glGetQueryObjectui64v(timestampQueries[slot], GL_QUERY_RESULT, &presented);
+
+    std::lock_guard<std::mutex> lock(mutex);
+    double latencyNs = ((double) presented - gpuClockOffsetNs) - counterToNs(inputTimes[slot]);
+    latenciesMs.push_back(latencyNs / 1e6);
+    frames++;
+
+    gpuFrames.pop_front();
+    freeSlots.push_back(slot);
+    slotFreed.notify_one();
+    return true;
+}
+
+int FramePipeline::getFramesInFlight() const {
+    return framesInFlight;
+}
+
+int FramePipeline::getFrames() const {
+    return frames;
+}
+
+double FramePipeline::getAverageLatencyMs() const {
+    if (latenciesMs.empty()) {
+        return 0.0;
+    }
+    double total = 0.0;
+    for (size_t i = 0; i < latenciesMs.size(); i++) {
+        total += latenciesMs[i];
+    }
+    return total / latenciesMs.size();
+}
+
+double FramePipeline::getLatencyPercentileMs(double p) const {
+    if (latenciesMs.empty()) {
+        return 0.0;
+    }
+    vector<double> sorted(latenciesMs);
+    sort(sorted.begin(), sorted.end());
+    size_t index = (size_t) (p * (sorted.size() - 1) + 0.5);
+    return sorted[min(index, sorted.size() - 1)];
+}
+
+double FramePipeline::getMaxLatencyMs() const {
+    if (latenciesMs.empty()) {
+        return 0.0;
+    }
+    return *max_element(latenciesMs.begin(), latenciesMs.end());
+}
+
+double FramePipeline::getMainWaitMs() const {
+    return mainWaitMs;
+}
+
+double FramePipeline::getFenceWaitMs() const {
+    return fenceWaitMs;
+}
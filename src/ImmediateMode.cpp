@@ -0,0 +1,329 @@
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include "ImmediateMode.h"
+
+using namespace std;
+
+namespace {
+
+struct ImVertex {
+    GLfloat position[3];
+    GLfloat color[4];
+};
+
+struct Batch {
+    GLenum mode;
+    GLint first;
+    GLsizei count;
+};
+
+ImBackend backend = IM_BACKEND_NATIVE;
+
+GLuint program = 0;
+GLuint vao = 0;
+GLuint vbo = 0;
+GLint matrixLocation = -1;
+GLfloat matrix[16] = {1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1, 0, 0, 0, 0, 1};
+
+// inside imBegin/imEnd, the vertices as given
+GLenum primitiveMode = GL_POINTS;
+bool insidePrimitive = false;
+vector<ImVertex> primitive;
+GLfloat currentColor[4] = {1, 1, 1, 1};
+
+// converted vertices waiting for the next flush
+vector<ImVertex> vertices;
+vector<Batch> batches;
+
+ImStats stats = {0, 0, 0};
+
+const GLchar *VERTEX_SHADER =
+        "#version 150\n"
+        "in vec3 position;\n"
+        "in vec4 color;\n"
+        "uniform mat4 mvp;\n"
+        "out vec4 vColor;\n"
+        "void main() { vColor = color; gl_Position = mvp * vec4(position, 1.0); }";
+
+const GLchar *FRAGMENT_SHADER =
+        "#version 150\n"
+        "in vec4 vColor;\n"
+        "out vec4 fragColor;\n"
+        "void main() { fragColor = vColor; }";
+
+GLuint compile(GLenum type, const GLchar *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        cout << "Unable to compile immediate mode shader" << endl << log << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+// the primitive kind a mode is drawn as
+GLenum baseMode(GLenum mode) {
+    switch (mode) {
+        case GL_POINTS:
+            return GL_POINTS;
+        case GL_LINES:
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            return GL_LINES;
+        default:
+            return GL_TRIANGLES;
+    }
+}
+
+// appends primitive vertex i to the batch being built
+inline void emit(size_t i) {
+    vertices.push_back(primitive[i]);
+}
+
+// rewrites the finished primitive as a list of points, lines or triangles
+void convertPrimitive() {
+    const size_t count = primitive.size();
+    switch (primitiveMode) {
+        case GL_POINTS:
+            vertices.insert(vertices.end(), primitive.begin(), primitive.end());
+            break;
+        case GL_LINES:
+            vertices.insert(vertices.end(), primitive.begin(), primitive.begin() + count / 2 * 2);
+            break;
+        case GL_TRIANGLES:
+            vertices.insert(vertices.end(), primitive.begin(), primitive.begin() + count / 3 * 3);
+            break;
+        case GL_LINE_STRIP:
+        case GL_LINE_LOOP:
+            for (size_t i = 1; i < count; i++) {
+                emit(i - 1);
+                emit(i);
+            }
+            if (primitiveMode == GL_LINE_LOOP && count > 2) {
+                emit(count - 1);
+                emit(0);
+            }
+            break;
+        case GL_TRIANGLE_STRIP:
+            // every other triangle is flipped to keep the winding
+            for (size_t i = 2; i < count; i++) {
+                emit(i % 2 == 0 ? i - 2 : i - 1);
+                emit(i % 2 == 0 ? i - 1 : i - 2);
+                emit(i);
+            }
+            break;
+        case GL_TRIANGLE_FAN:
+        case GL_POLYGON:
+            for (size_t i = 2; i < count; i++) {
+                emit(0);
+                emit(i - 1);
+                emit(i);
+            }
+            break;
+        case GL_QUADS:
+            for (size_t i = 0; i + 3 < count; i += 4) {
+                emit(i);
+                emit(i + 1);
+                emit(i + 2);
+                emit(i);
+                emit(i + 2);
+                emit(i + 3);
+            }
+            break;
+        case GL_QUAD_STRIP:
+            for (size_t i = 0; i + 3 < count; i += 2) {
+                emit(i);
+                emit(i + 1);
+                emit(i + 3);
+                emit(i);
+                emit(i + 3);
+                emit(i + 2);
+            }
+            break;
+        default:
+            break;
+    }
+}
+
+}
+
+bool imInit(ImBackend requested) {
+    backend = requested;
+    stats = {0, 0, 0};
+    if (backend == IM_BACKEND_NATIVE) {
+        return true;
+    }
+
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        return false;
+    }
+
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, 0, "position");
+    glBindAttribLocation(program, 1, "color");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        cout << "Unable to link immediate mode program" << endl;
+        return false;
+    }
+    matrixLocation = glGetUniformLocation(program, "mvp");
+
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(ImVertex), (const GLvoid *) offsetof(ImVertex, position));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_FLOAT, GL_FALSE, sizeof(ImVertex), (const GLvoid *) offsetof(ImVertex, color));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    return true;
+}
+
+void imShutdown() {
+    if (program != 0) {
+        glDeleteProgram(program);
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+        program = 0;
+        vbo = 0;
+        vao = 0;
+    }
+    vertices.clear();
+    batches.clear();
+}
+
+void imBegin(GLenum mode) {
+    if (backend == IM_BACKEND_NATIVE) {
+        glBegin(mode);
+        return;
+    }
+    primitiveMode = mode;
+    insidePrimitive = true;
+    primitive.clear();
+}
+
+void imEnd() {
+    if (backend == IM_BACKEND_NATIVE) {
+        glEnd();
+        stats.drawCalls++;
+        return;
+    }
+    insidePrimitive = false;
+
+    const GLint first = (GLint) vertices.size();
+    convertPrimitive();
+    const GLsizei added = (GLsizei) vertices.size() - first;
+    if (added == 0) {
+        return;
+    }
+
+    // same kind as the previous primitive, one draw covers both
+    const GLenum mode = baseMode(primitiveMode);
+    if (!batches.empty() && batches.back().mode == mode) {
+        batches.back().count += added;
+    } else {
+        Batch batch = {mode, first, added};
+        batches.push_back(batch);
+    }
+}
+
+void imVertex2f(GLfloat x, GLfloat y) {
+    imVertex3f(x, y, 0.f);
+}
+
+void imVertex3f(GLfloat x, GLfloat y, GLfloat z) {
+    if (backend == IM_BACKEND_NATIVE) {
+        glVertex3f(x, y, z);
+        return;
+    }
+    ImVertex vertex = {{x, y, z}, {currentColor[0], currentColor[1], currentColor[2], currentColor[3]}};
+    primitive.push_back(vertex);
+}
+
+void imColor3f(GLfloat r, GLfloat g, GLfloat b) {
+    imColor4f(r, g, b, 1.f);
+}
+
+void imColor4f(GLfloat r, GLfloat g, GLfloat b, GLfloat a) {
+    if (backend == IM_BACKEND_NATIVE) {
+        glColor4f(r, g, b, a);
+        return;
+    }
+    currentColor[0] = r;
+    currentColor[1] = g;
+    currentColor[2] = b;
+    currentColor[3] = a;
+}
+
+void imPointSize(GLfloat size) {
+    if (backend == IM_BACKEND_BATCHED) {
+        imFlush();
+    }
+    glPointSize(size);
+}
+
+void imLoadMatrixf(const GLfloat *m) {
+    if (backend == IM_BACKEND_NATIVE) {
+        glMatrixMode(GL_MODELVIEW);
+        glLoadMatrixf(m);
+        return;
+    }
+    imFlush();
+    memcpy(matrix, m, sizeof(matrix));
+}
+
+void imFlush() {
+    if (backend == IM_BACKEND_NATIVE || batches.empty()) {
+        return;
+    }
+    if (insidePrimitive) {
+        cout << "imFlush called between imBegin and imEnd" << endl;
+        return;
+    }
+
+    glUseProgram(program);
+    glUniformMatrix4fv(matrixLocation, 1, GL_FALSE, matrix);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    // new storage every flush, the driver may still be reading the old one
+    glBufferData(GL_ARRAY_BUFFER, vertices.size() * sizeof(ImVertex), vertices.data(), GL_STREAM_DRAW);
+    for (size_t i = 0; i < batches.size(); i++) {
+        glDrawArrays(batches[i].mode, batches[i].first, batches[i].count);
+    }
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    glUseProgram(0);
+
+    stats.vertices += (long) vertices.size();
+    stats.drawCalls += (int) batches.size();
+    stats.flushes++;
+    vertices.clear();
+    batches.clear();
+}
+
+ImStats imGetStats() {
+    return stats;
+}
+
+void imResetStats() {
+    stats = {0, 0, 0};
+}
@@ -0,0 +1,160 @@
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include "InputRecorder.h"
+
+using namespace std;
+
+static const char MAGIC[4] = {'S', 'D', 'L', 'R'};
+static const uint32_t VERSION = 1;
+
+// bytes of one recorded event
+static const size_t EVENT_SIZE = 4 + 4 + 1;
+
+static void putU32(std::vector<unsigned char> &out, uint32_t value) {
+    for (int i = 0; i < 4; i++) {
+        out.push_back((unsigned char) (value >> (i * 8)));
+    }
+}
+
+static uint32_t getU32(const unsigned char *in) {
+    return (uint32_t) in[0] | ((uint32_t) in[1] << 8) | ((uint32_t) in[2] << 16) | ((uint32_t) in[3] << 24);
+}
+
+static bool isRecorded(const SDL_Event &event) {
+    return event.type == SDL_QUIT || event.type == SDL_KEYDOWN || event.type == SDL_KEYUP ||
+           event.type == SDL_WINDOWEVENT;
+}
+
+InputRecorder::InputRecorder() : file(nullptr), frames(0) {
+}
+
+InputRecorder::~InputRecorder() {
+    close();
+}
+
+bool InputRecorder::open(const std::string &path) {
+    close();
+    file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        cout << "Unable to open " << path << " for recording" << endl;
+        return false;
+    }
+
+    buffer.clear();
+    buffer.insert(buffer.end(), MAGIC, MAGIC + 4);
+    putU32(buffer, VERSION);
+    frames = 0;
+    return true;
+}
+
+void InputRecorder::flushBuffer() {
+    if (file != nullptr && !buffer.empty()) {
+        fwrite(buffer.data(), 1, buffer.size(), file);
+    }
+    buffer.clear();
+}
+
+void InputRecorder::close() {
+    if (file == nullptr) {
+        return;
+    }
+    flushBuffer();
+    fclose(file);
+    file = nullptr;
+}
+
+void InputRecorder::recordEvent(const SDL_Event &event) {
+    if (file != nullptr && isRecorded(event)) {
+        frameEvents.push_back(event);
+    }
+}
+
+void InputRecorder::endFrame(float deltaTime) {
+    if (file == nullptr) {
+        return;
+    }
+
+    uint32_t deltaBits;
+    memcpy(&deltaBits, &deltaTime, sizeof(deltaBits));
+    putU32(buffer, deltaBits);
+
+    uint16_t count = (uint16_t) frameEvents.size();
+    buffer.push_back((unsigned char) (count & 0xff));
+    buffer.push_back((unsigned char) (count >> 8));
+
+    for (uint16_t i = 0; i < count; i++) {
+        const SDL_Event &event = frameEvents[i];
+        putU32(buffer, event.type);
+        putU32(buffer, (uint32_t) (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP ? event.key.keysym.sym : 0));
+        buffer.push_back(event.type == SDL_WINDOWEVENT ? event.window.event : 0);
+    }
+    frameEvents.clear();
+    frames++;
+
+    // don't hit the disk every frame
+    if (buffer.size() > 64 * 1024) {
+        flushBuffer();
+    }
+}
+
+int InputRecorder::getFrames() const {
+    return frames;
+}
+
+InputPlayer::InputPlayer() : position(0) {
+}
+
+bool InputPlayer::open(const std::string &path) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        cout << "Unable to open recording " << path << endl;
+        return false;
+    }
+
+    data.clear();
+    unsigned char chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        data.insert(data.end(), chunk, chunk + read);
+    }
+    fclose(file);
+
+    if (data.size() < 8 || memcmp(data.data(), MAGIC, 4) != 0 || getU32(&data[4]) != VERSION) {
+        cout << path << " is not an input recording" << endl;
+        return false;
+    }
+    position = 8;
+    return true;
+}
+
+bool InputPlayer::nextFrame(float &deltaTime, std::vector<SDL_Event> &events) {
+    events.clear();
+    if (position + 6 > data.size()) {
+        return false;
+    }
+
+    uint32_t deltaBits = getU32(&data[position]);
+    memcpy(&deltaTime, &deltaBits, sizeof(deltaTime));
+    uint16_t count = (uint16_t) (data[position + 4] | (data[position + 5] << 8));
+    position += 6;
+
+    if (position + count * EVENT_SIZE > data.size()) {
+        cout << "Truncated input recording" << endl;
+        return false;
+    }
+
+    for (uint16_t i = 0; i < count; i++) {
+        SDL_Event event;
+        memset(&event, 0, sizeof(event));
+        event.type = getU32(&data[position]);
+        if (event.type == SDL_KEYDOWN || event.type == SDL_KEYUP) {
+            event.key.keysym.sym = (SDL_Keycode) getU32(&data[position + 4]);
+        } else if (event.type == SDL_WINDOWEVENT) {
+            event.window.event = data[position + 8];
+        }
+        events.push_back(event);
+        position += EVENT_SIZE;
+    }
+    return true;
+}
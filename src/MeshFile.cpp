@@ -0,0 +1,427 @@
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "MeshFile.h"
+
+using namespace std;
+
+size_t MeshData::vertexCount() const {
+    return positions.size() / 3;
+}
+
+size_t MeshData::memoryBytes() const {
+    return positions.capacity() * sizeof(float) + normals.capacity() * sizeof(float) +
+           texcoords.capacity() * sizeof(float) + indices.capacity() * sizeof(uint32_t) +
+           submeshes.capacity() * sizeof(MeshSubmesh);
+}
+
+MeshWriteOptions::MeshWriteOptions() : positionFormat(MESH_FORMAT_FLOAT32), normalFormat(MESH_FORMAT_FLOAT32),
+                                       texcoordFormat(MESH_FORMAT_FLOAT32) {
+}
+
+static const char *FORMAT_NAMES[] = {"float", "snorm16", "half", "10_10_10_2"};
+
+bool parseMeshFormat(const char *name, MeshFormat &format) {
+    for (int i = 0; i < 4; i++) {
+        if (strcmp(name, FORMAT_NAMES[i]) == 0) {
+            format = (MeshFormat) i;
+            return true;
+        }
+    }
+    return false;
+}
+
+const char *meshFormatName(MeshFormat format) {
+    return format >= MESH_FORMAT_FLOAT32 && format <= MESH_FORMAT_SNORM_10_10_10_2 ? FORMAT_NAMES[format] : "unknown";
+}
+
+// round to nearest, overflow goes to infinity, small values to half denormals
+static uint16_t floatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint32_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t) ((bits >> 23) & 0xff) - 127 + 15;
+    uint32_t mantissa = bits & 0x7fffff;
+
+    if (((bits >> 23) & 0xff) == 0xff) {
+        // inf or nan
+        return (uint16_t) (sign | 0x7c00 | (mantissa != 0 ? 0x200 : 0));
+    }
+    if (exponent >= 31) {
+        return (uint16_t) (sign | 0x7c00);
+    }
+    if (exponent <= 0) {
+        if (exponent < -10) {
+            return (uint16_t) sign;
+        }
+        mantissa |= 0x800000;
+        uint32_t shift = (uint32_t) (14 - exponent);
+        uint32_t half = mantissa >> shift;
+        if ((mantissa >> (shift - 1)) & 1) {
+            half++;
+        }
+        return (uint16_t) (sign | half);
+    }
+    // a rounding carry correctly bumps the exponent
+    uint32_t half = sign | ((uint32_t) exponent << 10) | (mantissa >> 13);
+    if (mantissa & 0x1000) {
+        half++;
+    }
+    return (uint16_t) half;
+}
+
+static int32_t toSnorm(float value, int32_t maximum) {
+    float scaled = roundf(value * maximum);
+    return (int32_t) std::max(std::min(scaled, (float) maximum), (float) -maximum);
+}
+
+// bytes per vertex, 16 bit formats keep 4 byte alignment
+static uint32_t formatStride(MeshFormat format, uint32_t components) {
+    switch (format) {
+        case MESH_FORMAT_SNORM16:
+        case MESH_FORMAT_HALF:
+            return (components + 1) / 2 * 2 * 2;
+        case MESH_FORMAT_SNORM_10_10_10_2:
+            return 4;
+        default:
+            return components * 4;
+    }
+}
+
+/*
+ * Converts one attribute array into the stream format. stream.decodeScale and
+ * decodeOffset are filled in, ranged formats map each component's min/max
+ * onto -1..1, normals are unit vectors already.
+ */
+static void encodeStream(MeshStream &stream, const float *source, uint32_t vertexCount, bool unitRange,
+                         std::vector<unsigned char> &out) {
+    const uint32_t components = stream.components;
+    for (uint32_t c = 0; c < 4; c++) {
+        stream.decodeScale[c] = 1.0f;
+        stream.decodeOffset[c] = 0.0f;
+    }
+    if (stream.format == MESH_FORMAT_SNORM16 && !unitRange) {
+        for (uint32_t c = 0; c < components; c++) {
+            float low = FLT_MAX;
+            float high = -FLT_MAX;
+            for (uint32_t v = 0; v < vertexCount; v++) {
+                low = std::min(low, source[v * components + c]);
+                high = std::max(high, source[v * components + c]);
+            }
+            if (vertexCount > 0) {
+                stream.decodeOffset[c] = (low + high) * 0.5f;
+                stream.decodeScale[c] = high > low ? (high - low) * 0.5f : 1.0f;
+            }
+        }
+    }
+
+    out.resize((size_t) stream.stride * vertexCount);
+    unsigned char *destination = out.data();
+    for (uint32_t v = 0; v < vertexCount; v++, destination += stream.stride) {
+        const float *value = &source[v * components];
+        if (stream.format == MESH_FORMAT_FLOAT32) {
+            memcpy(destination, value, components * sizeof(float));
+        } else if (stream.format == MESH_FORMAT_SNORM_10_10_10_2) {
+            uint32_t packed = 0;
+            for (uint32_t c = 0; c < 3; c++) {
+                packed |= ((uint32_t) toSnorm(value[c], 511) & 0x3ff) << (c * 10);
+            }
+            memcpy(destination, &packed, sizeof(packed));
+        } else {
+            uint16_t encoded[4] = {0, 0, 0, 0};
+            for (uint32_t c = 0; c < components; c++) {
+                if (stream.format == MESH_FORMAT_HALF) {
+                    encoded[c] = floatToHalf(value[c]);
+                } else {
+                    float normalized = (value[c] - stream.decodeOffset[c]) / stream.decodeScale[c];
+                    encoded[c] = (uint16_t) (int16_t) toSnorm(normalized, 32767);
+                }
+            }
+            memcpy(destination, encoded, stream.stride);
+        }
+    }
+}
+
+static uint64_t align(uint64_t offset) {
+    return (offset + MESH_ALIGNMENT - 1) / MESH_ALIGNMENT * MESH_ALIGNMENT;
+}
+
+// sequential writer, pads with zeros up to each section offset
+struct SectionWriter {
+    FILE *file;
+    uint64_t position;
+    bool ok;
+
+    void write(uint64_t offset, const void *data, size_t size) {
+        static const unsigned char zeros[MESH_ALIGNMENT] = {0};
+        while (ok && position < offset) {
+            size_t padding = (size_t) std::min<uint64_t>(offset - position, MESH_ALIGNMENT);
+            ok = fwrite(zeros, 1, padding, file) == padding;
+            position += padding;
+        }
+        if (ok && size > 0) {
+            ok = fwrite(data, 1, size, file) == size;
+            position += size;
+        }
+    }
+};
+
+bool writeMeshFile(const std::string &path, const MeshData &mesh, const MeshWriteOptions &options) {
+    const uint32_t vertexCount = (uint32_t) mesh.vertexCount();
+
+    MeshFileHeader header;
+    memset(&header, 0, sizeof(header));
+    header.magic = MESH_MAGIC;
+    header.version = MESH_VERSION;
+    header.vertexCount = vertexCount;
+    header.indexCount = (uint32_t) mesh.indices.size();
+    header.indexSize = vertexCount <= 0xffff ? 2 : 4;
+    header.submeshCount = (uint32_t) mesh.submeshes.size();
+
+    for (int i = 0; i < 3; i++) {
+        header.boundsMin[i] = FLT_MAX;
+        header.boundsMax[i] = -FLT_MAX;
+    }
+    for (uint32_t v = 0; v < vertexCount; v++) {
+        for (int i = 0; i < 3; i++) {
+            header.boundsMin[i] = std::min(header.boundsMin[i], mesh.positions[v * 3 + i]);
+            header.boundsMax[i] = std::max(header.boundsMax[i], mesh.positions[v * 3 + i]);
+        }
+    }
+
+    // streams present in the mesh, in file order
+    vector<MeshStream> streams;
+    vector<vector<unsigned char> > streamData;
+    const float *sources[3] = {mesh.positions.data(), mesh.normals.data(), mesh.texcoords.data()};
+    const uint32_t components[3] = {3, 3, 2};
+    const size_t sizes[3] = {mesh.positions.size(), mesh.normals.size(), mesh.texcoords.size()};
+    const MeshFormat formats[3] = {options.positionFormat, options.normalFormat, options.texcoordFormat};
+    for (int attribute = 0; attribute < 3; attribute++) {
+        if (sizes[attribute] == 0 || sizes[attribute] != (size_t) vertexCount * components[attribute]) {
+            continue;
+        }
+        if (formats[attribute] == MESH_FORMAT_SNORM_10_10_10_2 && components[attribute] != 3) {
+            cout << "10_10_10_2 needs 3 components, attribute " << attribute << " has "
+                 << components[attribute] << endl;
+            return false;
+        }
+        MeshStream stream;
+        memset(&stream, 0, sizeof(stream));
+        stream.attribute = (uint32_t) attribute;
+        stream.format = formats[attribute];
+        stream.components = components[attribute];
+        stream.stride = formatStride(formats[attribute], components[attribute]);
+        stream.bytes = (uint64_t) stream.stride * vertexCount;
+        streamData.push_back(vector<unsigned char>());
+        encodeStream(stream, sources[attribute], vertexCount, attribute == MESH_ATTRIBUTE_NORMAL, streamData.back());
+        streams.push_back(stream);
+    }
+    header.streamCount = (uint32_t) streams.size();
+
+    uint64_t offset = sizeof(MeshFileHeader) + streams.size() * sizeof(MeshStream) +
+                      mesh.submeshes.size() * sizeof(MeshSubmesh);
+    for (size_t i = 0; i < streams.size(); i++) {
+        offset = align(offset);
+        streams[i].offset = offset;
+        offset += streams[i].bytes;
+    }
+    header.indexOffset = align(offset);
+    header.indexBytes = (uint64_t) header.indexCount * header.indexSize;
+
+    FILE *file = fopen(path.c_str(), "wb");
+    if (file == nullptr) {
+        cout << "Unable to open " << path << " for writing" << endl;
+        return false;
+    }
+
+    SectionWriter writer = {file, 0, true};
+    writer.write(0, &header, sizeof(header));
+    writer.write(sizeof(header), streams.data(), streams.size() * sizeof(MeshStream));
+    writer.write(sizeof(header) + streams.size() * sizeof(MeshStream),
+                 mesh.submeshes.data(), mesh.submeshes.size() * sizeof(MeshSubmesh));
+    for (size_t i = 0; i < streams.size(); i++) {
+        writer.write(streams[i].offset, streamData[i].data(), (size_t) streams[i].bytes);
+    }
+
+    if (header.indexSize == 2) {
+        vector<uint16_t> shortIndices(mesh.indices.begin(), mesh.indices.end());
+        writer.write(header.indexOffset, shortIndices.data(), (size_t) header.indexBytes);
+    } else {
+        writer.write(header.indexOffset, mesh.indices.data(), (size_t) header.indexBytes);
+    }
+
+    if (fclose(file) != 0 || !writer.ok) {
+        cout << "Error writing " << path << endl;
+        return false;
+    }
+    return true;
+}
+
+MeshFile::MeshFile() : fd(-1), mapping(nullptr), mappingSize(0),
+                       header(nullptr), streams(nullptr), submeshes(nullptr) {
+}
+
+MeshFile::~MeshFile() {
+    close();
+}
+
+bool MeshFile::open(const std::string &path) {
+    close();
+
+    fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "Unable to open mesh " << path << endl;
+        return false;
+    }
+
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(MeshFileHeader)) {
+        cout << path << " is not a mesh file" << endl;
+        close();
+        return false;
+    }
+
+    mappingSize = (size_t) info.st_size;
+    mapping = mmap(nullptr, mappingSize, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (mapping == MAP_FAILED) {
+        cout << "Unable to map " << path << endl;
+        mapping = nullptr;
+        close();
+        return false;
+    }
+    // the whole file is about to be uploaded front to back
+    madvise(mapping, mappingSize, MADV_SEQUENTIAL);
+
+    if (!validate(path)) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+// largest of count indices, memcpy'd since the mapping doesn't promise alignment
+template<typename T>
+static uint32_t maxIndex(const unsigned char *data, uint32_t count) {
+    T largest = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        T index;
+        memcpy(&index, data + (size_t) i * sizeof(T), sizeof(T));
+        largest = max(largest, index);
+    }
+    return largest;
+}
+
+// offset and bytes inside the mapping, written so that neither sum can wrap
+static bool inBounds(uint64_t offset, uint64_t bytes, size_t size) {
+    return offset <= size && bytes <= size - offset;
+}
+
+bool MeshFile::validate(const std::string &path) {
+    const unsigned char *base = (const unsigned char *) mapping;
+    header = (const MeshFileHeader *) base;
+    if (header->magic != MESH_MAGIC || header->version != MESH_VERSION) {
+        cout << path << " is not a version " << MESH_VERSION << " mesh file" << endl;
+        return false;
+    }
+
+    const uint64_t tablesEnd = sizeof(MeshFileHeader) + (uint64_t) header->streamCount * sizeof(MeshStream) +
+                               (uint64_t) header->submeshCount * sizeof(MeshSubmesh);
+    if (tablesEnd > mappingSize || (header->indexSize != 2 && header->indexSize != 4) ||
+        !inBounds(header->indexOffset, header->indexBytes, mappingSize) ||
+        header->indexBytes != (uint64_t) header->indexCount * header->indexSize) {
+        cout << path << " is truncated or corrupt" << endl;
+        return false;
+    }
+
+    streams = (const MeshStream *) (base + sizeof(MeshFileHeader));
+    submeshes = (const MeshSubmesh *) (streams + header->streamCount);
+
+    for (uint32_t i = 0; i < header->streamCount; i++) {
+        const MeshStream &stream = streams[i];
+        // a short stride has GL read past the stream's bytes
+        if (stream.format > MESH_FORMAT_SNORM_10_10_10_2 || stream.components < 1 || stream.components > 4 ||
+            stream.stride < formatStride((MeshFormat) stream.format, stream.components)) {
+            cout << path << ": stream " << i << " has an invalid layout" << endl;
+            return false;
+        }
+        if (!inBounds(stream.offset, stream.bytes, mappingSize) ||
+            stream.bytes < (uint64_t) stream.stride * header->vertexCount) {
+            cout << path << ": stream " << i << " out of bounds" << endl;
+            return false;
+        }
+    }
+    for (uint32_t i = 0; i < header->submeshCount; i++) {
+        if ((uint64_t) submeshes[i].firstIndex + submeshes[i].indexCount > header->indexCount) {
+            cout << path << ": submesh " << i << " out of bounds" << endl;
+            return false;
+        }
+    }
+
+    // glDrawElements reading past the vertices is undefined behaviour without robust buffer access
+    if (header->indexCount > 0) {
+        const unsigned char *indices = base + header->indexOffset;
+        uint32_t largest = header->indexSize == 2 ? maxIndex<uint16_t>(indices, header->indexCount)
+                                                  : maxIndex<uint32_t>(indices, header->indexCount);
+        if (largest >= header->vertexCount) {
+            cout << path << ": index " << largest << " out of range for " << header->vertexCount << " vertices"
+                 << endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+void MeshFile::close() {
+    if (mapping != nullptr) {
+        munmap(mapping, mappingSize);
+        mapping = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+    mappingSize = 0;
+    header = nullptr;
+    streams = nullptr;
+    submeshes = nullptr;
+}
+
+const MeshFileHeader &MeshFile::getHeader() const {
+    return *header;
+}
+
+const MeshStream &MeshFile::getStream(int index) const {
+    return streams[index];
+}
+
+const MeshStream *MeshFile::findStream(MeshAttribute attribute) const {
+    for (uint32_t i = 0; i < header->streamCount; i++) {
+        if (streams[i].attribute == (uint32_t) attribute) {
+            return &streams[i];
+        }
+    }
+    return nullptr;
+}
+
+const void *MeshFile::getStreamData(const MeshStream &stream) const {
+    return (const unsigned char *) mapping + stream.offset;
+}
+
+const void *MeshFile::getIndexData() const {
+    return (const unsigned char *) mapping + header->indexOffset;
+}
+
+const MeshSubmesh &MeshFile::getSubmesh(int index) const {
+    return submeshes[index];
+}
+
+size_t MeshFile::getFileSize() const {
+    return mappingSize;
+}
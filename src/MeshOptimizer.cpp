@@ -0,0 +1,242 @@
+#include <cmath>
+#include <vector>
+#include "MeshOptimizer.h"
+
+using namespace std;
+
+namespace {
+
+// simulated cache, scores from the paper
+const int CACHE_SIZE = 32;
+const float CACHE_DECAY_POWER = 1.5f;
+const float LAST_TRIANGLE_SCORE = 0.75f;
+const float VALENCE_BOOST_SCALE = 2.0f;
+const float VALENCE_BOOST_POWER = 0.5f;
+const uint32_t MAX_VALENCE = 64;
+
+struct ScoreTables {
+    float cache[CACHE_SIZE];
+    float valence[MAX_VALENCE];
+
+    ScoreTables() {
+        for (int i = 0; i < CACHE_SIZE; i++) {
+            if (i < 3) {
+                // the last triangle's vertices get a fixed score, so it isn't
+                // rewarded for using them in the same order
+                cache[i] = LAST_TRIANGLE_SCORE;
+            } else {
+                const float scaler = 1.0f / (CACHE_SIZE - 3);
+                cache[i] = powf(1.0f - (i - 3) * scaler, CACHE_DECAY_POWER);
+            }
+        }
+        for (uint32_t i = 0; i < MAX_VALENCE; i++) {
+            valence[i] = VALENCE_BOOST_SCALE * powf((float) i, -VALENCE_BOOST_POWER);
+        }
+    }
+};
+
+const ScoreTables &scoreTables() {
+    static ScoreTables tables;
+    return tables;
+}
+
+// cachePosition -1 means not in the cache
+float vertexScore(int cachePosition, uint32_t liveTriangles) {
+    if (liveTriangles == 0) {
+        // no triangle needs it anymore
+        return -1.0f;
+    }
+    const ScoreTables &tables = scoreTables();
+    float score = cachePosition >= 0 ? tables.cache[cachePosition] : 0.0f;
+    // favour vertices with few triangles left, finishing them off removes lonely ones
+    score += tables.valence[liveTriangles < MAX_VALENCE ? liveTriangles : MAX_VALENCE - 1];
+    return score;
+}
+
+}
+
+void optimizeVertexCache(uint32_t *indices, size_t indexCount, size_t vertexCount) {
+    const size_t triangleCount = indexCount / 3;
+    if (triangleCount == 0) {
+        return;
+    }
+
+    // triangles using each vertex, live ones are kept at the front of each list
+    vector<uint32_t> liveTriangles(vertexCount, 0);
+    for (size_t i = 0; i < indexCount; i++) {
+        liveTriangles[indices[i]]++;
+    }
+    vector<uint32_t> adjacencyOffset(vertexCount + 1, 0);
+    for (size_t v = 0; v < vertexCount; v++) {
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    }
+    vector<uint32_t> adjacency(indexCount);
+    vector<uint32_t> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++) {
+        for (int k = 0; k < 3; k++) {
+            adjacency[fill[indices[t * 3 + k]]++] = (uint32_t) t;
+        }
+    }
+
+    vector<float> score(vertexCount);
+    for (size_t v = 0; v < vertexCount; v++) {
+        score[v] = vertexScore(-1, liveTriangles[v]);
+    }
+
+    vector<float> triangleScore(triangleCount);
+    vector<bool> emitted(triangleCount, false);
+    for (size_t t = 0; t < triangleCount; t++) {
+        triangleScore[t] = score[indices[t * 3]] + score[indices[t * 3 + 1]] + score[indices[t * 3 + 2]];
+    }
+
+    vector<uint32_t> output(indexCount);
+    // room for the emitted triangle's vertices pushing older ones out
+    uint32_t cache[CACHE_SIZE + 3];
+    uint32_t newCache[CACHE_SIZE + 3];
+    int cacheCount = 0;
+
+    size_t scan = 0;
+    long best = -1;
+    for (size_t emittedCount = 0; emittedCount < triangleCount; emittedCount++) {
+        if (best < 0) {
+            // nothing in the cache touches a live triangle, take the next one in input order
+            while (emitted[scan]) {
+                scan++;
+            }
+            best = (long) scan;
+        }
+
+        const uint32_t *triangle = &indices[best * 3];
+        output[emittedCount * 3] = triangle[0];
+        output[emittedCount * 3 + 1] = triangle[1];
+        output[emittedCount * 3 + 2] = triangle[2];
+        emitted[best] = true;
+
+        // drop it from its vertices' live lists
+        for (int k = 0; k < 3; k++) {
+            uint32_t v = triangle[k];
+            uint32_t *list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t i = 0; i < liveTriangles[v]; i++) {
+                if (list[i] == (uint32_t) best) {
+                    list[i] = list[liveTriangles[v] - 1];
+                    break;
+                }
+            }
+            liveTriangles[v]--;
+        }
+
+        // its vertices move to the front, the rest keep their order
+        int newCount = 0;
+        for (int k = 0; k < 3; k++) {
+            newCache[newCount++] = triangle[k];
+        }
+        for (int i = 0; i < cacheCount; i++) {
+            uint32_t v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2]) {
+                newCache[newCount++] = v;
+            }
+        }
+
+        // rescore everything that was or is in the cache, evicted vertices included
+        for (int i = 0; i < newCount; i++) {
+            uint32_t v = newCache[i];
+            int position = i < CACHE_SIZE ? i : -1;
+
+            float newScore = vertexScore(position, liveTriangles[v]);
+            float delta = newScore - score[v];
+            score[v] = newScore;
+
+            const uint32_t *list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+                triangleScore[list[j]] += delta;
+            }
+        }
+
+        // next triangle: the best one touching the cache
+        cacheCount = newCount < CACHE_SIZE ? newCount : CACHE_SIZE;
+        best = -1;
+        float bestScore = -1.0f;
+        for (int i = 0; i < cacheCount; i++) {
+            uint32_t v = newCache[i];
+            const uint32_t *list = &adjacency[adjacencyOffset[v]];
+            for (uint32_t j = 0; j < liveTriangles[v]; j++) {
+                if (triangleScore[list[j]] > bestScore) {
+                    bestScore = triangleScore[list[j]];
+                    best = (long) list[j];
+                }
+            }
+        }
+
+        for (int i = 0; i < cacheCount; i++) {
+            cache[i] = newCache[i];
+        }
+    }
+
+    for (size_t i = 0; i < indexCount; i++) {
+        indices[i] = output[i];
+    }
+}
+
+size_t optimizeVertexFetch(MeshData &mesh) {
+    const size_t vertexCount = mesh.vertexCount();
+    const uint32_t unused = 0xffffffffu;
+
+    vector<uint32_t> remap(vertexCount, unused);
+    uint32_t next = 0;
+    for (size_t i = 0; i < mesh.indices.size(); i++) {
+        uint32_t &index = mesh.indices[i];
+        if (remap[index] == unused) {
+            remap[index] = next++;
+        }
+        index = remap[index];
+    }
+
+    // every attribute array is moved the same way
+    vector<float> *streams[3] = {&mesh.positions, &mesh.normals, &mesh.texcoords};
+    for (int s = 0; s < 3; s++) {
+        vector<float> &stream = *streams[s];
+        if (stream.empty() || vertexCount == 0) {
+            continue;
+        }
+        const size_t components = stream.size() / vertexCount;
+        vector<float> reordered((size_t) next * components);
+        for (size_t v = 0; v < vertexCount; v++) {
+            if (remap[v] == unused) {
+                continue;
+            }
+            for (size_t c = 0; c < components; c++) {
+                reordered[remap[v] * components + c] = stream[v * components + c];
+            }
+        }
+        stream.swap(reordered);
+    }
+    return next;
+}
+
+void optimizeMesh(MeshData &mesh) {
+    for (size_t i = 0; i < mesh.submeshes.size(); i++) {
+        const MeshSubmesh &submesh = mesh.submeshes[i];
+        optimizeVertexCache(&mesh.indices[submesh.firstIndex], submesh.indexCount, mesh.vertexCount());
+    }
+    optimizeVertexFetch(mesh);
+}
+
+float computeAcmr(const uint32_t *indices, size_t indexCount, size_t vertexCount, int cacheSize) {
+    if (indexCount < 3) {
+        return 0.0f;
+    }
+
+    // time each vertex entered the cache, a FIFO evicts after cacheSize misses
+    vector<size_t> insertedAt(vertexCount, 0);
+    vector<bool> seen(vertexCount, false);
+    size_t misses = 0;
+    for (size_t i = 0; i < indexCount; i++) {
+        uint32_t v = indices[i];
+        if (!seen[v] || misses - insertedAt[v] >= (size_t) cacheSize) {
+            seen[v] = true;
+            insertedAt[v] = misses;
+            misses++;
+        }
+    }
+    return (float) misses / (indexCount / 3);
+}
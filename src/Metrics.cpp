@@ -0,0 +1,208 @@
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "Metrics.h"
+
+using namespace std;
+
+MetricsPublisher::MetricsPublisher() : fd(-1), block(nullptr), frameTimeCount(0), nextFrameTime(0),
+                                       targetFrameMs(1000.0 / 60.0) {
+    memset(&pending, 0, sizeof(pending));
+}
+
+MetricsPublisher::~MetricsPublisher() {
+    close();
+}
+
+bool MetricsPublisher::open(const std::string &name) {
+    close();
+
+    fd = shm_open(name.c_str(), O_CREAT | O_RDWR, 0644);
+    if (fd < 0) {
+        cout << "Unable to create shared memory " << name << endl;
+        return false;
+    }
+    if (ftruncate(fd, sizeof(MetricsBlock)) != 0) {
+        cout << "Unable to size shared memory " << name << endl;
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name.c_str());
+        return false;
+    }
+    void *mapping = mmap(nullptr, sizeof(MetricsBlock), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        cout << "Unable to map shared memory " << name << endl;
+        ::close(fd);
+        fd = -1;
+        shm_unlink(name.c_str());
+        return false;
+    }
+
+    this->name = name;
+    block = static_cast<MetricsBlock *>(mapping);
+    // an odd sequence keeps readers out until the header is valid
+    block->sequence.store(1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    block->magic = METRICS_MAGIC;
+    block->version = METRICS_VERSION;
+    block->pid = (uint32_t) getpid();
+    memset(&block->sample, 0, sizeof(block->sample));
+    block->sequence.store(2, memory_order_release);
+
+    memset(&pending, 0, sizeof(pending));
+    frameTimeCount = 0;
+    nextFrameTime = 0;
+    return true;
+}
+
+void MetricsPublisher::close() {
+    if (block != nullptr) {
+        munmap(block, sizeof(MetricsBlock));
+        block = nullptr;
+        shm_unlink(name.c_str());
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool MetricsPublisher::isOpen() const {
+    return block != nullptr;
+}
+
+void MetricsPublisher::setTargetFrameMs(double ms) {
+    targetFrameMs = ms;
+}
+
+void MetricsPublisher::addDrawCalls(uint32_t count) {
+    pending.drawCalls += count;
+}
+
+void MetricsPublisher::addSimulationSteps(uint32_t steps) {
+    pending.simulationSteps += steps;
+}
+
+void MetricsPublisher::setGpuTimeMs(double ms) {
+    pending.gpuMs = (float) ms;
+}
+
+void MetricsPublisher::setMemoryBytes(uint64_t bytes) {
+    pending.memoryBytes = bytes;
+}
+
+void MetricsPublisher::endFrame(double frameMs) {
+    if (block == nullptr) {
+        return;
+    }
+
+    frameTimes[nextFrameTime] = (float) frameMs;
+    nextFrameTime = (nextFrameTime + 1) % METRICS_WINDOW;
+    frameTimeCount = min(frameTimeCount + 1, METRICS_WINDOW);
+
+    // partial sorts of a copy, each one only looks above the previous rank
+    float sorted[METRICS_WINDOW];
+    memcpy(sorted, frameTimes, frameTimeCount * sizeof(float));
+    float *end = sorted + frameTimeCount;
+    float *p50 = sorted + (frameTimeCount - 1) * 50 / 100;
+    float *p90 = sorted + (frameTimeCount - 1) * 90 / 100;
+    float *p99 = sorted + (frameTimeCount - 1) * 99 / 100;
+    nth_element(sorted, p50, end);
+    nth_element(p50, p90, end);
+    nth_element(p90, p99, end);
+
+    pending.frame++;
+    pending.timeNs = (uint64_t) chrono::duration_cast<chrono::nanoseconds>(
+            chrono::steady_clock::now().time_since_epoch()).count();
+    if (frameMs > targetFrameMs * 1.5) {
+        pending.droppedFrames++;
+    }
+    pending.frameMs = (float) frameMs;
+    pending.frameMsP50 = *p50;
+    pending.frameMsP90 = *p90;
+    pending.frameMsP99 = *p99;
+    pending.frameMsMax = *max_element(p99, end);
+
+    // only this process writes, a relaxed load sees its own last store
+    uint32_t sequence = block->sequence.load(memory_order_relaxed);
+    block->sequence.store(sequence + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+    memcpy(&block->sample, &pending, sizeof(pending));
+    block->sequence.store(sequence + 2, memory_order_release);
+
+    pending.drawCalls = 0;
+    pending.simulationSteps = 0;
+}
+
+MetricsReader::MetricsReader() : fd(-1), block(nullptr) {
+}
+
+MetricsReader::~MetricsReader() {
+    close();
+}
+
+bool MetricsReader::open(const std::string &name) {
+    close();
+
+    fd = shm_open(name.c_str(), O_RDONLY, 0);
+    if (fd < 0) {
+        cout << "No metrics published as " << name << endl;
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size < (off_t) sizeof(MetricsBlock)) {
+        cout << name << " is not a metrics block" << endl;
+        close();
+        return false;
+    }
+    void *mapping = mmap(nullptr, sizeof(MetricsBlock), PROT_READ, MAP_SHARED, fd, 0);
+    if (mapping == MAP_FAILED) {
+        cout << "Unable to map shared memory " << name << endl;
+        close();
+        return false;
+    }
+    block = static_cast<const MetricsBlock *>(mapping);
+
+    MetricsSample sample;
+    if (!read(sample) || block->magic != METRICS_MAGIC || block->version != METRICS_VERSION) {
+        cout << name << " is not a version " << METRICS_VERSION << " metrics block" << endl;
+        close();
+        return false;
+    }
+    return true;
+}
+
+void MetricsReader::close() {
+    if (block != nullptr) {
+        munmap(const_cast<MetricsBlock *>(block), sizeof(MetricsBlock));
+        block = nullptr;
+    }
+    if (fd >= 0) {
+        ::close(fd);
+        fd = -1;
+    }
+}
+
+bool MetricsReader::read(MetricsSample &sample, int attempts) const {
+    for (int i = 0; i < attempts; i++) {
+        uint32_t before = block->sequence.load(memory_order_acquire);
+        if (before & 1) {
+            continue;
+        }
+        memcpy(&sample, &block->sample, sizeof(sample));
+        atomic_thread_fence(memory_order_acquire);
+        if (block->sequence.load(memory_order_relaxed) == before) {
+            return true;
+        }
+    }
+    return false;
+}
+
+uint32_t MetricsReader::getPid() const {
+    return block->pid;
+}
@@ -0,0 +1,208 @@
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <unordered_map>
+#include <vector>
+#include "ObjLoader.h"
+
+using namespace std;
+
+namespace {
+
+struct VertexKey {
+    int position;
+    int texcoord;
+    int normal;
+
+    bool operator==(const VertexKey &other) const {
+        return position == other.position && texcoord == other.texcoord && normal == other.normal;
+    }
+};
+
+struct VertexKeyHash {
+    size_t operator()(const VertexKey &key) const {
+        size_t hash = (size_t) key.position * 73856093u;
+        hash ^= (size_t) key.texcoord * 19349663u;
+        hash ^= (size_t) key.normal * 83492791u;
+        return hash;
+    }
+};
+
+const char *skipSpaces(const char *p) {
+    while (*p == ' ' || *p == '\t') {
+        p++;
+    }
+    return p;
+}
+
+const char *nextLine(const char *p) {
+    while (*p != '\0' && *p != '\n') {
+        p++;
+    }
+    return *p == '\n' ? p + 1 : p;
+}
+
+// OBJ indices are 1 based, negative ones count back from the end
+int resolveIndex(long index, size_t count) {
+    if (index > 0) {
+        return (int) index - 1;
+    }
+    if (index < 0) {
+        return (int) count + (int) index;
+    }
+    return -1;
+}
+
+void startSubmesh(MeshData &mesh, const char *name) {
+    const uint32_t indexCount = (uint32_t) mesh.indices.size();
+    if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0) {
+        // nothing was added to the previous one, just rename it
+        mesh.submeshes.pop_back();
+    }
+
+    MeshSubmesh submesh;
+    memset(&submesh, 0, sizeof(submesh));
+    submesh.firstIndex = indexCount;
+    size_t length = 0;
+    while (name[length] != '\0' && name[length] != '\n' && name[length] != '\r' &&
+           length + 1 < sizeof(submesh.name)) {
+        length++;
+    }
+    memcpy(submesh.name, name, length);
+    mesh.submeshes.push_back(submesh);
+}
+
+}
+
+bool loadObj(const std::string &path, MeshData &mesh) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        cout << "Unable to open " << path << endl;
+        return false;
+    }
+
+    vector<char> text;
+    char chunk[64 * 1024];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.insert(text.end(), chunk, chunk + read);
+    }
+    fclose(file);
+    text.push_back('\0');
+
+    vector<float> positions, normals, texcoords;
+    unordered_map<VertexKey, uint32_t, VertexKeyHash> vertices;
+    vector<uint32_t> face;
+
+    mesh = MeshData();
+    startSubmesh(mesh, "default");
+
+    bool hasNormals = false;
+    bool hasTexcoords = false;
+
+    for (const char *p = text.data(); *p != '\0'; p = nextLine(p)) {
+        p = skipSpaces(p);
+        char *end;
+
+        if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+            const char *value = p + 2;
+            for (int i = 0; i < 3; i++) {
+                positions.push_back(strtof(value, &end));
+                value = end;
+            }
+        } else if (p[0] == 'v' && p[1] == 'n') {
+            const char *value = p + 2;
+            for (int i = 0; i < 3; i++) {
+                normals.push_back(strtof(value, &end));
+                value = end;
+            }
+        } else if (p[0] == 'v' && p[1] == 't') {
+            const char *value = p + 2;
+            for (int i = 0; i < 2; i++) {
+                texcoords.push_back(strtof(value, &end));
+                value = end;
+            }
+        } else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+            face.clear();
+            p = skipSpaces(p + 1);
+            while (*p != '\0' && *p != '\n' && *p != '\r') {
+                VertexKey key;
+                key.position = resolveIndex(strtol(p, &end, 10), positions.size() / 3);
+                key.texcoord = -1;
+                key.normal = -1;
+                if (end == p) {
+                    break;
+                }
+                p = end;
+                if (*p == '/') {
+                    p++;
+                    if (*p != '/') {
+                        key.texcoord = resolveIndex(strtol(p, &end, 10), texcoords.size() / 2);
+                        p = end;
+                    }
+                    if (*p == '/') {
+                        p++;
+                        key.normal = resolveIndex(strtol(p, &end, 10), normals.size() / 3);
+                        p = end;
+                    }
+                }
+                p = skipSpaces(p);
+
+                if (key.position < 0 || (size_t) key.position >= positions.size() / 3) {
+                    cout << path << ": face references a missing vertex" << endl;
+                    return false;
+                }
+
+                auto found = vertices.find(key);
+                if (found != vertices.end()) {
+                    face.push_back(found->second);
+                    continue;
+                }
+
+                uint32_t index = (uint32_t) (mesh.positions.size() / 3);
+                vertices[key] = index;
+                face.push_back(index);
+                mesh.positions.insert(mesh.positions.end(), &positions[key.position * 3],
+                                      &positions[key.position * 3] + 3);
+                if (key.normal >= 0 && (size_t) key.normal < normals.size() / 3) {
+                    hasNormals = true;
+                    mesh.normals.insert(mesh.normals.end(), &normals[key.normal * 3], &normals[key.normal * 3] + 3);
+                } else {
+                    mesh.normals.insert(mesh.normals.end(), 3, 0.0f);
+                }
+                if (key.texcoord >= 0 && (size_t) key.texcoord < texcoords.size() / 2) {
+                    hasTexcoords = true;
+                    mesh.texcoords.insert(mesh.texcoords.end(), &texcoords[key.texcoord * 2],
+                                          &texcoords[key.texcoord * 2] + 2);
+                } else {
+                    mesh.texcoords.insert(mesh.texcoords.end(), 2, 0.0f);
+                }
+            }
+
+            // fan triangulation
+            for (size_t i = 2; i < face.size(); i++) {
+                mesh.indices.push_back(face[0]);
+                mesh.indices.push_back(face[i - 1]);
+                mesh.indices.push_back(face[i]);
+                mesh.submeshes.back().indexCount += 3;
+            }
+        } else if ((p[0] == 'o' || p[0] == 'g') && (p[1] == ' ' || p[1] == '\t')) {
+            startSubmesh(mesh, skipSpaces(p + 2));
+        } else if (strncmp(p, "usemtl", 6) == 0) {
+            startSubmesh(mesh, skipSpaces(p + 6));
+        }
+    }
+
+    if (!mesh.submeshes.empty() && mesh.submeshes.back().indexCount == 0) {
+        mesh.submeshes.pop_back();
+    }
+    // don't store attributes no face used
+    if (!hasNormals) {
+        mesh.normals.clear();
+    }
+    if (!hasTexcoords) {
+        mesh.texcoords.clear();
+    }
+    return true;
+}
@@ -0,0 +1,117 @@
+#include "Physics.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define PHYSICS_USE_SSE2 1
+#endif
+
+namespace {
+
+// acceleration() constants
+const float SPRING_K = 10;
+const float SPRING_B = 1;
+
+}
+
+State interpolate(const State &previous, const State &current, float alpha) {
+    State state;
+    state.x = current.x * alpha + previous.x * (1 - alpha);
+    state.v = current.v * alpha + previous.v * (1 - alpha);
+    return state;
+}
+
+float acceleration(const State &state, float t) {
+    return -SPRING_K * state.x - SPRING_B * state.v;
+}
+
+Derivative evaluate(const State &initial, float t) {
+    Derivative output;
+    output.dx = initial.v;
+    output.dv = acceleration(initial, t);
+    return output;
+}
+
+Derivative evaluate(const State &initial, float t, float dt, const Derivative &d) {
+    State state;
+    state.x = initial.x + d.dx * dt;
+    state.v = initial.v + d.dv * dt;
+    Derivative output;
+    output.dx = state.v;
+    output.dv = acceleration(state, t + dt);
+    return output;
+}
+
+void integrate(State &state, float t, float dt) {
+    Derivative a = evaluate(state, t);
+    Derivative b = evaluate(state, t, dt * 0.5f, a);
+    Derivative c = evaluate(state, t, dt * 0.5f, b);
+    Derivative d = evaluate(state, t, dt, c);
+
+    const float dxdt = 1.0f / 6.0f * (a.dx + 2.0f * (b.dx + c.dx) + d.dx);
+    const float dvdt = 1.0f / 6.0f * (a.dv + 2.0f * (b.dv + c.dv) + d.dv);
+
+    state.x = state.x + dxdt * dt;
+    state.v = state.v + dvdt * dt;
+}
+
+#ifdef PHYSICS_USE_SSE2
+namespace {
+
+// one RK4 evaluate() for 4 states: derivative of (x + dx * dt, v + dv * dt)
+inline void evaluate4(__m128 x, __m128 v, __m128 dt, __m128 dx, __m128 dv, __m128 &outDx, __m128 &outDv) {
+    const __m128 negK = _mm_set1_ps(-SPRING_K);
+    const __m128 b = _mm_set1_ps(SPRING_B);
+    __m128 sx = _mm_add_ps(x, _mm_mul_ps(dx, dt));
+    __m128 sv = _mm_add_ps(v, _mm_mul_ps(dv, dt));
+    outDx = sv;
+    outDv = _mm_sub_ps(_mm_mul_ps(negK, sx), _mm_mul_ps(b, sv));
+}
+
+}
+#endif
+
+void integrateStates(State *states, size_t count, float t, float dt) {
+    size_t i = 0;
+#ifdef PHYSICS_USE_SSE2
+    const __m128 negK = _mm_set1_ps(-SPRING_K);
+    const __m128 b = _mm_set1_ps(SPRING_B);
+    const __m128 step = _mm_set1_ps(dt);
+    const __m128 halfStep = _mm_set1_ps(dt * 0.5f);
+    const __m128 two = _mm_set1_ps(2.0f);
+    const __m128 sixth = _mm_set1_ps(1.0f / 6.0f);
+    float *data = reinterpret_cast<float *>(states);
+    for (; i + 4 <= count; i += 4) {
+        // x0 v0 x1 v1 | x2 v2 x3 v3 -> x0 x1 x2 x3 | v0 v1 v2 v3
+        __m128 lo = _mm_loadu_ps(data + i * 2);
+        __m128 hi = _mm_loadu_ps(data + i * 2 + 4);
+        __m128 x = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(2, 0, 2, 0));
+        __m128 v = _mm_shuffle_ps(lo, hi, _MM_SHUFFLE(3, 1, 3, 1));
+
+        __m128 aDx = v;
+        __m128 aDv = _mm_sub_ps(_mm_mul_ps(negK, x), _mm_mul_ps(b, v));
+        __m128 bDx, bDv, cDx, cDv, dDx, dDv;
+        evaluate4(x, v, halfStep, aDx, aDv, bDx, bDv);
+        evaluate4(x, v, halfStep, bDx, bDv, cDx, cDv);
+        evaluate4(x, v, step, cDx, cDv, dDx, dDv);
+
+        __m128 dxdt = _mm_mul_ps(sixth, _mm_add_ps(_mm_add_ps(aDx, _mm_mul_ps(two, _mm_add_ps(bDx, cDx))), dDx));
+        __m128 dvdt = _mm_mul_ps(sixth, _mm_add_ps(_mm_add_ps(aDv, _mm_mul_ps(two, _mm_add_ps(bDv, cDv))), dDv));
+        x = _mm_add_ps(x, _mm_mul_ps(dxdt, step));
+        v = _mm_add_ps(v, _mm_mul_ps(dvdt, step));
+
+        _mm_storeu_ps(data + i * 2, _mm_unpacklo_ps(x, v));
+        _mm_storeu_ps(data + i * 2 + 4, _mm_unpackhi_ps(x, v));
+    }
+#endif
+    for (; i < count; i++) {
+        integrate(states[i], t, dt);
+    }
+}
+
+const char *physicsSimdName() {
+#ifdef PHYSICS_USE_SSE2
+    return "SSE2";
+#else
+    return "scalar";
+#endif
+}
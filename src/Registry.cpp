@@ -0,0 +1,169 @@
+#include <iostream>
+#include "Registry.h"
+
+using namespace std;
+
+const uint32_t SparseSet::ABSENT;
+
+void SparseSet::insertEntity(Entity entity) {
+    uint32_t index = entityIndex(entity);
+    if (index >= sparse.size()) {
+        sparse.resize(index + 1, ABSENT);
+    }
+    sparse[index] = (uint32_t) dense.size();
+    dense.push_back(entity);
+}
+
+void SparseSet::swapEntries(size_t a, size_t b) {
+    if (a == b) {
+        return;
+    }
+    swapComponents(a, b);
+    std::swap(dense[a], dense[b]);
+    sparse[entityIndex(dense[a])] = (uint32_t) a;
+    sparse[entityIndex(dense[b])] = (uint32_t) b;
+}
+
+void SparseSet::remove(Entity entity) {
+    // the last element fills the hole
+    size_t last = dense.size() - 1;
+    swapEntries(indexOf(entity), last);
+    sparse[entityIndex(entity)] = ABSENT;
+    dense.pop_back();
+    popComponent();
+}
+
+void SparseSet::clear() {
+    sparse.clear();
+    dense.clear();
+}
+
+void SparseSet::reserve(size_t capacity) {
+    sparse.reserve(capacity);
+    dense.reserve(capacity);
+}
+
+void GroupData::onAdd(Entity entity) {
+    if (!first->contains(entity) || !second->contains(entity) || contains(entity)) {
+        return;
+    }
+    // both components now, move it to the end of the packed range
+    first->swapEntries(first->indexOf(entity), size);
+    second->swapEntries(second->indexOf(entity), size);
+    size++;
+}
+
+void GroupData::onRemove(Entity entity) {
+    if (!contains(entity)) {
+        return;
+    }
+    // the last packed entity takes its place, it leaves the range
+    size--;
+    first->swapEntries(first->indexOf(entity), size);
+    second->swapEntries(second->indexOf(entity), size);
+}
+
+Registry::Registry() : freeList(NULL_ENTITY), aliveCount(0) {
+}
+
+Entity Registry::create() {
+    aliveCount++;
+    if (freeList != NULL_ENTITY) {
+        // recycle, the slot already holds the bumped version
+        uint32_t index = freeList;
+        Entity slot = entitySlots[index];
+        freeList = entityIndex(slot) == ENTITY_INDEX_MASK ? NULL_ENTITY : entityIndex(slot);
+        Entity entity = (entityVersion(slot) << ENTITY_INDEX_BITS) | index;
+        entitySlots[index] = entity;
+        return entity;
+    }
+    if (entitySlots.size() > ENTITY_INDEX_MASK - 1) {
+        cout << "Registry: out of entity indices" << endl;
+        aliveCount--;
+        return NULL_ENTITY;
+    }
+    Entity entity = (Entity) entitySlots.size();
+    entitySlots.push_back(entity);
+    return entity;
+}
+
+void Registry::destroy(Entity entity) {
+    if (!valid(entity)) {
+        return;
+    }
+    for (size_t type = 0; type < pools.size(); type++) {
+        SparseSet *pool = pools[type].get();
+        if (pool == nullptr || !pool->contains(entity)) {
+            continue;
+        }
+        if (owners[type] != nullptr) {
+            owners[type]->onRemove(entity);
+        }
+        pool->remove(entity);
+    }
+
+    // push the slot on the free list, ENTITY_INDEX_MASK marks its end
+    uint32_t index = entityIndex(entity);
+    uint32_t version = (entityVersion(entity) + 1) & ENTITY_VERSION_MASK;
+    uint32_t next = freeList == NULL_ENTITY ? ENTITY_INDEX_MASK : freeList;
+    entitySlots[index] = (version << ENTITY_INDEX_BITS) | next;
+    freeList = index;
+    aliveCount--;
+}
+
+bool Registry::valid(Entity entity) const {
+    uint32_t index = entityIndex(entity);
+    return entity != NULL_ENTITY && index < entitySlots.size() && entitySlots[index] == entity;
+}
+
+size_t Registry::alive() const {
+    return aliveCount;
+}
+
+void Registry::reserve(size_t entities) {
+    entitySlots.reserve(entities);
+}
+
+void Registry::clear() {
+    for (size_t type = 0; type < pools.size(); type++) {
+        if (pools[type]) {
+            pools[type]->clear();
+        }
+    }
+    for (size_t i = 0; i < groups.size(); i++) {
+        groups[i]->size = 0;
+    }
+    entitySlots.clear();
+    freeList = NULL_ENTITY;
+    aliveCount = 0;
+}
+
+GroupData *Registry::findGroup(SparseSet *first, SparseSet *second) {
+    for (size_t i = 0; i < groups.size(); i++) {
+        if (groups[i]->first == first && groups[i]->second == second) {
+            return groups[i].get();
+        }
+    }
+    return nullptr;
+}
+
+GroupData *Registry::createGroup(size_t first, size_t second) {
+    if (owners[first] != nullptr || owners[second] != nullptr) {
+        cout << "Registry: a component of the group is already owned by another group" << endl;
+        return nullptr;
+    }
+
+    GroupData *data = new GroupData();
+    data->first = pools[first].get();
+    data->second = pools[second].get();
+    data->size = 0;
+    groups.push_back(unique_ptr<GroupData>(data));
+    owners[first] = data;
+    owners[second] = data;
+
+    // pack the entities that already have both
+    for (size_t i = 0; i < data->first->size(); i++) {
+        data->onAdd(data->first->entities()[i]);
+    }
+    return data;
+}
@@ -0,0 +1,462 @@
+#include <algorithm>
+#include <cstdio>
+#include <iostream>
+#include <sys/stat.h>
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#endif
+#include "ShaderReloader.h"
+
+using namespace std;
+
+// mtime polling interval where inotify isn't available
+static const double POLL_INTERVAL_MS = 250.0;
+
+static double elapsedMs(Uint64 start) {
+    return (SDL_GetPerformanceCounter() - start) * 1000.0 / SDL_GetPerformanceFrequency();
+}
+
+static bool readFile(const string &path, string &text) {
+    FILE *file = fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return false;
+    }
+    text.clear();
+    char chunk[4096];
+    size_t read;
+    while ((read = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+        text.append(chunk, read);
+    }
+    fclose(file);
+    return true;
+}
+
+static long modifiedTime(const string &path) {
+    struct stat info;
+    return stat(path.c_str(), &info) == 0 ? (long) info.st_mtime : 0;
+}
+
+static string shaderLog(GLuint shader) {
+    GLint length = 0;
+    glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &length);
+    string log(length > 0 ? (size_t) length : 0, '\0');
+    if (length > 0) {
+        glGetShaderInfoLog(shader, length, nullptr, &log[0]);
+        log.resize(log.size() - 1);
+    }
+    return log;
+}
+
+static string programLog(GLuint program) {
+    GLint length = 0;
+    glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+    string log(length > 0 ? (size_t) length : 0, '\0');
+    if (length > 0) {
+        glGetProgramInfoLog(program, length, nullptr, &log[0]);
+        log.resize(log.size() - 1);
+    }
+    return log;
+}
+
+// issues compile and link without asking for the result, which would block
+static GLuint buildProgram(const string &vertexSource, const string &fragmentSource, GLuint shaders[2]) {
+    const GLenum types[2] = {GL_VERTEX_SHADER, GL_FRAGMENT_SHADER};
+    const string *sources[2] = {&vertexSource, &fragmentSource};
+
+    GLuint program = glCreateProgram();
+    for (int i = 0; i < 2; i++) {
+        const GLchar *source = sources[i]->c_str();
+        shaders[i] = glCreateShader(types[i]);
+        glShaderSource(shaders[i], 1, &source, NULL);
+        glCompileShader(shaders[i]);
+        glAttachShader(program, shaders[i]);
+    }
+    glLinkProgram(program);
+    return program;
+}
+
+// waits for the build, deletes the program on errors. Returns 0 and the logs
+// when it didn't link.
+static GLuint checkProgram(GLuint program, GLuint shaders[2], string &log) {
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        const char *names[2] = {"vertex shader:\n", "fragment shader:\n"};
+        for (int i = 0; i < 2; i++) {
+            GLint compiled = GL_FALSE;
+            glGetShaderiv(shaders[i], GL_COMPILE_STATUS, &compiled);
+            if (compiled != GL_TRUE) {
+                log += names[i] + shaderLog(shaders[i]) + "\n";
+            }
+        }
+        log += programLog(program);
+    }
+
+    // the program keeps the compiled code
+    for (int i = 0; i < 2; i++) {
+        glDeleteShader(shaders[i]);
+    }
+    if (linked != GL_TRUE) {
+        glDeleteProgram(program);
+        return 0;
+    }
+    return program;
+}
+
+ShaderReloader::ShaderReloader(const std::string &directory)
+        : directory(directory), backend(BACKEND_WORKER_CONTEXT), watchFd(-1), lastPoll(0),
+          workerWindow(nullptr), workerContext(nullptr), stopWorker(false),
+          reloads(0), failures(0), totalLatencyMs(0.0), maxLatencyMs(0.0) {
+}
+
+ShaderReloader::~ShaderReloader() {
+    shutdown();
+}
+
+bool ShaderReloader::init(SDL_Window *window, SDL_GLContext context, bool forceWorker) {
+#ifdef __linux__
+    watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    // editors either rewrite the file or rename a new one over it
+    if (watchFd < 0 || inotify_add_watch(watchFd, directory.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+        cout << "Unable to watch " << directory << ", falling back to polling" << endl;
+        if (watchFd >= 0) {
+            close(watchFd);
+            watchFd = -1;
+        }
+    }
+#endif
+
+    if (GLEW_KHR_parallel_shader_compile && !forceWorker) {
+        backend = BACKEND_PARALLEL_COMPILE;
+        // let the driver use as many threads as it likes
+        glMaxShaderCompilerThreadsKHR(0xffffffff);
+        return true;
+    }
+
+    // the worker needs a drawable of its own to make its context current
+    backend = BACKEND_WORKER_CONTEXT;
+    workerWindow = SDL_CreateWindow("shader compiler", 0, 0, 1, 1, SDL_WINDOW_OPENGL | SDL_WINDOW_HIDDEN);
+    if (workerWindow == nullptr) {
+        cout << "SDL_CreateWindow error " << SDL_GetError() << endl;
+        return false;
+    }
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 1);
+    workerContext = SDL_GL_CreateContext(workerWindow);
+    SDL_GL_SetAttribute(SDL_GL_SHARE_WITH_CURRENT_CONTEXT, 0);
+    // creating it made it current here
+    SDL_GL_MakeCurrent(window, context);
+    if (workerContext == nullptr) {
+        cout << "SDL_GL_CreateContext error " << SDL_GetError() << endl;
+        return false;
+    }
+
+    stopWorker = false;
+    worker = std::thread(&ShaderReloader::workerLoop, this);
+    return true;
+}
+
+bool ShaderReloader::readSources(const Program &program, std::string &vertexSource, std::string &fragmentSource) {
+    if (!readFile(directory + "/" + program.vertexFile, vertexSource)) {
+        cout << "Unable to read shader " << directory << "/" << program.vertexFile << endl;
+        return false;
+    }
+    if (!readFile(directory + "/" + program.fragmentFile, fragmentSource)) {
+        cout << "Unable to read shader " << directory << "/" << program.fragmentFile << endl;
+        return false;
+    }
+    return true;
+}
+
+int ShaderReloader::load(const std::string &vertexFile, const std::string &fragmentFile) {
+    Program entry;
+    entry.vertexFile = vertexFile;
+    entry.fragmentFile = fragmentFile;
+    entry.program = 0;
+    entry.pending = false;
+    entry.dirty = false;
+    entry.requestTime = 0;
+    entry.candidate = 0;
+
+    string vertexSource, fragmentSource;
+    if (!readSources(entry, vertexSource, fragmentSource)) {
+        return -1;
+    }
+
+    string log;
+    GLuint shaders[2];
+    entry.program = checkProgram(buildProgram(vertexSource, fragmentSource, shaders), shaders, log);
+    if (entry.program == 0) {
+        cout << "Error building " << vertexFile << " + " << fragmentFile << endl << log << endl;
+        return -1;
+    }
+
+    programs.push_back(entry);
+    modifiedTimes.push_back(max(modifiedTime(directory + "/" + vertexFile),
+                                modifiedTime(directory + "/" + fragmentFile)));
+    return (int) programs.size() - 1;
+}
+
+GLuint ShaderReloader::getProgram(int handle) const {
+    return programs[handle].program;
+}
+
+void ShaderReloader::startRebuild(int handle) {
+    Program &entry = programs[handle];
+    string vertexSource, fragmentSource;
+    if (!readSources(entry, vertexSource, fragmentSource)) {
+        failures++;
+        return;
+    }
+    entry.pending = true;
+    entry.dirty = false;
+
+    if (backend == BACKEND_PARALLEL_COMPILE) {
+        // returns right away, the driver compiles in the background
+        entry.candidate = buildProgram(vertexSource, fragmentSource, entry.candidateShaders);
+        return;
+    }
+
+    Job job;
+    job.handle = handle;
+    job.vertexSource.swap(vertexSource);
+    job.fragmentSource.swap(fragmentSource);
+    {
+        lock_guard<std::mutex> lock(mutex);
+        jobs.push_back(job);
+    }
+    jobReady.notify_one();
+}
+
+void ShaderReloader::finishRebuild(int handle, GLuint program, const std::string &log) {
+    Program &entry = programs[handle];
+    double latencyMs = elapsedMs(entry.requestTime);
+    entry.pending = false;
+
+    if (program == 0) {
+        failures++;
+        cout << "Shader reload failed, keeping the old program (" << entry.vertexFile << " + "
+             << entry.fragmentFile << ")" << endl << log << endl;
+    } else {
+        glDeleteProgram(entry.program);
+        entry.program = program;
+        reloads++;
+        totalLatencyMs += latencyMs;
+        maxLatencyMs = max(maxLatencyMs, latencyMs);
+        cout << "Reloaded " << entry.vertexFile << " + " << entry.fragmentFile << " in " << latencyMs << " ms"
+             << endl;
+    }
+
+    // changed again while this build was running
+    if (entry.dirty) {
+        entry.requestTime = SDL_GetPerformanceCounter();
+        startRebuild(handle);
+    }
+}
+
+void ShaderReloader::pollChanges(std::vector<std::string> &changed) {
+#ifdef __linux__
+    if (watchFd >= 0) {
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while ((length = read(watchFd, buffer, sizeof(buffer))) > 0) {
+            for (char *p = buffer; p < buffer + length;) {
+                const struct inotify_event *event = (const struct inotify_event *) p;
+                if (event->len > 0) {
+                    changed.push_back(event->name);
+                }
+                p += sizeof(struct inotify_event) + event->len;
+            }
+        }
+        return;
+    }
+#endif
+
+    if (elapsedMs(lastPoll) < POLL_INTERVAL_MS) {
+        return;
+    }
+    lastPoll = SDL_GetPerformanceCounter();
+    for (size_t i = 0; i < programs.size(); i++) {
+        long modified = max(modifiedTime(directory + "/" + programs[i].vertexFile),
+                            modifiedTime(directory + "/" + programs[i].fragmentFile));
+        if (modified != modifiedTimes[i]) {
+            modifiedTimes[i] = modified;
+            changed.push_back(programs[i].vertexFile);
+        }
+    }
+}
+
+bool ShaderReloader::update() {
+    const int finishedBefore = reloads + failures;
+    const bool busyBefore = isBusy();
+
+    vector<string> changed;
+    pollChanges(changed);
+    for (size_t c = 0; c < changed.size(); c++) {
+        for (size_t i = 0; i < programs.size(); i++) {
+            Program &entry = programs[i];
+            if (changed[c] != entry.vertexFile && changed[c] != entry.fragmentFile) {
+                continue;
+            }
+            if (entry.pending) {
+                entry.dirty = true;
+            } else {
+                entry.requestTime = SDL_GetPerformanceCounter();
+                startRebuild((int) i);
+            }
+        }
+    }
+
+    if (backend == BACKEND_PARALLEL_COMPILE) {
+        for (size_t i = 0; i < programs.size(); i++) {
+            Program &entry = programs[i];
+            if (!entry.pending) {
+                continue;
+            }
+            GLint done = GL_FALSE;
+            glGetProgramiv(entry.candidate, GL_COMPLETION_STATUS_KHR, &done);
+            if (done == GL_TRUE) {
+                // finished, asking for the result doesn't block anymore
+                string log;
+                GLuint program = checkProgram(entry.candidate, entry.candidateShaders, log);
+                entry.candidate = 0;
+                finishRebuild((int) i, program, log);
+            }
+        }
+    } else {
+        // worker results, used once the fence says the worker's GL commands completed
+        while (true) {
+            Result result;
+            {
+                lock_guard<std::mutex> lock(mutex);
+                if (results.empty()) {
+                    break;
+                }
+                if (results.front().fence != nullptr &&
+                    glClientWaitSync(results.front().fence, 0, 0) == GL_TIMEOUT_EXPIRED) {
+                    break;
+                }
+                result = results.front();
+                results.pop_front();
+            }
+            if (result.fence != nullptr) {
+                glDeleteSync(result.fence);
+            }
+            finishRebuild(result.handle, result.program, result.log);
+        }
+    }
+
+    return busyBefore || isBusy() || reloads + failures != finishedBefore;
+}
+
+void ShaderReloader::workerLoop() {
+    SDL_GL_MakeCurrent(workerWindow, workerContext);
+
+    while (true) {
+        Job job;
+        {
+            unique_lock<std::mutex> lock(mutex);
+            jobReady.wait(lock, [this] { return stopWorker || !jobs.empty(); });
+            if (stopWorker) {
+                break;
+            }
+            job = jobs.front();
+            jobs.pop_front();
+        }
+
+        // blocking here is fine, the render thread keeps going
+        Result result;
+        result.handle = job.handle;
+        GLuint shaders[2];
+        result.program = checkProgram(buildProgram(job.vertexSource, job.fragmentSource, shaders), shaders,
+                                      result.log);
+        result.fence = nullptr;
+        if (result.program != 0) {
+            result.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        }
+        // get the commands to the driver so the other context sees them
+        glFlush();
+
+        lock_guard<std::mutex> lock(mutex);
+        results.push_back(result);
+    }
+
+    SDL_GL_MakeCurrent(workerWindow, nullptr);
+}
+
+bool ShaderReloader::isBusy() const {
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (programs[i].pending) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void ShaderReloader::shutdown() {
+    if (worker.joinable()) {
+        {
+            lock_guard<std::mutex> lock(mutex);
+            stopWorker = true;
+        }
+        jobReady.notify_one();
+        worker.join();
+    }
+    for (size_t i = 0; i < results.size(); i++) {
+        if (results[i].fence != nullptr) {
+            glDeleteSync(results[i].fence);
+        }
+        glDeleteProgram(results[i].program);
+    }
+    results.clear();
+    jobs.clear();
+
+    if (workerContext != nullptr) {
+        SDL_GL_DeleteContext(workerContext);
+        workerContext = nullptr;
+    }
+    if (workerWindow != nullptr) {
+        SDL_DestroyWindow(workerWindow);
+        workerWindow = nullptr;
+    }
+#ifdef __linux__
+    if (watchFd >= 0) {
+        close(watchFd);
+        watchFd = -1;
+    }
+#endif
+
+    for (size_t i = 0; i < programs.size(); i++) {
+        if (programs[i].candidate != 0) {
+            glDeleteShader(programs[i].candidateShaders[0]);
+            glDeleteShader(programs[i].candidateShaders[1]);
+            glDeleteProgram(programs[i].candidate);
+        }
+        glDeleteProgram(programs[i].program);
+    }
+    programs.clear();
+}
+
+ShaderReloader::Backend ShaderReloader::getBackend() const {
+    return backend;
+}
+
+const char *ShaderReloader::getBackendName() const {
+    return backend == BACKEND_PARALLEL_COMPILE ? "GL_KHR_parallel_shader_compile" : "shared context worker";
+}
+
+int ShaderReloader::getReloads() const {
+    return reloads;
+}
+
+int ShaderReloader::getFailures() const {
+    return failures;
+}
+
+double ShaderReloader::getAverageLatencyMs() const {
+    return reloads > 0 ? totalLatencyMs / reloads : 0.0;
+}
+
+double ShaderReloader::getMaxLatencyMs() const {
+    return maxLatencyMs;
+}
@@ -0,0 +1,514 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <iostream>
+#include "SoftRasterizer.h"
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define RASTERIZER_USE_SSE2 1
+#endif
+
+#if defined(RASTERIZER_USE_SSE2) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+// the AVX2 kernel is compiled for AVX2 only and picked at runtime
+#define RASTERIZER_USE_AVX2 1
+#endif
+
+using namespace std;
+
+// triangles with a vertex further than this from the viewport are dropped,
+// keeps the per tile edge function values inside 32 bits
+static const int GUARD_BAND_PIXELS = 8192;
+
+namespace {
+
+/*
+ * Rasterizes the rows [y0, y1) and columns [x0, x1) of one tile.
+ * w holds the three edge functions (biased for the fill rule) at the centre
+ * of pixel (x0, y0), stepX / stepY their increments for one pixel.
+ * A pixel is covered when all three are >= 0.
+ */
+typedef void (*SpanKernel)(uint32_t *buffer, int stride, int x0, int x1, int y0, int y1,
+                           const int32_t w[3], const int32_t stepX[3], const int32_t stepY[3], uint32_t color);
+
+#ifndef RASTERIZER_USE_SSE2
+void spanKernelScalar(uint32_t *buffer, int stride, int x0, int x1, int y0, int y1,
+                      const int32_t w[3], const int32_t stepX[3], const int32_t stepY[3], uint32_t color) {
+    int32_t w0Row = w[0], w1Row = w[1], w2Row = w[2];
+    for (int y = y0; y < y1; y++) {
+        int32_t w0 = w0Row, w1 = w1Row, w2 = w2Row;
+        uint32_t *row = buffer + (size_t) y * stride;
+        for (int x = x0; x < x1; x++) {
+            if ((w0 | w1 | w2) >= 0) {
+                row[x] = color;
+            }
+            w0 += stepX[0];
+            w1 += stepX[1];
+            w2 += stepX[2];
+        }
+        w0Row += stepY[0];
+        w1Row += stepY[1];
+        w2Row += stepY[2];
+    }
+}
+#endif
+
+#ifdef RASTERIZER_USE_SSE2
+const int SSE2_LANES = 4;
+
+void spanKernelSSE2(uint32_t *buffer, int stride, int x0, int x1, int y0, int y1,
+                    const int32_t w[3], const int32_t stepX[3], const int32_t stepY[3], uint32_t color) {
+    __m128i wRow[3], stepX4[3], stepYv[3];
+    for (int i = 0; i < 3; i++) {
+        const int32_t s = stepX[i];
+        wRow[i] = _mm_add_epi32(_mm_set1_epi32(w[i]), _mm_set_epi32(3 * s, 2 * s, s, 0));
+        stepX4[i] = _mm_set1_epi32(stepX[i] * SSE2_LANES);
+        stepYv[i] = _mm_set1_epi32(stepY[i]);
+    }
+    const __m128i colorv = _mm_set1_epi32((int) color);
+
+    for (int y = y0; y < y1; y++) {
+        __m128i w0 = wRow[0], w1 = wRow[1], w2 = wRow[2];
+        uint32_t *row = buffer + (size_t) y * stride;
+        for (int x = x0; x < x1; x += SSE2_LANES) {
+            // sign bit set in any edge function means outside
+            __m128i outside = _mm_srai_epi32(_mm_or_si128(_mm_or_si128(w0, w1), w2), 31);
+            __m128i *dst = (__m128i *) (row + x);
+            __m128i old = _mm_loadu_si128(dst);
+            _mm_storeu_si128(dst, _mm_or_si128(_mm_and_si128(outside, old), _mm_andnot_si128(outside, colorv)));
+            w0 = _mm_add_epi32(w0, stepX4[0]);
+            w1 = _mm_add_epi32(w1, stepX4[1]);
+            w2 = _mm_add_epi32(w2, stepX4[2]);
+        }
+        wRow[0] = _mm_add_epi32(wRow[0], stepYv[0]);
+        wRow[1] = _mm_add_epi32(wRow[1], stepYv[1]);
+        wRow[2] = _mm_add_epi32(wRow[2], stepYv[2]);
+    }
+}
+#endif
+
+#ifdef RASTERIZER_USE_AVX2
+const int AVX2_LANES = 8;
+
+__attribute__((target("avx2")))
+void spanKernelAVX2(uint32_t *buffer, int stride, int x0, int x1, int y0, int y1,
+                    const int32_t w[3], const int32_t stepX[3], const int32_t stepY[3], uint32_t color) {
+    const __m256i lanes = _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256i wRow[3], stepX8[3], stepYv[3];
+    for (int i = 0; i < 3; i++) {
+        wRow[i] = _mm256_add_epi32(_mm256_set1_epi32(w[i]), _mm256_mullo_epi32(lanes, _mm256_set1_epi32(stepX[i])));
+        stepX8[i] = _mm256_set1_epi32(stepX[i] * AVX2_LANES);
+        stepYv[i] = _mm256_set1_epi32(stepY[i]);
+    }
+    const __m256i colorv = _mm256_set1_epi32((int) color);
+
+    for (int y = y0; y < y1; y++) {
+        __m256i w0 = wRow[0], w1 = wRow[1], w2 = wRow[2];
+        uint32_t *row = buffer + (size_t) y * stride;
+        for (int x = x0; x < x1; x += AVX2_LANES) {
+            __m256i outside = _mm256_srai_epi32(_mm256_or_si256(_mm256_or_si256(w0, w1), w2), 31);
+            __m256i *dst = (__m256i *) (row + x);
+            __m256i old = _mm256_loadu_si256(dst);
+            _mm256_storeu_si256(dst, _mm256_blendv_epi8(colorv, old, outside));
+            w0 = _mm256_add_epi32(w0, stepX8[0]);
+            w1 = _mm256_add_epi32(w1, stepX8[1]);
+            w2 = _mm256_add_epi32(w2, stepX8[2]);
+        }
+        wRow[0] = _mm256_add_epi32(wRow[0], stepYv[0]);
+        wRow[1] = _mm256_add_epi32(wRow[1], stepYv[1]);
+        wRow[2] = _mm256_add_epi32(wRow[2], stepYv[2]);
+    }
+}
+#endif
+
+struct KernelChoice {
+    SpanKernel kernel;
+    int lanes;
+    const char *name;
+};
+
+KernelChoice chooseKernel() {
+    KernelChoice choice;
+#ifdef RASTERIZER_USE_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+        choice.kernel = spanKernelAVX2;
+        choice.lanes = AVX2_LANES;
+        choice.name = "AVX2";
+        return choice;
+    }
+#endif
+#ifdef RASTERIZER_USE_SSE2
+    choice.kernel = spanKernelSSE2;
+    choice.lanes = SSE2_LANES;
+    choice.name = "SSE2";
+#else
+    choice.kernel = spanKernelScalar;
+    choice.lanes = 1;
+    choice.name = "scalar";
+#endif
+    return choice;
+}
+
+const KernelChoice &kernel() {
+    static const KernelChoice choice = chooseKernel();
+    return choice;
+}
+
+uint32_t packColor(float red, float green, float blue, float alpha) {
+    float c[4] = {red, green, blue, alpha};
+    uint32_t packed = 0;
+    for (int i = 0; i < 4; i++) {
+        float v = std::min(1.0f, std::max(0.0f, c[i]));
+        packed |= ((uint32_t) (v * 255.0f + 0.5f)) << (i * 8);
+    }
+    return packed;
+}
+
+// twice the signed area of (a, b, c), positive when c is left of a->b in y down space
+int64_t orient2d(int64_t ax, int64_t ay, int64_t bx, int64_t by, int64_t cx, int64_t cy) {
+    return (bx - ax) * (cy - ay) - (by - ay) * (cx - ax);
+}
+
+}
+
+SoftRasterizer::SoftRasterizer(int width, int height, int threadCount) :
+        width(width), height(height), clearPending(false), clearColor(0),
+        generation(0), busyWorkers(0), stopping(false), nextTile(0) {
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    stride = tilesX * TILE_SIZE;
+    colorBuffer.assign((size_t) stride * tilesY * TILE_SIZE, 0);
+    bins.resize((size_t) tilesX * tilesY);
+
+    if (threadCount <= 0) {
+        threadCount = std::max(1, (int) std::thread::hardware_concurrency());
+    }
+    // the calling thread works too
+    for (int i = 1; i < threadCount; i++) {
+        workers.push_back(std::thread(&SoftRasterizer::workerLoop, this));
+    }
+}
+
+SoftRasterizer::~SoftRasterizer() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    workReady.notify_all();
+    for (size_t i = 0; i < workers.size(); i++) {
+        workers[i].join();
+    }
+}
+
+void SoftRasterizer::clear(float red, float green, float blue, float alpha) {
+    clearPending = true;
+    clearColor = packColor(red, green, blue, alpha);
+    triangles.clear();
+    for (size_t i = 0; i < bins.size(); i++) {
+        bins[i].clear();
+    }
+}
+
+void SoftRasterizer::drawTriangles(const float *positions, int vertexCount, const float color[4]) {
+    const uint32_t packed = packColor(color[0], color[1], color[2], color[3]);
+    const float scale = (float) (1 << SUBPIXEL_BITS);
+    const int32_t guardMin = -GUARD_BAND_PIXELS * (1 << SUBPIXEL_BITS);
+    const int32_t guardMaxX = (width + GUARD_BAND_PIXELS) << SUBPIXEL_BITS;
+    const int32_t guardMaxY = (height + GUARD_BAND_PIXELS) << SUBPIXEL_BITS;
+    const int32_t half = 1 << (SUBPIXEL_BITS - 1);
+
+    for (int v = 0; v + 2 < vertexCount; v += 3) {
+        Triangle triangle;
+        bool inGuardBand = true;
+        for (int i = 0; i < 3; i++) {
+            const float *p = positions + (v + i) * 3;
+            // viewport transform, y flipped so row 0 is the top
+            double sx = (p[0] + 1.0) * 0.5 * width * scale;
+            double sy = (1.0 - p[1]) * 0.5 * height * scale;
+            if (!(sx > guardMin && sx < guardMaxX && sy > guardMin && sy < guardMaxY)) {
+                inGuardBand = false;
+                break;
+            }
+            triangle.x[i] = (int32_t) std::floor(sx + 0.5);
+            triangle.y[i] = (int32_t) std::floor(sy + 0.5);
+        }
+        if (!inGuardBand) {
+            continue;
+        }
+
+        int64_t area = orient2d(triangle.x[0], triangle.y[0], triangle.x[1], triangle.y[1],
+                                triangle.x[2], triangle.y[2]);
+        if (area == 0) {
+            continue;
+        }
+        if (area < 0) {
+            // no face culling, just make every triangle the same winding
+            std::swap(triangle.x[1], triangle.x[2]);
+            std::swap(triangle.y[1], triangle.y[2]);
+        }
+
+        // pixels whose centre can be inside the triangle
+        int32_t minX = std::min(triangle.x[0], std::min(triangle.x[1], triangle.x[2]));
+        int32_t maxX = std::max(triangle.x[0], std::max(triangle.x[1], triangle.x[2]));
+        int32_t minY = std::min(triangle.y[0], std::min(triangle.y[1], triangle.y[2]));
+        int32_t maxY = std::max(triangle.y[0], std::max(triangle.y[1], triangle.y[2]));
+        const int32_t one = 1 << SUBPIXEL_BITS;
+        triangle.minX = std::max(0, (minX - half + one - 1) >> SUBPIXEL_BITS);
+        triangle.minY = std::max(0, (minY - half + one - 1) >> SUBPIXEL_BITS);
+        triangle.maxX = std::min(width - 1, (maxX - half) >> SUBPIXEL_BITS);
+        triangle.maxY = std::min(height - 1, (maxY - half) >> SUBPIXEL_BITS);
+        if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+            continue;
+        }
+        triangle.color = packed;
+
+        int index = (int) triangles.size();
+        triangles.push_back(triangle);
+        for (int ty = triangle.minY / TILE_SIZE; ty <= triangle.maxY / TILE_SIZE; ty++) {
+            for (int tx = triangle.minX / TILE_SIZE; tx <= triangle.maxX / TILE_SIZE; tx++) {
+                bins[ty * tilesX + tx].push_back(index);
+            }
+        }
+    }
+}
+
+void SoftRasterizer::rasterizeTriangle(const Triangle &triangle, int tileX0, int tileY0) {
+    const int lanes = kernel().lanes;
+    const int32_t half = 1 << (SUBPIXEL_BITS - 1);
+
+    // rectangle of the tile to walk, x widened to whole SIMD chunks.
+    // Tiles are a multiple of the SIMD width so chunks never leave the tile
+    int x0 = std::max(triangle.minX, tileX0);
+    int y0 = std::max(triangle.minY, tileY0);
+    int x1 = std::min(triangle.maxX, tileX0 + TILE_SIZE - 1) + 1;
+    int y1 = std::min(triangle.maxY, tileY0 + TILE_SIZE - 1) + 1;
+    x0 = tileX0 + ((x0 - tileX0) / lanes) * lanes;
+    x1 = tileX0 + ((x1 - tileX0 + lanes - 1) / lanes) * lanes;
+
+    const int64_t px0 = ((int64_t) x0 << SUBPIXEL_BITS) + half;
+    const int64_t py0 = ((int64_t) y0 << SUBPIXEL_BITS) + half;
+    const int64_t px1 = ((int64_t) (x1 - 1) << SUBPIXEL_BITS) + half;
+    const int64_t py1 = ((int64_t) (y1 - 1) << SUBPIXEL_BITS) + half;
+
+    int32_t w[3], stepX[3], stepY[3];
+    int acceptedEdges = 0;
+    for (int i = 0; i < 3; i++) {
+        // edge i goes from vertex i + 1 to vertex i + 2
+        const int a = (i + 1) % 3;
+        const int b = (i + 2) % 3;
+        const int32_t dx = triangle.x[b] - triangle.x[a];
+        const int32_t dy = triangle.y[b] - triangle.y[a];
+
+        // top-left rule: pixels exactly on a right or bottom edge belong to the neighbour
+        const bool topLeft = (dy < 0) || (dy == 0 && dx > 0);
+        const int64_t bias = topLeft ? 0 : -1;
+
+        const int64_t corners[4] = {
+                orient2d(triangle.x[a], triangle.y[a], triangle.x[b], triangle.y[b], px0, py0) + bias,
+                orient2d(triangle.x[a], triangle.y[a], triangle.x[b], triangle.y[b], px1, py0) + bias,
+                orient2d(triangle.x[a], triangle.y[a], triangle.x[b], triangle.y[b], px0, py1) + bias,
+                orient2d(triangle.x[a], triangle.y[a], triangle.x[b], triangle.y[b], px1, py1) + bias
+        };
+        const int64_t minCorner = std::min(std::min(corners[0], corners[1]), std::min(corners[2], corners[3]));
+        const int64_t maxCorner = std::max(std::max(corners[0], corners[1]), std::max(corners[2], corners[3]));
+
+        if (maxCorner < 0) {
+            // the whole rectangle is outside this edge
+            return;
+        }
+        if (minCorner >= 0) {
+            // the whole rectangle is inside, the edge can be skipped
+            w[i] = 0;
+            stepX[i] = 0;
+            stepY[i] = 0;
+            acceptedEdges++;
+            continue;
+        }
+
+        // the edge crosses the rectangle so its values are small enough for 32 bits
+        w[i] = (int32_t) corners[0];
+        stepX[i] = -dy * (1 << SUBPIXEL_BITS);
+        stepY[i] = dx * (1 << SUBPIXEL_BITS);
+    }
+
+    if (acceptedEdges == 3) {
+        // fully covered, plain fill
+        for (int y = y0; y < y1; y++) {
+            uint32_t *row = &colorBuffer[(size_t) y * stride];
+            std::fill(row + x0, row + x1, triangle.color);
+        }
+        return;
+    }
+
+    kernel().kernel(colorBuffer.data(), stride, x0, x1, y0, y1, w, stepX, stepY, triangle.color);
+}
+
+void SoftRasterizer::rasterizeTile(int tile) {
+    const std::vector<int> &bin = bins[tile];
+    if (!clearPending && bin.empty()) {
+        return;
+    }
+
+    const int tileX0 = (tile % tilesX) * TILE_SIZE;
+    const int tileY0 = (tile / tilesX) * TILE_SIZE;
+
+    if (clearPending) {
+        for (int y = tileY0; y < tileY0 + TILE_SIZE; y++) {
+            uint32_t *row = &colorBuffer[(size_t) y * stride + tileX0];
+            std::fill(row, row + TILE_SIZE, clearColor);
+        }
+    }
+
+    for (size_t i = 0; i < bin.size(); i++) {
+        rasterizeTriangle(triangles[bin[i]], tileX0, tileY0);
+    }
+}
+
+void SoftRasterizer::rasterizeTiles() {
+    const int tileCount = tilesX * tilesY;
+    for (;;) {
+        int tile = nextTile.fetch_add(1);
+        if (tile >= tileCount) {
+            break;
+        }
+        rasterizeTile(tile);
+    }
+}
+
+void SoftRasterizer::workerLoop() {
+    int seenGeneration = 0;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            while (!stopping && generation == seenGeneration) {
+                workReady.wait(lock);
+            }
+            if (stopping) {
+                return;
+            }
+            seenGeneration = generation;
+        }
+
+        rasterizeTiles();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            busyWorkers--;
+            if (busyWorkers == 0) {
+                workDone.notify_one();
+            }
+        }
+    }
+}
+
+void SoftRasterizer::finish() {
+    if (!clearPending && triangles.empty()) {
+        return;
+    }
+
+    nextTile = 0;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        busyWorkers = (int) workers.size();
+        generation++;
+    }
+    workReady.notify_all();
+
+    rasterizeTiles();
+
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (busyWorkers > 0) {
+            workDone.wait(lock);
+        }
+    }
+
+    clearPending = false;
+    triangles.clear();
+    for (size_t i = 0; i < bins.size(); i++) {
+        bins[i].clear();
+    }
+}
+
+int SoftRasterizer::getWidth() const {
+    return width;
+}
+
+int SoftRasterizer::getHeight() const {
+    return height;
+}
+
+int SoftRasterizer::getThreadCount() const {
+    return (int) workers.size() + 1;
+}
+
+uint32_t SoftRasterizer::getPixel(int x, int y) const {
+    return colorBuffer[(size_t) y * stride + x];
+}
+
+bool SoftRasterizer::savePPM(const std::string &path) const {
+    ofstream file(path.c_str(), ios::binary);
+    if (!file) {
+        cout << "Unable to open " << path << " for writing" << endl;
+        return false;
+    }
+
+    file << "P6\n" << width << " " << height << "\n255\n";
+    std::vector<unsigned char> row((size_t) width * 3);
+    for (int y = 0; y < height; y++) {
+        for (int x = 0; x < width; x++) {
+            uint32_t p = getPixel(x, y);
+            row[x * 3 + 0] = (unsigned char) (p & 0xff);
+            row[x * 3 + 1] = (unsigned char) ((p >> 8) & 0xff);
+            row[x * 3 + 2] = (unsigned char) ((p >> 16) & 0xff);
+        }
+        file.write((const char *) row.data(), row.size());
+    }
+    return (bool) file;
+}
+
+long SoftRasterizer::comparePPM(const std::string &path) const {
+    ifstream file(path.c_str(), ios::binary);
+    if (!file) {
+        cout << "Unable to open " << path << endl;
+        return -1;
+    }
+
+    string magic;
+    int fileWidth = 0, fileHeight = 0, maxValue = 0;
+    file >> magic >> fileWidth >> fileHeight >> maxValue;
+    // a single whitespace separates the header from the pixels
+    file.get();
+    if (!file || magic != "P6" || maxValue != 255) {
+        cout << path << " is not a binary 8 bit PPM" << endl;
+        return -1;
+    }
+    if (fileWidth != width || fileHeight != height) {
+        cout << path << " is " << fileWidth << "x" << fileHeight << ", expected "
+             << width << "x" << height << endl;
+        return -1;
+    }
+
+    long different = 0;
+    std::vector<unsigned char> row((size_t) width * 3);
+    for (int y = 0; y < height; y++) {
+        if (!file.read((char *) row.data(), row.size())) {
+            cout << path << " is truncated" << endl;
+            return -1;
+        }
+        for (int x = 0; x < width; x++) {
+            uint32_t p = getPixel(x, y);
+            if (row[x * 3 + 0] != (p & 0xff) ||
+                row[x * 3 + 1] != ((p >> 8) & 0xff) ||
+                row[x * 3 + 2] != ((p >> 16) & 0xff)) {
+                different++;
+            }
+        }
+    }
+    return different;
+}
+
+const char *SoftRasterizer::simdName() {
+    return kernel().name;
+}
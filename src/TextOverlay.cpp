@@ -0,0 +1,488 @@
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <iostream>
+#include "TextOverlay.h"
+
+using namespace std;
+
+const int TextOverlay::TIMER_QUERIES;
+const int TextOverlay::TIMER_INTERVAL;
+const int TextOverlay::GLYPH_WIDTH;
+const int TextOverlay::GLYPH_HEIGHT;
+
+namespace {
+
+const int FIRST_CHAR = 32;
+const int LAST_CHAR = 126;
+const int ATLAS_COLUMNS = 16;
+const int ATLAS_ROWS = 6;
+const int ATLAS_WIDTH = ATLAS_COLUMNS * TextOverlay::GLYPH_WIDTH;
+const int ATLAS_HEIGHT = ATLAS_ROWS * TextOverlay::GLYPH_HEIGHT;
+
+// 5x7 font, ASCII 32-126, one byte per column, bit 0 at the top
+const GLubyte FONT[][5] = {
+        {0x00, 0x00, 0x00, 0x00, 0x00}, {0x00, 0x00, 0x5f, 0x00, 0x00}, {0x00, 0x07, 0x00, 0x07, 0x00},
+        {0x14, 0x7f, 0x14, 0x7f, 0x14}, {0x24, 0x2a, 0x7f, 0x2a, 0x12}, {0x23, 0x13, 0x08, 0x64, 0x62},
+        {0x36, 0x49, 0x55, 0x22, 0x50}, {0x00, 0x05, 0x03, 0x00, 0x00}, {0x00, 0x1c, 0x22, 0x41, 0x00},
+        {0x00, 0x41, 0x22, 0x1c, 0x00}, {0x08, 0x2a, 0x1c, 0x2a, 0x08}, {0x08, 0x08, 0x3e, 0x08, 0x08},
+        {0x00, 0x50, 0x30, 0x00, 0x00}, {0x08, 0x08, 0x08, 0x08, 0x08}, {0x00, 0x60, 0x60, 0x00, 0x00},
+        {0x20, 0x10, 0x08, 0x04, 0x02}, {0x3e, 0x51, 0x49, 0x45, 0x3e}, {0x00, 0x42, 0x7f, 0x40, 0x00},
+        {0x42, 0x61, 0x51, 0x49, 0x46}, {0x21, 0x41, 0x45, 0x4b, 0x31}, {0x18, 0x14, 0x12, 0x7f, 0x10},
+        {0x27, 0x45, 0x45, 0x45, 0x39}, {0x3c, 0x4a, 0x49, 0x49, 0x30}, {0x01, 0x71, 0x09, 0x05, 0x03},
+        {0x36, 0x49, 0x49, 0x49, 0x36}, {0x06, 0x49, 0x49, 0x29, 0x1e}, {0x00, 0x36, 0x36, 0x00, 0x00},
+        {0x00, 0x56, 0x36, 0x00, 0x00}, {0x08, 0x14, 0x22, 0x41, 0x00}, {0x14, 0x14, 0x14, 0x14, 0x14},
+        {0x00, 0x41, 0x22, 0x14, 0x08}, {0x02, 0x01, 0x51, 0x09, 0x06}, {0x32, 0x49, 0x79, 0x41, 0x3e},
+        {0x7e, 0x11, 0x11, 0x11, 0x7e}, {0x7f, 0x49, 0x49, 0x49, 0x36}, {0x3e, 0x41, 0x41, 0x41, 0x22},
+        {0x7f, 0x41, 0x41, 0x22, 0x1c}, {0x7f, 0x49, 0x49, 0x49, 0x41}, {0x7f, 0x09, 0x09, 0x09, 0x01},
+        {0x3e, 0x41, 0x49, 0x49, 0x7a}, {0x7f, 0x08, 0x08, 0x08, 0x7f}, {0x00, 0x41, 0x7f, 0x41, 0x00},
+        {0x20, 0x40, 0x41, 0x3f, 0x01}, {0x7f, 0x08, 0x14, 0x22, 0x41}, {0x7f, 0x40, 0x40, 0x40, 0x40},
+        {0x7f, 0x02, 0x0c, 0x02, 0x7f}, {0x7f, 0x04, 0x08, 0x10, 0x7f}, {0x3e, 0x41, 0x41, 0x41, 0x3e},
+        {0x7f, 0x09, 0x09, 0x09, 0x06}, {0x3e, 0x41, 0x51, 0x21, 0x5e}, {0x7f, 0x09, 0x19, 0x29, 0x46},
+        {0x46, 0x49, 0x49, 0x49, 0x31}, {0x01, 0x01, 0x7f, 0x01, 0x01}, {0x3f, 0x40, 0x40, 0x40, 0x3f},
+        {0x1f, 0x20, 0x40, 0x20, 0x1f}, {0x3f, 0x40, 0x38, 0x40, 0x3f}, {0x63, 0x14, 0x08, 0x14, 0x63},
+        {0x07, 0x08, 0x70, 0x08, 0x07}, {0x61, 0x51, 0x49, 0x45, 0x43}, {0x00, 0x7f, 0x41, 0x41, 0x00},
+        {0x02, 0x04, 0x08, 0x10, 0x20}, {0x00, 0x41, 0x41, 0x7f, 0x00}, {0x04, 0x02, 0x01, 0x02, 0x04},
+        {0x40, 0x40, 0x40, 0x40, 0x40}, {0x00, 0x01, 0x02, 0x04, 0x00}, {0x20, 0x54, 0x54, 0x54, 0x78},
+        {0x7f, 0x48, 0x44, 0x44, 0x38}, {0x38, 0x44, 0x44, 0x44, 0x20}, {0x38, 0x44, 0x44, 0x48, 0x7f},
+        {0x38, 0x54, 0x54, 0x54, 0x18}, {0x08, 0x7e, 0x09, 0x01, 0x02}, {0x0c, 0x52, 0x52, 0x52, 0x3e},
+        {0x7f, 0x08, 0x04, 0x04, 0x78}, {0x00, 0x44, 0x7d, 0x40, 0x00}, {0x20, 0x40, 0x44, 0x3d, 0x00},
+        {0x7f, 0x10, 0x28, 0x44, 0x00}, {0x00, 0x41, 0x7f, 0x40, 0x00}, {0x7c, 0x04, 0x18, 0x04, 0x78},
+        {0x7c, 0x08, 0x04, 0x04, 0x78}, {0x38, 0x44, 0x44, 0x44, 0x38}, {0x7c, 0x14, 0x14, 0x14, 0x08},
+        {0x08, 0x14, 0x14, 0x18, 0x7c}, {0x7c, 0x08, 0x04, 0x04, 0x08}, {0x48, 0x54, 0x54, 0x54, 0x20},
+        {0x04, 0x3f, 0x44, 0x40, 0x20}, {0x3c, 0x40, 0x40, 0x20, 0x7c}, {0x1c, 0x20, 0x40, 0x20, 0x1c},
+        {0x3c, 0x40, 0x30, 0x40, 0x3c}, {0x44, 0x28, 0x10, 0x28, 0x44}, {0x0c, 0x50, 0x50, 0x50, 0x3c},
+        {0x44, 0x64, 0x54, 0x4c, 0x44}, {0x00, 0x08, 0x36, 0x41, 0x00}, {0x00, 0x00, 0x7f, 0x00, 0x00},
+        {0x00, 0x41, 0x36, 0x08, 0x00}, {0x08, 0x04, 0x08, 0x10, 0x08}
+};
+static_assert(sizeof(FONT) / sizeof(FONT[0]) == LAST_CHAR - FIRST_CHAR + 1, "one glyph per character");
+
+// the set pixels of a glyph, [x0, x1) x [y0, y1), empty for ' '
+void inkBounds(int glyph, int &x0, int &y0, int &x1, int &y1) {
+    x0 = 5;
+    x1 = 0;
+    GLubyte rows = 0;
+    for (int x = 0; x < 5; x++) {
+        if (FONT[glyph][x] != 0) {
+            x0 = min(x0, x);
+            x1 = x + 1;
+            rows |= FONT[glyph][x];
+        }
+    }
+    y0 = 0;
+    y1 = 0;
+    for (int y = 0; y < 7; y++) {
+        if ((rows >> y) & 1) {
+            y0 = y1 == 0 ? y : y0;
+            y1 = y + 1;
+        }
+    }
+}
+
+const GLchar *VERTEX_SHADER =
+        "#version 150\n"
+        "in vec2 position;\n"
+        "in vec2 texcoord;\n"
+        "uniform vec2 screen;\n"
+        "out vec2 vTexcoord;\n"
+        "void main() {\n"
+        "    vTexcoord = texcoord;\n"
+        "    gl_Position = vec4(position.x / screen.x * 2.0 - 1.0, 1.0 - position.y / screen.y * 2.0, 0.0, 1.0);\n"
+        "}";
+
+// the cached image is premultiplied
+const GLchar *FRAGMENT_SHADER =
+        "#version 150\n"
+        "in vec2 vTexcoord;\n"
+        "uniform sampler2D image;\n"
+        "out vec4 fragColor;\n"
+        "void main() {\n"
+        "    fragColor = texture(image, vTexcoord);\n"
+        "}";
+
+GLuint compile(GLenum type, const GLchar *source) {
+    GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &source, NULL);
+    glCompileShader(shader);
+    GLint compiled = GL_FALSE;
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled != GL_TRUE) {
+        char log[1024];
+        glGetShaderInfoLog(shader, sizeof(log), nullptr, log);
+        cout << "Unable to compile text overlay shader" << endl << log << endl;
+        glDeleteShader(shader);
+        return 0;
+    }
+    return shader;
+}
+
+}
+
+TextOverlay::TextOverlay(int scale) : scale(max(1, scale)), cachedScreenWidth(0), cachedScreenHeight(0), program(0),
+                                      vao(0), vbo(0), screenLocation(-1), cacheIndex(0), bandVertices(0), draws(0),
+                                      timedDraws(0), gpuMs(0.0) {
+    for (int i = 0; i < CACHE_TEXTURES; i++) {
+        caches[i] = 0;
+        cacheWidths[i] = 0;
+        cacheHeights[i] = 0;
+    }
+}
+
+TextOverlay::~TextOverlay() {
+    shutdown();
+}
+
+bool TextOverlay::init() {
+    // glyphs in cells of GLYPH_WIDTH x GLYPH_HEIGHT, the spacing is part of the cell. Only the CPU reads it.
+    atlas.assign((size_t) ATLAS_WIDTH * ATLAS_HEIGHT, 0);
+    for (int cell = 0; cell <= LAST_CHAR - FIRST_CHAR; cell++) {
+        const int cellX = cell % ATLAS_COLUMNS * GLYPH_WIDTH;
+        const int cellY = cell / ATLAS_COLUMNS * GLYPH_HEIGHT;
+        for (int y = 0; y < 7; y++) {
+            for (int x = 0; x < 5; x++) {
+                atlas[(cellY + y) * ATLAS_WIDTH + cellX + x] = (FONT[cell][x] >> y) & 1 ? 255 : 0;
+            }
+        }
+    }
+
+    GLuint vertexShader = compile(GL_VERTEX_SHADER, VERTEX_SHADER);
+    GLuint fragmentShader = compile(GL_FRAGMENT_SHADER, FRAGMENT_SHADER);
+    if (vertexShader == 0 || fragmentShader == 0) {
+        return false;
+    }
+    program = glCreateProgram();
+    glAttachShader(program, vertexShader);
+    glAttachShader(program, fragmentShader);
+    glBindAttribLocation(program, 0, "position");
+    glBindAttribLocation(program, 1, "texcoord");
+    glLinkProgram(program);
+    glDeleteShader(vertexShader);
+    glDeleteShader(fragmentShader);
+
+    GLint linked = GL_FALSE;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    if (linked != GL_TRUE) {
+        cout << "Unable to link text overlay program" << endl;
+        return false;
+    }
+    screenLocation = glGetUniformLocation(program, "screen");
+    glUseProgram(program);
+    glUniform1i(glGetUniformLocation(program, "image"), 0);
+    glUseProgram(0);
+
+    // the quads the cached image is drawn with
+    glGenVertexArrays(1, &vao);
+    glGenBuffers(1, &vbo);
+    glBindVertexArray(vao);
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glEnableVertexAttribArray(0);
+    glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (const GLvoid *) offsetof(TextVertex, x));
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, sizeof(TextVertex), (const GLvoid *) offsetof(TextVertex, u));
+    glBindVertexArray(0);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+    glGenTextures(CACHE_TEXTURES, caches);
+    for (int i = 0; i < CACHE_TEXTURES; i++) {
+        glBindTexture(GL_TEXTURE_2D, caches[i]);
+        // texel exact, the quad covers the image pixel for pixel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, 0);
+        // no wrapping to compute per texel
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glGenQueries(TIMER_QUERIES * 2, &timerQueries[0][0]);
+    return true;
+}
+
+void TextOverlay::shutdown() {
+    if (program != 0) {
+        glDeleteQueries(TIMER_QUERIES * 2, &timerQueries[0][0]);
+        glDeleteProgram(program);
+        glDeleteBuffers(1, &vbo);
+        glDeleteVertexArrays(1, &vao);
+        glDeleteTextures(CACHE_TEXTURES, caches);
+        program = 0;
+        vbo = 0;
+        vao = 0;
+        for (int i = 0; i < CACHE_TEXTURES; i++) {
+            caches[i] = 0;
+            cacheWidths[i] = 0;
+            cacheHeights[i] = 0;
+        }
+        cacheIndex = 0;
+        bandVertices = 0;
+        cachedVertices.clear();
+        cachedScreenWidth = 0;
+        cachedScreenHeight = 0;
+    }
+}
+
+void TextOverlay::begin() {
+    vertices.clear();
+}
+
+void TextOverlay::quad(float x0, float y0, float x1, float y1, float u0, float v0, float u1, float v1,
+                       const GLubyte color[4]) {
+    const TextVertex corners[4] = {
+            {x0, y0, u0, v0, {color[0], color[1], color[2], color[3]}},
+            {x1, y0, u1, v0, {color[0], color[1], color[2], color[3]}},
+            {x1, y1, u1, v1, {color[0], color[1], color[2], color[3]}},
+            {x0, y1, u0, v1, {color[0], color[1], color[2], color[3]}}
+    };
+    // two triangles, so every quad goes in the same draw
+    vertices.push_back(corners[0]);
+    vertices.push_back(corners[1]);
+    vertices.push_back(corners[2]);
+    vertices.push_back(corners[0]);
+    vertices.push_back(corners[2]);
+    vertices.push_back(corners[3]);
+}
+
+float TextOverlay::text(float x, float y, const char *string, const GLubyte color[4]) {
+    const float texelU = 1.f / (ATLAS_COLUMNS * GLYPH_WIDTH);
+    const float texelV = 1.f / (ATLAS_ROWS * GLYPH_HEIGHT);
+    const float startX = x;
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '\n') {
+            x = startX;
+            y += getLineHeight();
+            continue;
+        }
+        const int cell = (*c < FIRST_CHAR || *c > LAST_CHAR) ? '?' - FIRST_CHAR : *c - FIRST_CHAR;
+        // only the glyph's set pixels, the rest would be composited for nothing
+        int x0, y0, x1, y1;
+        inkBounds(cell, x0, y0, x1, y1);
+        if (x1 > x0 && y1 > y0) {
+            const int u = cell % ATLAS_COLUMNS * GLYPH_WIDTH;
+            const int v = cell / ATLAS_COLUMNS * GLYPH_HEIGHT;
+            quad(x + x0 * scale, y + y0 * scale, x + x1 * scale, y + y1 * scale,
+                 (u + x0) * texelU, (v + y0) * texelV, (u + x1) * texelU, (v + y1) * texelV, color);
+        }
+        x += GLYPH_WIDTH * scale;
+    }
+    return x;
+}
+
+void TextOverlay::rect(float x, float y, float width, float height, const GLubyte color[4]) {
+    // negative texcoords, composited without an atlas lookup
+    quad(x, y, x + width, y + height, -1.f, -1.f, -1.f, -1.f, color);
+}
+
+void TextOverlay::graph(float x, float y, float width, float height, const float *values, int count,
+                        float maxValue, const GLubyte color[4]) {
+    if (count <= 0 || maxValue <= 0.f) {
+        return;
+    }
+    const float barWidth = width / count;
+    for (int i = 0; i < count; i++) {
+        float barHeight = min(values[i] / maxValue, 1.f) * height;
+        if (barHeight < 1.f) {
+            continue;
+        }
+        rect(x + i * barWidth, y + height - barHeight, max(barWidth - 1.f, 1.f), barHeight, color);
+    }
+}
+
+const std::vector<TextVertex> &TextOverlay::getVertices() const {
+    return vertices;
+}
+
+void TextOverlay::draw(int screenWidth, int screenHeight) {
+    draw(vertices, screenWidth, screenHeight);
+}
+
+void TextOverlay::rasterize(const std::vector<TextVertex> &frameVertices, int screenWidth, int screenHeight) {
+    // the pixels the quads cover, clipped to the screen
+    float minX = (float) screenWidth;
+    float minY = (float) screenHeight;
+    float maxX = 0.f;
+    float maxY = 0.f;
+    for (size_t i = 0; i < frameVertices.size(); i++) {
+        minX = min(minX, frameVertices[i].x);
+        minY = min(minY, frameVertices[i].y);
+        maxX = max(maxX, frameVertices[i].x);
+        maxY = max(maxY, frameVertices[i].y);
+    }
+    const int left = max(0, (int) floor(minX));
+    const int top = max(0, (int) floor(minY));
+    const int width = max(0, min(screenWidth, (int) ceil(maxX)) - left);
+    const int height = max(0, min(screenHeight, (int) ceil(maxY)) - top);
+
+    // premultiplied RGBA, quads composited in order like the blended draw would.
+    // Each row also keeps the columns its quads cover.
+    image.assign((size_t) width * height * 4, 0);
+    vector<int> rowLeft((size_t) height, width);
+    vector<int> rowRight((size_t) height, 0);
+    for (size_t q = 0; q + 5 < frameVertices.size(); q += 6) {
+        // corners 0 and 2 of quad() are the top left and bottom right
+        const TextVertex &a = frameVertices[q];
+        const TextVertex &b = frameVertices[q + 2];
+        // pixel centres inside the quad, as GL rasterizes it
+        const int x0 = max(left, (int) ceil(a.x - 0.5f));
+        const int x1 = min(left + width, (int) ceil(b.x - 0.5f));
+        const int y0 = max(top, (int) ceil(a.y - 0.5f));
+        const int y1 = min(top + height, (int) ceil(b.y - 0.5f));
+        if (x1 <= x0 || a.color[3] == 0) {
+            continue;
+        }
+        const bool textured = a.u >= 0.f;
+        const float texelsPerPixelX = (b.u - a.u) * ATLAS_WIDTH / (b.x - a.x);
+        const float texelsPerPixelY = (b.v - a.v) * ATLAS_HEIGHT / (b.y - a.y);
+        for (int y = y0; y < y1; y++) {
+            rowLeft[y - top] = min(rowLeft[y - top], x0 - left);
+            rowRight[y - top] = max(rowRight[y - top], x1 - left);
+            const int texelY = textured ? (int) (a.v * ATLAS_HEIGHT + (y + 0.5f - a.y) * texelsPerPixelY) : 0;
+            GLubyte *pixel = &image[((size_t) (y - top) * width + x0 - left) * 4];
+            for (int x = x0; x < x1; x++, pixel += 4) {
+                int coverage = 255;
+                if (textured) {
+                    const int texelX = (int) (a.u * ATLAS_WIDTH + (x + 0.5f - a.x) * texelsPerPixelX);
+                    coverage = atlas[texelY * ATLAS_WIDTH + texelX];
+                }
+                const int alpha = a.color[3] * coverage / 255;
+                if (alpha == 255) {
+                    memcpy(pixel, a.color, 4);
+                } else if (alpha != 0) {
+                    for (int c = 0; c < 3; c++) {
+                        pixel[c] = (GLubyte) ((a.color[c] * alpha + pixel[c] * (255 - alpha)) / 255);
+                    }
+                    pixel[3] = (GLubyte) (alpha + pixel[3] * (255 - alpha) / 255);
+                }
+            }
+        }
+    }
+
+    cacheIndex = (cacheIndex + 1) % CACHE_TEXTURES;
+    GLsizei &cacheWidth = cacheWidths[cacheIndex];
+    GLsizei &cacheHeight = cacheHeights[cacheIndex];
+    glBindTexture(GL_TEXTURE_2D, caches[cacheIndex]);
+    if (width > cacheWidth || height > cacheHeight) {
+        cacheWidth = max(width, cacheWidth);
+        cacheHeight = max(height, cacheHeight);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, cacheWidth, cacheHeight, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    if (width > 0 && height > 0) {
+        glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    // Software GL pays for every pixel the quads cover, inked or not. One quad per band of covered rows,
+    // trimmed to the band's columns, leaves out the gaps between lines and after short ones.
+    vector<TextVertex> bands;
+    int bandTop = -1;
+    int bandLeft = width;
+    int bandRight = 0;
+    for (int y = 0; y <= height; y++) {
+        if (y < height && rowRight[y] > rowLeft[y]) {
+            bandTop = bandTop < 0 ? y : bandTop;
+            bandLeft = min(bandLeft, rowLeft[y]);
+            bandRight = max(bandRight, rowRight[y]);
+        } else if (bandTop >= 0) {
+            const float x0 = (float) (left + bandLeft);
+            const float y0 = (float) (top + bandTop);
+            const float x1 = (float) (left + bandRight);
+            const float y1 = (float) (top + y);
+            const float u0 = (float) bandLeft / cacheWidth;
+            const float v0 = (float) bandTop / cacheHeight;
+            const float u1 = (float) bandRight / cacheWidth;
+            const float v1 = (float) y / cacheHeight;
+            const TextVertex corners[4] = {
+                    {x0, y0, u0, v0, {255, 255, 255, 255}},
+                    {x1, y0, u1, v0, {255, 255, 255, 255}},
+                    {x1, y1, u1, v1, {255, 255, 255, 255}},
+                    {x0, y1, u0, v1, {255, 255, 255, 255}}
+            };
+            const int order[6] = {0, 1, 2, 0, 2, 3};
+            for (int i = 0; i < 6; i++) {
+                bands.push_back(corners[order[i]]);
+            }
+            bandTop = -1;
+            bandLeft = width;
+            bandRight = 0;
+        }
+    }
+    bandVertices = (GLsizei) bands.size();
+    glBindBuffer(GL_ARRAY_BUFFER, vbo);
+    glBufferData(GL_ARRAY_BUFFER, (GLsizeiptr) (bands.size() * sizeof(TextVertex)), bands.data(), GL_DYNAMIC_DRAW);
+    glBindBuffer(GL_ARRAY_BUFFER, 0);
+    // the program keeps it until the screen size changes
+    glUseProgram(program);
+    glUniform2f(screenLocation, (GLfloat) screenWidth, (GLfloat) screenHeight);
+    glUseProgram(0);
+    cachedVertices = frameVertices;
+    cachedScreenWidth = screenWidth;
+    cachedScreenHeight = screenHeight;
+}
+
+void TextOverlay::draw(const std::vector<TextVertex> &frameVertices, int screenWidth, int screenHeight) {
+    if (program == 0 || frameVertices.empty()) {
+        return;
+    }
+
+    // every TIMER_INTERVAL-th draw is timed, the queries cost about as much as a small draw on software GL
+    const bool timed = draws++ % TIMER_INTERVAL == 0;
+    // collect a draw from TIMER_QUERIES timed draws ago, if the GPU is done with it
+    GLuint *queries = timerQueries[timedDraws % TIMER_QUERIES];
+    if (timed && timedDraws >= TIMER_QUERIES) {
+        GLint available = GL_FALSE;
+        glGetQueryObjectiv(queries[1], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (available == GL_TRUE) {
+            GLuint64 start = 0;
+            GLuint64 end = 0;
+            glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &start);
+            glGetQueryObjectui64v(queries[1], GL_QUERY_RESULT, &end);
+            gpuMs = (end - start) / 1e6;
+        }
+    }
+    if (timed) {
+        glQueryCounter(queries[0], GL_TIMESTAMP);
+    }
+
+    // the text is redrawn only when it or the screen changed, most frames just composite the cached image.
+    // The image is clipped to the screen and the bands are placed on it, another size needs both again.
+    if (screenWidth != cachedScreenWidth || screenHeight != cachedScreenHeight ||
+        frameVertices.size() != cachedVertices.size() ||
+        memcmp(frameVertices.data(), cachedVertices.data(), frameVertices.size() * sizeof(TextVertex)) != 0) {
+        rasterize(frameVertices, screenWidth, screenHeight);
+    }
+
+    if (bandVertices > 0) {
+        const GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+        glDisable(GL_DEPTH_TEST);
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_ONE, GL_ONE_MINUS_SRC_ALPHA);
+
+        glUseProgram(program);
+        glActiveTexture(GL_TEXTURE0);
+        glBindTexture(GL_TEXTURE_2D, caches[cacheIndex]);
+        glBindVertexArray(vao);
+        glDrawArrays(GL_TRIANGLES, 0, bandVertices);
+
+        glBindVertexArray(0);
+        glBindTexture(GL_TEXTURE_2D, 0);
+        glUseProgram(0);
+        glDisable(GL_BLEND);
+        if (depthTest) {
+            glEnable(GL_DEPTH_TEST);
+        }
+    }
+
+    if (timed) {
+        glQueryCounter(queries[1], GL_TIMESTAMP);
+        timedDraws++;
+    }
+}
+
+int TextOverlay::getLineHeight() const {
+    return (GLYPH_HEIGHT + 1) * scale;
+}
+
+double TextOverlay::getGpuMs() const {
+    return gpuMs;
+}
@@ -0,0 +1,219 @@
+#include <algorithm>
+#include <iostream>
+#include "TextureStreamer.h"
+
+using namespace std;
+
+TextureStreamer::TextureStreamer(uint64_t budgetBytes, uint64_t uploadBytesPerFrame, int tailSize) :
+        budgetBytes(budgetBytes), uploadBytesPerFrame(uploadBytesPerFrame), tailSize(tailSize), frame(0),
+        residentBytes(0), peakBytes(0) {
+    stats = {0, 0, 0, 0, 0};
+}
+
+TextureStreamer::~TextureStreamer() {
+    for (size_t i = 0; i < entries.size(); i++) {
+        glDeleteTextures(1, &entries[i].texture);
+    }
+}
+
+uint64_t TextureStreamer::levelBytes(const Entry &entry, int level) const {
+    return (uint64_t) max(1, entry.width >> level) * max(1, entry.height >> level) * 4;
+}
+
+void TextureStreamer::uploadLevel(Entry &entry, int level) {
+    entry.source->loadLevel(level, texels);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, max(1, entry.width >> level), max(1, entry.height >> level), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, texels.data());
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    const uint64_t bytes = levelBytes(entry, level);
+    entry.residentLevel = level;
+    residentBytes += bytes;
+    peakBytes = max(peakBytes, residentBytes);
+    stats.bytesUploaded += bytes;
+    stats.levelsUploaded++;
+}
+
+void TextureStreamer::dropLevel(Entry &entry) {
+    const int level = entry.residentLevel;
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    // move the base first so the texture never references a missing level
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, level + 1);
+    // a 0 x 0 image releases the level's storage
+    glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA8, 0, 0, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    entry.residentLevel = level + 1;
+    residentBytes -= levelBytes(entry, level);
+    stats.levelsEvicted++;
+}
+
+bool TextureStreamer::makeRoom(uint64_t bytes, const Entry *keep) {
+    while (residentBytes + bytes > budgetBytes) {
+        // the least recently used texture holding more than its tail
+        Entry *victim = nullptr;
+        for (size_t i = 0; i < entries.size(); i++) {
+            Entry &entry = entries[i];
+            if (&entry != keep && !entry.requested && entry.residentLevel < entry.tailLevel &&
+                (victim == nullptr || entry.lastUsedFrame < victim->lastUsedFrame)) {
+                victim = &entry;
+            }
+        }
+        // then detail a visible texture doesn't need at its current size
+        for (size_t i = 0; i < entries.size() && victim == nullptr; i++) {
+            Entry &entry = entries[i];
+            if (&entry != keep && entry.requested && entry.residentLevel < entry.wantedLevel) {
+                victim = &entry;
+            }
+        }
+        if (victim == nullptr) {
+            return false;
+        }
+        dropLevel(*victim);
+    }
+    return true;
+}
+
+int TextureStreamer::add(TextureSource *source) {
+    Entry entry;
+    entry.source.reset(source);
+    entry.width = source->getWidth();
+    entry.height = source->getHeight();
+    entry.levels = 1;
+    while ((max(entry.width, entry.height) >> entry.levels) > 0) {
+        entry.levels++;
+    }
+    entry.tailLevel = 0;
+    while (entry.tailLevel < entry.levels - 1 && (max(entry.width, entry.height) >> entry.tailLevel) > tailSize) {
+        entry.tailLevel++;
+    }
+    entry.residentLevel = entry.levels;
+    entry.wantedLevel = entry.tailLevel;
+    entry.lastUsedFrame = frame;
+    entry.requested = false;
+
+    uint64_t tailBytes = 0;
+    for (int level = entry.tailLevel; level < entry.levels; level++) {
+        tailBytes += levelBytes(entry, level);
+    }
+    if (!makeRoom(tailBytes, nullptr)) {
+        cout << "TextureStreamer: no room in the budget for texture " << entries.size() << endl;
+        return -1;
+    }
+
+    glGenTextures(1, &entry.texture);
+    glBindTexture(GL_TEXTURE_2D, entry.texture);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, entry.levels - 1);
+    // smallest first, the base level follows the finest one
+    for (int level = entry.levels - 1; level >= entry.tailLevel; level--) {
+        uploadLevel(entry, level);
+    }
+
+    entries.push_back(std::move(entry));
+    return (int) entries.size() - 1;
+}
+
+GLuint TextureStreamer::request(int id, float screenSize) {
+    Entry &entry = entries[id];
+
+    // the coarsest level still as large as the screen size
+    int wanted = 0;
+    while (wanted < entry.tailLevel && (max(entry.width, entry.height) >> (wanted + 1)) >= screenSize) {
+        wanted++;
+    }
+    entry.wantedLevel = entry.requested ? min(entry.wantedLevel, wanted) : wanted;
+    entry.requested = true;
+    entry.lastUsedFrame = frame;
+
+    stats.requests++;
+    if (entry.residentLevel <= wanted) {
+        stats.hits++;
+    }
+    return entry.texture;
+}
+
+void TextureStreamer::update() {
+    uint64_t uploaded = 0;
+    vector<int> missing;
+    bool full = false;
+    // one level per texture per pass, so all of them sharpen together
+    while (!full) {
+        missing.clear();
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (entries[i].requested && entries[i].wantedLevel < entries[i].residentLevel) {
+                missing.push_back((int) i);
+            }
+        }
+        // furthest from what they need first
+        sort(missing.begin(), missing.end(), [this](int a, int b) {
+            return entries[a].residentLevel - entries[a].wantedLevel >
+                   entries[b].residentLevel - entries[b].wantedLevel;
+        });
+
+        bool progress = false;
+        for (size_t i = 0; i < missing.size(); i++) {
+            Entry &entry = entries[missing[i]];
+            const int level = entry.residentLevel - 1;
+            const uint64_t bytes = levelBytes(entry, level);
+            // the first level always goes, even when larger than the limit
+            if (uploaded > 0 && uploaded + bytes > uploadBytesPerFrame) {
+                full = true;
+                break;
+            }
+            if (!makeRoom(bytes, &entry)) {
+                continue;
+            }
+            uploadLevel(entry, level);
+            uploaded += bytes;
+            progress = true;
+        }
+        if (!progress) {
+            break;
+        }
+    }
+
+    for (size_t i = 0; i < entries.size(); i++) {
+        entries[i].requested = false;
+    }
+    frame++;
+}
+
+int TextureStreamer::getCount() const {
+    return (int) entries.size();
+}
+
+int TextureStreamer::getResidentLevel(int id) const {
+    return entries[id].residentLevel;
+}
+
+uint64_t TextureStreamer::getResidentBytes() const {
+    return residentBytes;
+}
+
+uint64_t TextureStreamer::getPeakBytes() const {
+    return peakBytes;
+}
+
+uint64_t TextureStreamer::getBudgetBytes() const {
+    return budgetBytes;
+}
+
+uint64_t TextureStreamer::getTotalBytes() const {
+    uint64_t total = 0;
+    for (size_t i = 0; i < entries.size(); i++) {
+        for (int level = 0; level < entries[i].levels; level++) {
+            total += levelBytes(entries[i], level);
+        }
+    }
+    return total;
+}
+
+const TextureStreamerStats &TextureStreamer::getStats() const {
+    return stats;
+}